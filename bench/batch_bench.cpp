@@ -0,0 +1,61 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+
+// Scaling of RunBatch from one worker to every hardware thread. Each job runs a short loop for
+// 50000 cycles, the rate is in jobs per second of wall time.
+static void BM_RunBatch(benchmark::State& state)
+{
+    // loop: INX; STX $0200; LDA $0300,X; BNE loop; JMP loop
+    auto program = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{
+        0xE8, 0x8E, 0x00, 0x02, 0xBD, 0x00, 0x03, 0xD0, 0xF7, 0x4C, 0x00, 0x80});
+
+    const size_t job_count = 256;
+    std::vector<BatchJob> jobs(job_count);
+    for (size_t i = 0; i < job_count; i++)
+    {
+        jobs[i].image = program;
+        jobs[i].load_address = 0x8000;
+        jobs[i].registers = CPU::Registers{0x8000, 0xFF, 0x00, uint8_t(i), 0x00, 0x00};
+        jobs[i].cycles = 50000;
+    }
+
+    ThreadPool pool(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(RunBatch(jobs, pool));
+
+    state.SetItemsProcessed(state.iterations() * job_count);
+}
+BENCHMARK(BM_RunBatch)
+    ->DenseRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+
+// Processors running a private loop that posts to a shared mailbox once per iteration, the
+// rate is in emulated cycles per second of wall time.
+static void BM_BoardRun(benchmark::State& state)
+{
+    BoardConfig config;
+    config.processors = state.range(0);
+    config.shared = {{0x0200, 0x0300}};
+    config.quantum = state.range(1);
+
+    // loop: INX; STX $0300; LDA $0300,X; BNE loop; STX $0200; JMP loop
+    const std::vector<uint8_t> program = {0xE8, 0x8E, 0x00, 0x03, 0xBD, 0x00, 0x03, 0xD0,
+                                          0xF7, 0x8E, 0x00, 0x02, 0x4C, 0x00, 0x80};
+
+    Board board(config);
+    for (size_t index = 0; index < board.Size(); index++)
+    {
+        board.Memory(index).Load(0x8000, program);
+        board.Processor(index).SetRegisters(CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+    }
+
+    const uint64_t cycles = 1000000;
+    for (auto _ : state)
+        board.Run(cycles);
+
+    state.SetItemsProcessed(state.iterations() * cycles * board.Size());
+}
+BENCHMARK(BM_BoardRun)
+    ->ArgsProduct({benchmark::CreateDenseRange(
+                       1, std::max(2u, std::thread::hardware_concurrency()), 1),
+                   {1000, 10000}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
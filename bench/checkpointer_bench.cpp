@@ -0,0 +1,97 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "checkpointer.h"
+
+namespace
+{
+// The load loop of the execute benchmark, which writes two pages all the time.
+void LoadLoop(CPU& cpu, Mem& mem)
+{
+    // loop: INX; STX $0200; LDA $0300,X; ADC #$01; STA $0400,X; BNE loop; JMP loop
+    const std::vector<uint8_t> program = {0xE8, 0x8E, 0x00, 0x02, 0xBD, 0x00, 0x03, 0x69,
+                                          0x01, 0x9D, 0x00, 0x04, 0xD0, 0xF2, 0x4C, 0x00, 0x80};
+
+    cpu.PowerOn(mem);
+    mem.Load(0x8000, program);
+    cpu.PC = 0x8000;
+}
+
+const uint32_t cycles_per_iteration = 100000;
+
+CheckpointConfig Config(uint64_t interval)
+{
+    return {"/tmp/mos6502_checkpointer_bench_" + std::to_string(getpid()) + ".bin", interval, {}};
+}
+}  // namespace
+
+// Execution with a checkpoint persisted every argument cycles, the writes included.
+static void BM_ExecuteWithCheckpoints(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+    const CheckpointConfig config = Config(state.range(0));
+    {
+        Checkpointer checkpointer(config);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(checkpointer.Execute(cycles_per_iteration, cpu, mem));
+        checkpointer.Flush();
+
+        const Checkpointer::Stats stats = checkpointer.GetStats();
+        state.counters["written"] = stats.written;
+        state.counters["replaced"] = stats.replaced;
+    }
+    std::remove(config.path.c_str());
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * cycles_per_iteration,
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ExecuteWithCheckpoints)->Arg(100000)->Arg(1000000)->Arg(10000000)->UseRealTime();
+
+// What a checkpoint costs the emulation thread.
+static void BM_Checkpoint(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+    cpu.Execute(cycles_per_iteration, mem);
+    const CheckpointConfig config = Config(1000000);
+    {
+        Checkpointer checkpointer(config);
+        for (auto _ : state)
+            checkpointer.Checkpoint(cpu, mem);
+        checkpointer.Flush();
+    }
+    std::remove(config.path.c_str());
+}
+BENCHMARK(BM_Checkpoint);
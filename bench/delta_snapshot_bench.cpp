@@ -0,0 +1,71 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "delta_snapshot.h"
+
+namespace
+{
+// Writes one byte to each of the first pages pages.
+void Touch(Mem& memory, int pages)
+{
+    for (int page = 0; page < pages; page++)
+        memory.Write(page * Mem::page_size, page);
+}
+}  // namespace
+
+// The CPU writing to the argument's number of pages and a delta of them.
+static void BM_DeltaSnapshot(benchmark::State& state)
+{
+    CPU cpu;
+    Mem memory;
+    cpu.PowerOn(memory);
+    SnapshotChain chain(cpu, memory);
+
+    for (auto _ : state)
+    {
+        Touch(memory, state.range(0));
+        chain.Snapshot(cpu, memory);
+
+        // Bounds the chain, amortized over many deltas.
+        if (chain.Size() > 1000)
+            chain = SnapshotChain(cpu, memory);
+    }
+}
+BENCHMARK(BM_DeltaSnapshot)->Arg(1)->Arg(16)->Arg(256);
+
+// A full save state of the same machine for comparison.
+static void BM_FullSnapshot(benchmark::State& state)
+{
+    CPU cpu;
+    Mem memory;
+    cpu.PowerOn(memory);
+    Touch(memory, Mem::page_count);
+
+    SaveState save;
+    for (auto _ : state)
+        save.Capture(cpu, memory);
+}
+BENCHMARK(BM_FullSnapshot);
@@ -0,0 +1,95 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "cpu.h"
+
+namespace
+{
+// An endless loop of loads, stores and branches starting at 0x8000.
+void LoadLoop(CPU& cpu, Mem& mem)
+{
+    // loop: INX; STX $0200; LDA $0300,X; ADC #$01; STA $0400,X; BNE loop; JMP loop
+    const std::vector<uint8_t> program = {0xE8, 0x8E, 0x00, 0x02, 0xBD, 0x00, 0x03, 0x69,
+                                          0x01, 0x9D, 0x00, 0x04, 0xD0, 0xF2, 0x4C, 0x00, 0x80};
+
+    cpu.PowerOn(mem);
+    for (size_t i = 0; i < program.size(); i++)
+        mem[0x8000 + i] = program[i];
+
+    cpu.PC = 0x8000;
+}
+
+const uint32_t cycles_per_iteration = 100000;
+}  // namespace
+
+static void BM_Execute(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cpu.Execute(cycles_per_iteration, mem));
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * cycles_per_iteration,
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Execute);
+
+// Watchpoints on pages the program never touches must not slow it down.
+static void BM_ExecuteUnwatchedPages(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+    mem.AddWatchpoint(0x1000, 0x10FF, Mem::kRead | Mem::kWrite | Mem::kExecute);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cpu.Execute(cycles_per_iteration, mem));
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * cycles_per_iteration,
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ExecuteUnwatchedPages);
+
+// A watchpoint on the page the loop stores to, with a callback that never stops.
+static void BM_ExecuteWatchedPage(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+    mem.AddWatchpoint(0x0480, 0x0480, Mem::kWrite);
+    mem.SetWatchCallback([](const Mem::WatchHit&) { return false; });
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cpu.Execute(cycles_per_iteration, mem));
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * cycles_per_iteration,
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ExecuteWatchedPage);
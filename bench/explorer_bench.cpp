@@ -0,0 +1,60 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "explorer.h"
+
+namespace
+{
+// 64 rounds of adding an input of 0 to 3 to a sum, see the explorer tests: 4^64 paths through
+// 6305 distinct states.
+ExploreConfig Sum(bool depth_first)
+{
+    ExploreConfig config;
+    config.image = {0xA2, 0x40, 0xA5, 0x11, 0x18, 0x65, 0x10, 0x85, 0x11,
+                    0xA9, 0x00, 0x85, 0x10, 0xCA, 0xD0, 0xF2, 0xEA};
+    config.load_address = 0x0200;
+    config.registers = {0x0200, 0xFF, 0, 0, 0, 0};
+    config.decisions = {{0x0202, 0x0010, {0, 1, 2, 3}}};
+    config.stop_addresses = {0x0210};
+    config.depth_first = depth_first;
+    return config;
+}
+}  // namespace
+
+// Argument 1 searches depth-first, 0 breadth-first.
+static void BM_Explore(benchmark::State& state)
+{
+    Explorer explorer(Sum(state.range(0)));
+
+    Explorer::Stats stats;
+    for (auto _ : state)
+        stats = explorer.Explore();
+
+    state.counters["states"] =
+        benchmark::Counter(state.iterations() * stats.states, benchmark::Counter::kIsRate);
+    state.counters["peak_bytes"] = stats.peak_bytes;
+}
+BENCHMARK(BM_Explore)->Arg(1)->Arg(0)->UseRealTime();
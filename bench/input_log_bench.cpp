@@ -0,0 +1,163 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "input_log.h"
+
+namespace
+{
+// The load loop of the execute benchmark, which never reads an input.
+void LoadLoop(CPU& cpu, Mem& mem)
+{
+    // loop: INX; STX $0200; LDA $0300,X; ADC #$01; STA $0400,X; BNE loop; JMP loop
+    const std::vector<uint8_t> program = {0xE8, 0x8E, 0x00, 0x02, 0xBD, 0x00, 0x03, 0x69,
+                                          0x01, 0x9D, 0x00, 0x04, 0xD0, 0xF2, 0x4C, 0x00, 0x80};
+
+    cpu.PowerOn(mem);
+    mem.Load(0x8000, program);
+    cpu.PC = 0x8000;
+}
+
+// Polls a status register at $D000 and stores the data register at $D001 when it is set.
+void PollLoop(CPU& cpu, Mem& mem)
+{
+    // loop: LDA $D000; BEQ loop; LDA $D001; LDX $10; STA $0300,X; INC $10; JMP loop
+    const std::vector<uint8_t> program = {0xAD, 0x00, 0xD0, 0xF0, 0xFB, 0xAD, 0x01, 0xD0, 0xA6,
+                                          0x10, 0x9D, 0x00, 0x03, 0xE6, 0x10, 0x4C, 0x00, 0x80};
+
+    cpu.PowerOn(mem);
+    mem.Load(0x8000, program);
+    cpu.PC = 0x8000;
+}
+
+const std::vector<Mem::Range> inputs = {{0xD000, 0xD002}};
+
+// A device with data on every seventh status read.
+InputRecorder::Device Device()
+{
+    return [seed = uint64_t(1)](uint16_t address) mutable
+    {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        return uint8_t(address == 0xD000 ? (seed >> 33) % 7 == 0 : seed >> 33);
+    };
+}
+
+const uint32_t recorded_cycles = 1000000;
+
+void Replay(benchmark::State& state, void (*start)(CPU&, Mem&), const std::vector<uint8_t>& log)
+{
+    Mem mem;
+    CPU cpu;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        start(cpu, mem);
+        InputReplayer replayer(cpu, mem, log);
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(replayer.Execute(recorded_cycles));
+    }
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * recorded_cycles,
+                                                  benchmark::Counter::kIsRate);
+}
+}  // namespace
+
+// Plain execution of the load loop for comparison.
+static void BM_ExecuteWithoutReplay(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        LoadLoop(cpu, mem);
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(cpu.Execute(recorded_cycles, mem));
+    }
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * recorded_cycles,
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ExecuteWithoutReplay);
+
+// Replaying the load loop with a host write every argument cycles, 0 for none.
+static void BM_ReplayWrites(benchmark::State& state)
+{
+    const uint32_t interval = state.range(0);
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+    std::vector<uint8_t> log;
+    {
+        InputRecorder recorder(cpu, mem, {}, nullptr);
+        while (interval && cpu.cycles < recorded_cycles)
+        {
+            cpu.Execute(interval, mem);
+            recorder.Write(0x0600, {uint8_t(cpu.cycles)});
+        }
+        log = recorder.Log();
+    }
+
+    Replay(state, LoadLoop, log);
+}
+BENCHMARK(BM_ReplayWrites)->Arg(0)->Arg(10000)->Arg(1000);
+
+// Recording a program that polls an input device all the time.
+static void BM_RecordInputs(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    PollLoop(cpu, mem);
+    InputRecorder recorder(cpu, mem, inputs, Device());
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cpu.Execute(recorded_cycles, mem));
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * recorded_cycles,
+                                                  benchmark::Counter::kIsRate);
+    state.counters["reads"] = benchmark::Counter(recorder.reads, benchmark::Counter::kIsRate);
+    state.counters["bytes_per_read"] = double(recorder.Log().size()) / recorder.reads;
+}
+BENCHMARK(BM_RecordInputs);
+
+static void BM_ReplayInputs(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    PollLoop(cpu, mem);
+    std::vector<uint8_t> log;
+    {
+        InputRecorder recorder(cpu, mem, inputs, Device());
+        cpu.Execute(recorded_cycles, mem);
+        log = recorder.Log();
+    }
+
+    Replay(state, PollLoop, log);
+}
+BENCHMARK(BM_ReplayInputs);
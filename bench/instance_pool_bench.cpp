@@ -0,0 +1,135 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "instance_pool.h"
+
+namespace
+{
+const size_t live_instances = 100000;
+
+// loop: LDA $00; ADC #1; STA $00; JMP loop, in the same host page as the zero page and stack.
+const std::vector<uint8_t> program = {0xA5, 0x00, 0x69, 0x01, 0x85, 0x00, 0x4C, 0x00, 0x02};
+
+struct HeapInstance
+{
+    CPU cpu;
+    Mem memory;
+};
+
+double ResidentMegabytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    size_t size, resident;
+    statm >> size >> resident;
+    return double(resident) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+template <typename Instance>
+void Start(Instance& instance)
+{
+    instance.memory.Load(0x0200, program);
+    instance.cpu.SetRegisters(CPU::Registers{0x0200, 0xFF, 0, 0, 0, 0});
+}
+
+// Runs a few instructions on every live instance, so each visit touches a different 64 KB
+// image and its CPU and Mem objects.
+template <typename Instance>
+void Visit(benchmark::State& state, const std::vector<Instance*>& instances, double resident)
+{
+    for (auto _ : state)
+    {
+        for (Instance* instance : instances)
+            instance->cpu.Execute(20, instance->memory);
+    }
+
+    state.SetItemsProcessed(state.iterations() * instances.size());
+    state.counters["resident_MB"] = resident;
+}
+}  // namespace
+
+static void BM_HeapAcquireRelease(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        auto instance = std::make_unique<HeapInstance>();
+        instance->memory[0] = 1;
+        benchmark::DoNotOptimize(instance.get());
+    }
+}
+BENCHMARK(BM_HeapAcquireRelease);
+
+static void BM_PoolAcquireRelease(benchmark::State& state)
+{
+    InstancePool pool({1024});
+    for (auto _ : state)
+    {
+        InstancePool::Instance* instance = pool.Acquire();
+        instance->memory[0] = 1;
+        benchmark::DoNotOptimize(instance);
+        pool.Release(instance);
+    }
+}
+BENCHMARK(BM_PoolAcquireRelease);
+
+// 100k live instances, each with its own CPU object and mapping from the default allocator.
+static void BM_LiveHeap(benchmark::State& state)
+{
+    const double before = ResidentMegabytes();
+    std::vector<std::unique_ptr<HeapInstance>> owned;
+    std::vector<HeapInstance*> instances;
+    for (size_t i = 0; i < live_instances; i++)
+    {
+        owned.push_back(std::make_unique<HeapInstance>());
+        instances.push_back(owned.back().get());
+        Start(*instances.back());
+    }
+
+    Visit(state, instances, ResidentMegabytes() - before);
+}
+BENCHMARK(BM_LiveHeap)->Unit(benchmark::kMillisecond);
+
+// The same instances from the pool arena, the argument enables huge pages.
+static void BM_LivePool(benchmark::State& state)
+{
+    const double before = ResidentMegabytes();
+    InstancePool pool({live_instances, state.range(0) != 0});
+    std::vector<InstancePool::Instance*> instances;
+    for (size_t i = 0; i < live_instances; i++)
+    {
+        instances.push_back(pool.Acquire());
+        Start(*instances.back());
+    }
+
+    Visit(state, instances, ResidentMegabytes() - before);
+    state.counters["huge_pages"] = pool.HugePages();
+}
+BENCHMARK(BM_LivePool)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,90 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "lockstep.h"
+
+namespace
+{
+// loop: INX; STX $0200; LDA $0300,X; BNE loop; JMP loop
+const std::vector<uint8_t> program = {0xE8, 0x8E, 0x00, 0x02, 0xBD, 0x00, 0x03,
+                                      0xD0, 0xF7, 0x4C, 0x00, 0x80};
+
+const uint32_t slice_cycles = 10000;
+
+CPU::Registers LaneRegisters(unsigned lane)
+{
+    return CPU::Registers{0x8000, 0xFF, 0x00, uint8_t(lane * 16), 0x00, 0x00};
+}
+}  // namespace
+
+// Sixteen CPUs run the same loop one after another, the rate is in emulated cycles per second.
+static void BM_ScalarCPUs(benchmark::State& state)
+{
+    std::vector<Mem> mems(Lockstep::max_lanes);
+    std::vector<CPU> cpus(Lockstep::max_lanes);
+    for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+    {
+        mems[lane].Load(0x8000, program);
+        cpus[lane].SetRegisters(LaneRegisters(lane));
+    }
+
+    uint64_t cycles = 0;
+    for (auto _ : state)
+    {
+        for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+            cycles += cpus[lane].Execute(slice_cycles, mems[lane]);
+    }
+
+    state.SetItemsProcessed(cycles);
+}
+BENCHMARK(BM_ScalarCPUs);
+
+// The same sixteen CPUs as lanes of one Lockstep.
+static void BM_Lockstep(benchmark::State& state)
+{
+    std::vector<Mem> mems(Lockstep::max_lanes);
+    Lockstep lockstep;
+    for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+    {
+        mems[lane].Load(0x8000, program);
+        lockstep.SetLane(lane, &mems[lane], LaneRegisters(lane));
+    }
+
+    uint64_t cycles = 0;
+    for (auto _ : state)
+    {
+        lockstep.Execute(slice_cycles);
+        for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+            cycles += lockstep.Cycles(lane);
+    }
+
+    state.SetItemsProcessed(cycles);
+    state.counters["lanes_per_dispatch"] =
+        double(lockstep.lane_instructions) / double(lockstep.dispatches);
+}
+BENCHMARK(BM_Lockstep);
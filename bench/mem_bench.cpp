@@ -0,0 +1,163 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "cpu.h"
+
+namespace
+{
+// Fills every page with a pattern so no page can be skipped as untouched.
+void FillPattern(Mem& mem)
+{
+    std::vector<uint8_t> image(Mem::max_size);
+    for (size_t i = 0; i < image.size(); i++)
+        image[i] = i * 7;
+
+    mem.Load(0, image);
+}
+}  // namespace
+
+static void BM_Load(benchmark::State& state)
+{
+    Mem mem;
+    const std::vector<uint8_t> image(Mem::max_size, 0x42);
+
+    for (auto _ : state)
+        mem.Load(0, image);
+
+    state.SetBytesProcessed(state.iterations() * Mem::max_size);
+}
+BENCHMARK(BM_Load);
+
+static void BM_Fill(benchmark::State& state)
+{
+    Mem mem;
+
+    for (auto _ : state)
+        mem.Fill(0, Mem::max_size, 0x42);
+
+    state.SetBytesProcessed(state.iterations() * Mem::max_size);
+}
+BENCHMARK(BM_Fill);
+
+static void BM_Compare(benchmark::State& state)
+{
+    Mem a, b;
+    FillPattern(a);
+    FillPattern(b);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.Compare(b));
+
+    state.SetBytesProcessed(state.iterations() * Mem::max_size);
+}
+BENCHMARK(BM_Compare);
+
+// Diff of two fully written 64 KB images with the given number of scattered differences.
+static void BM_Diff(benchmark::State& state)
+{
+    Mem a, b;
+    FillPattern(a);
+    FillPattern(b);
+
+    for (int64_t i = 0; i < state.range(0); i++)
+        b[(i * 4099) % Mem::max_size] ^= 0xFF;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.Diff(b));
+
+    state.SetBytesProcessed(state.iterations() * Mem::max_size);
+}
+BENCHMARK(BM_Diff)->Arg(0)->Arg(16)->Arg(256);
+
+// Diff of two sparsely written images, untouched pages are skipped.
+static void BM_DiffSparse(benchmark::State& state)
+{
+    Mem a, b;
+    a.Fill(0x0200, 0x600, 0x11);
+    b.Fill(0x0200, 0x600, 0x11);
+    b[0x0345] = 0x22;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.Diff(b));
+}
+BENCHMARK(BM_DiffSparse);
+
+// CPU stores on the fast path, which update the hash.
+static void BM_Write(benchmark::State& state)
+{
+    Mem mem;
+    FillPattern(mem);
+    mem.Hash();
+
+    uint16_t address = 0;
+    for (auto _ : state)
+    {
+        for (uint32_t i = 0; i < 1024; i++)
+        {
+            mem.Write(address, i);
+            address += 97;
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_Write);
+
+// The hash after a CPU store, without host writes to fold in.
+static void BM_Hash(benchmark::State& state)
+{
+    Mem mem;
+    FillPattern(mem);
+
+    uint16_t address = 0;
+    for (auto _ : state)
+    {
+        mem.Write(address, address);
+        address += 97;
+        benchmark::DoNotOptimize(mem.Hash());
+    }
+}
+BENCHMARK(BM_Hash);
+
+// The hash after a host write, which takes its page out and adds it back.
+static void BM_HashHostWrite(benchmark::State& state)
+{
+    Mem mem;
+    FillPattern(mem);
+
+    uint16_t address = 0;
+    for (auto _ : state)
+    {
+        mem[address] = address;
+        address += 97;
+        benchmark::DoNotOptimize(mem.Hash());
+    }
+}
+BENCHMARK(BM_HashHostWrite);
@@ -0,0 +1,93 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "cpu.h"
+
+// Reset only reloads the CPU state, it never touches memory.
+static void BM_Reset(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    cpu.PowerOn(mem);
+
+    for (auto _ : state)
+    {
+        cpu.Reset(mem);
+        benchmark::DoNotOptimize(cpu.PC);
+    }
+}
+BENCHMARK(BM_Reset);
+
+// Power-on cost as a function of the number of pages written since the last power-on. With
+// all 256 pages written it clears the full 64 KB.
+static void BM_PowerOn(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    cpu.PowerOn(mem);
+
+    const uint32_t pages = state.range(0);
+    for (auto _ : state)
+    {
+        for (uint32_t page = 0; page < pages; page++)
+            mem.Write(page * Mem::page_size, 0xFF);
+
+        cpu.PowerOn(mem);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PowerOn)->RangeMultiplier(4)->Range(1, Mem::page_count);
+
+// A test-vector loop: load a short program, run it and power the machine back on.
+static void BM_ResetPerIteration(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    cpu.PowerOn(mem);
+
+    for (auto _ : state)
+    {
+        // LDX #$10; loop: STA $0200,X; DEX; BNE loop
+        mem[0xFFFC] = 0x00;
+        mem[0xFFFD] = 0x80;
+        mem[0x8000] = 0xA2;
+        mem[0x8001] = 0x10;
+        mem[0x8002] = 0x9D;
+        mem[0x8003] = 0x00;
+        mem[0x8004] = 0x02;
+        mem[0x8005] = 0xCA;
+        mem[0x8006] = 0xD0;
+        mem[0x8007] = 0xFA;
+
+        cpu.Reset(mem);
+        cpu.Execute(2 + 16 * (5 + 2 + 3) - 1, mem);
+        cpu.PowerOn(mem);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ResetPerIteration);
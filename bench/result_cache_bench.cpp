@@ -0,0 +1,122 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "result_cache.h"
+
+namespace
+{
+// The load loop of the execute benchmark, which writes two pages all the time.
+void LoadLoop(CPU& cpu, Mem& mem)
+{
+    // loop: INX; STX $0200; LDA $0300,X; ADC #$01; STA $0400,X; BNE loop; JMP loop
+    const std::vector<uint8_t> program = {0xE8, 0x8E, 0x00, 0x02, 0xBD, 0x00, 0x03, 0x69,
+                                          0x01, 0x9D, 0x00, 0x04, 0xD0, 0xF2, 0x4C, 0x00, 0x80};
+
+    cpu.PowerOn(mem);
+    mem.Load(0x8000, program);
+    cpu.PC = 0x8000;
+}
+
+ResultCacheConfig Config()
+{
+    ResultCacheConfig config;
+    config.directory = "/tmp/mos6502_result_cache_bench_" + std::to_string(getpid());
+    return config;
+}
+
+void RemoveDirectory(const std::string& path)
+{
+    if (DIR* directory = opendir(path.c_str()))
+    {
+        while (const dirent* item = readdir(directory))
+        {
+            if (item->d_name[0] != '.')
+                std::remove((path + "/" + item->d_name).c_str());
+        }
+        closedir(directory);
+    }
+    rmdir(path.c_str());
+}
+}  // namespace
+
+// A job of argument cycles from power-on, executed directly.
+static void BM_RunUncached(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    for (auto _ : state)
+    {
+        LoadLoop(cpu, mem);
+        benchmark::DoNotOptimize(cpu.Execute(state.range(0), mem));
+    }
+}
+BENCHMARK(BM_RunUncached)->Arg(100000)->Arg(10000000);
+
+// The same job through the cache, every run after the first one a hit.
+static void BM_RunCached(benchmark::State& state)
+{
+    const ResultCacheConfig config = Config();
+    {
+        ResultCache cache(config);
+        Mem mem;
+        CPU cpu;
+        for (auto _ : state)
+        {
+            LoadLoop(cpu, mem);
+            benchmark::DoNotOptimize(cache.Execute(state.range(0), cpu, mem));
+        }
+
+        state.counters["entry_bytes"] = cache.GetStats().bytes;
+    }
+    RemoveDirectory(config.directory);
+}
+BENCHMARK(BM_RunCached)->Arg(100000)->Arg(10000000);
+
+// A miss: the run, then compressing and writing its entry.
+static void BM_RunMiss(benchmark::State& state)
+{
+    const ResultCacheConfig config = Config();
+    {
+        ResultCache cache(config);
+        Mem mem;
+        CPU cpu;
+        uint64_t parameters = 0;
+        for (auto _ : state)
+        {
+            LoadLoop(cpu, mem);
+            benchmark::DoNotOptimize(cache.Execute(state.range(0), cpu, mem, parameters++));
+        }
+    }
+    RemoveDirectory(config.directory);
+}
+BENCHMARK(BM_RunMiss)->Arg(100000);
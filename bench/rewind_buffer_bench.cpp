@@ -0,0 +1,108 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "rewind_buffer.h"
+
+namespace
+{
+// The load loop of the execute benchmark, which writes two pages all the time.
+void LoadLoop(CPU& cpu, Mem& mem)
+{
+    // loop: INX; STX $0200; LDA $0300,X; ADC #$01; STA $0400,X; BNE loop; JMP loop
+    const std::vector<uint8_t> program = {0xE8, 0x8E, 0x00, 0x02, 0xBD, 0x00, 0x03, 0x69,
+                                          0x01, 0x9D, 0x00, 0x04, 0xD0, 0xF2, 0x4C, 0x00, 0x80};
+
+    cpu.PowerOn(mem);
+    mem.Load(0x8000, program);
+    cpu.PC = 0x8000;
+}
+
+const uint32_t cycles_per_iteration = 100000;
+
+// Emulated clock rate for the history per second, that of the original 6502 machines.
+const double clock_rate = 1e6;
+}  // namespace
+
+// Plain execution for comparison.
+static void BM_ExecuteWithoutRewind(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cpu.Execute(cycles_per_iteration, mem));
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * cycles_per_iteration,
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ExecuteWithoutRewind);
+
+// Execution with a checkpoint every argument cycles, keeping the last 600.
+static void BM_ExecuteWithRewind(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+    RewindBuffer buffer({static_cast<uint64_t>(state.range(0)), 600}, cpu, mem);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(buffer.Execute(cycles_per_iteration, cpu, mem));
+
+    state.counters["cycles"] = benchmark::Counter(state.iterations() * cycles_per_iteration,
+                                                  benchmark::Counter::kIsRate);
+
+    const double history = buffer.Cycle(buffer.Size() - 1) - buffer.Cycle(0);
+    state.counters["bytes_per_second"] = buffer.Bytes() * clock_rate / history;
+}
+BENCHMARK(BM_ExecuteWithRewind)->Arg(1000)->Arg(10000)->Arg(100000);
+
+// Returning to a random cycle of a full buffer with a checkpoint every 10000 cycles.
+static void BM_Seek(benchmark::State& state)
+{
+    Mem mem;
+    CPU cpu;
+    LoadLoop(cpu, mem);
+    RewindBuffer buffer({10000, 600}, cpu, mem);
+    buffer.Execute(600 * 10000, cpu, mem);
+
+    uint64_t seed = 1;
+    for (auto _ : state)
+    {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        const uint64_t oldest = buffer.Cycle(0);
+        const uint64_t target = oldest + (seed >> 33) % (cpu.cycles - oldest);
+        buffer.Seek(target, cpu, mem);
+
+        // Refills the history the seek discarded, outside of the measurement.
+        state.PauseTiming();
+        buffer.Execute(600 * 10000 - (cpu.cycles - buffer.Cycle(0)), cpu, mem);
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_Seek);
@@ -0,0 +1,135 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "rom_image.h"
+
+namespace
+{
+const size_t instances = 10000;
+const uint16_t rom_address = 0x8000;
+const size_t rom_size = 0x8000;
+
+struct Instance
+{
+    CPU cpu;
+    Mem memory;
+};
+
+// 32 KB ROM starting with loop: LDA $00; ADC #1; STA $00; JMP loop.
+std::vector<uint8_t> MakeRom()
+{
+    std::vector<uint8_t> rom(rom_size, 0xEA);
+    const std::vector<uint8_t> program = {0xA5, 0x00, 0x69, 0x01, 0x85, 0x00, 0x4C, 0x00, 0x80};
+    std::copy(program.begin(), program.end(), rom.begin());
+    return rom;
+}
+
+// Proportional set size, which charges a page shared by n mappings 1/n to each of them.
+double PssKilobytes()
+{
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string key;
+    while (rollup >> key)
+    {
+        size_t value;
+        if (key == "Pss:" && rollup >> value)
+            return value;
+    }
+    return 0;
+}
+
+// Runs every instance after reading each host page of its ROM, as a system that uses all of
+// its ROM would.
+void Measure(benchmark::State& state, std::vector<std::unique_ptr<Instance>>& live, double before)
+{
+    const size_t host_page_size = sysconf(_SC_PAGESIZE);
+    for (auto& instance : live)
+    {
+        uint8_t sum = 0;
+        for (size_t offset = 0; offset < rom_size; offset += host_page_size)
+            sum += instance->memory[rom_address + offset];
+        benchmark::DoNotOptimize(sum);
+
+        instance->cpu.SetRegisters(CPU::Registers{rom_address, 0xFF, 0, 0, 0, 0});
+        instance->cpu.Execute(20, instance->memory);
+    }
+
+    const double per_instance = (PssKilobytes() - before) / live.size();
+    for (auto _ : state)
+    {
+        for (auto& instance : live)
+            instance->cpu.Execute(20, instance->memory);
+    }
+
+    state.SetItemsProcessed(state.iterations() * live.size());
+    state.counters["KB_per_instance"] = per_instance;
+    state.counters["instances_per_GB"] = 1024 * 1024 / per_instance;
+}
+}  // namespace
+
+// Every instance loads its own copy of the ROM.
+static void BM_RomCopied(benchmark::State& state)
+{
+    const std::vector<uint8_t> rom = MakeRom();
+    const double before = PssKilobytes();
+
+    std::vector<std::unique_ptr<Instance>> live;
+    for (size_t i = 0; i < instances; i++)
+    {
+        live.push_back(std::make_unique<Instance>());
+        live.back()->memory.Load(rom_address, rom);
+        live.back()->memory.Protect(rom_address, rom_size);
+    }
+
+    Measure(state, live, before);
+}
+BENCHMARK(BM_RomCopied)->Unit(benchmark::kMillisecond);
+
+// Every instance maps the same ROM image.
+static void BM_RomShared(benchmark::State& state)
+{
+    const double before = PssKilobytes();
+    const RomImage rom(MakeRom());
+
+    std::vector<std::unique_ptr<Instance>> live;
+    for (size_t i = 0; i < instances; i++)
+    {
+        live.push_back(std::make_unique<Instance>());
+        live.back()->memory.MapRom(rom, rom_address);
+    }
+
+    Measure(state, live, before);
+}
+BENCHMARK(BM_RomShared)->Unit(benchmark::kMillisecond);
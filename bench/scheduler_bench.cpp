@@ -0,0 +1,107 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "scheduler.h"
+
+namespace
+{
+struct Machine
+{
+    CPU cpu;
+    Mem memory;
+};
+
+// loop: INX; BNE loop; INY; JMP loop
+const std::vector<uint8_t> counter = {0xE8, 0xD0, 0xFD, 0xC8, 0x4C, 0x00, 0x80};
+
+// loop: LDA $D000; BEQ loop; JMP loop
+const std::vector<uint8_t> poller = {0xAD, 0x00, 0xD0, 0xF0, 0xFB, 0x4C, 0x00, 0x80};
+
+const size_t active = 64;
+}  // namespace
+
+// Cycles per second of 64 busy instances next to the argument's many parked ones, which should
+// cost nothing. The second argument is the slice.
+static void BM_SchedulerThroughput(benchmark::State& state)
+{
+    std::vector<std::unique_ptr<Machine>> machines;
+    for (size_t i = 0; i < active + state.range(0); i++)
+    {
+        machines.push_back(std::make_unique<Machine>());
+        machines.back()->memory.Load(0x8000, i < active ? counter : poller);
+        machines.back()->cpu.SetRegisters(CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+    }
+
+    SchedulerConfig config;
+    config.slice = state.range(1);
+    Scheduler scheduler(config);
+
+    std::vector<Scheduler::Id> ids;
+    for (size_t i = 0; i < machines.size(); i++)
+    {
+        Scheduler::Options options;
+        if (i >= active)
+            options.idle_addresses = {0x8000};
+        ids.push_back(scheduler.Add(machines[i]->cpu, machines[i]->memory, options));
+    }
+
+    for (size_t i = active; i < ids.size(); i++)
+        scheduler.WaitParked(ids[i], std::chrono::seconds(10));
+
+    auto cycles = [&]
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < active; i++)
+            total += scheduler.GetStats(ids[i]).cycles;
+        return total;
+    };
+
+    const uint64_t before = cycles();
+    for (auto _ : state)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    state.SetItemsProcessed(cycles() - before);
+
+    double latency = 0;
+    for (size_t i = 0; i < active; i++)
+    {
+        const Scheduler::Stats stats = scheduler.GetStats(ids[i]);
+        latency += std::chrono::duration<double, std::micro>(stats.total_latency).count() /
+                   stats.slices;
+    }
+    state.counters["latency_us"] = latency / active;
+}
+BENCHMARK(BM_SchedulerThroughput)
+    ->Args({0, 10000})
+    ->Args({10000, 10000})
+    ->Args({0, 1000})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,197 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session_server.h"
+
+namespace
+{
+// loop: INX; BNE loop; INY; JMP loop
+const std::vector<uint8_t> program = {0xE8, 0xD0, 0xFD, 0xC8, 0x4C, 0x00, 0x80};
+
+// Sessions driven by one request.
+const size_t batch_size = 64;
+
+size_t ResidentBytes()
+{
+    size_t pages = 0;
+    size_t resident = 0;
+    if (FILE* file = std::fopen("/proc/self/statm", "r"))
+    {
+        if (std::fscanf(file, "%zu %zu", &pages, &resident) != 2)
+            resident = 0;
+        std::fclose(file);
+    }
+
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// Creates a session holding the program, 2 KiB of random data and 1 KiB of text.
+uint32_t CreateInteractive(SessionServer& server, uint64_t& seed)
+{
+    SessionRequest create;
+    create.Create();
+    std::vector<uint8_t> payload = create.Payload();
+    const uint32_t session = SessionResponse(create, server.Handle(payload.data(),
+                                                                   payload.size()))[0].session;
+
+    std::vector<uint8_t> data(2048);
+    for (uint8_t& byte : data)
+    {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        byte = seed >> 56;
+    }
+
+    std::vector<uint8_t> text(1024);
+    for (size_t i = 0; i < text.size(); i++)
+        text[i] = "the quick brown fox jumps over the lazy dog "[i % 44];
+
+    SessionRequest request;
+    request.Write(session, 0x8000, program);
+    request.Write(session, 0x0400, data);
+    request.Write(session, 0x1000, text);
+    request.SetRegisters(session, CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+    request.Run(session, 10000);
+    payload = request.Payload();
+    server.Handle(payload.data(), payload.size());
+    return session;
+}
+}  // namespace
+
+// Round trips over the socket, each running 100 cycles on the next batch of sessions out of
+// the argument's many live sessions.
+static void BM_SessionRoundTrip(benchmark::State& state)
+{
+    ServerConfig config;
+    config.socket_path = "/tmp/mos6502_session_bench_" + std::to_string(getpid()) + ".sock";
+    config.max_sessions = state.range(0);
+    SessionServer server(config);
+    std::thread loop([&server] { server.Serve(); });
+
+    {
+        SessionClient client(config.socket_path);
+        std::vector<uint32_t> sessions;
+        while (sessions.size() < config.max_sessions)
+        {
+            SessionRequest request;
+            for (size_t i = 0; i < batch_size; i++)
+                request.Create();
+
+            SessionResponse response = client.Call(request);
+            SessionRequest start;
+            for (size_t i = 0; i < batch_size; i++)
+            {
+                sessions.push_back(response[i].session);
+                start.Write(sessions.back(), 0x8000, program);
+                start.SetRegisters(sessions.back(), CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+            }
+            client.Call(start);
+        }
+
+        size_t next = 0;
+        for (auto _ : state)
+        {
+            SessionRequest request;
+            for (size_t i = 0; i < batch_size; i++)
+            {
+                request.Run(sessions[next], 100);
+                next = (next + 1) % sessions.size();
+            }
+            benchmark::DoNotOptimize(client.Call(request));
+        }
+    }
+
+    server.Stop();
+    loop.join();
+    state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_SessionRoundTrip)->Arg(64)->Arg(1024)->Arg(4096)->UseRealTime();
+
+// Hibernating every one of the argument's many sessions, with the resident memory per session
+// while they are awake and while they hibernate.
+static void BM_Hibernate(benchmark::State& state)
+{
+    const size_t before = ResidentBytes();
+    ServerConfig config;
+    config.max_sessions = state.range(0);
+    SessionServer server(config);
+
+    uint64_t seed = 1;
+    std::vector<uint32_t> sessions;
+    while (sessions.size() < config.max_sessions)
+        sessions.push_back(CreateInteractive(server, seed));
+    const size_t awake = ResidentBytes();
+
+    SessionRequest wake;
+    for (uint32_t session : sessions)
+        wake.GetRegisters(session);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        server.Handle(wake.Payload().data(), wake.Payload().size());
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(server.HibernateIdle(std::chrono::milliseconds(0)));
+    }
+
+    const double count = sessions.size();
+    state.counters["awake_bytes"] = (awake - before) / count;
+    state.counters["hibernated_bytes"] = (ResidentBytes() - before) / count;
+    state.counters["snapshot_bytes"] = server.HibernatedBytes() / count;
+    state.SetItemsProcessed(state.iterations() * sessions.size());
+}
+BENCHMARK(BM_Hibernate)->Arg(1024);
+
+// Latency of a request to an awake session, argument 0, or to a hibernated one it wakes.
+static void BM_Wake(benchmark::State& state)
+{
+    SessionServer server({});
+    uint64_t seed = 1;
+    const uint32_t session = CreateInteractive(server, seed);
+
+    SessionRequest request;
+    request.GetRegisters(session);
+    for (auto _ : state)
+    {
+        if (state.range(0))
+        {
+            state.PauseTiming();
+            server.Hibernate(session);
+            state.ResumeTiming();
+        }
+
+        benchmark::DoNotOptimize(server.Handle(request.Payload().data(), request.Payload().size()));
+    }
+}
+BENCHMARK(BM_Wake)->Arg(0)->Arg(1);
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "save_state.h"
+#include "snapshot_codec.h"
+
+namespace
+{
+uint64_t seed = 1;
+
+uint8_t Random()
+{
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    return seed >> 56;
+}
+
+// A typical checkpoint: 16 KiB of ROM built from repeated routines with varying operands,
+// 4 KiB of random RAM, 2 KiB of text and zeros elsewhere.
+void LoadRom(CPU& cpu, Mem& memory)
+{
+    cpu.PowerOn(memory);
+
+    std::vector<std::vector<uint8_t>> routines(32, std::vector<uint8_t>(64));
+    for (std::vector<uint8_t>& routine : routines)
+        for (uint8_t& byte : routine)
+            byte = Random();
+
+    for (uint32_t address = 0xC000; address < Mem::max_size; address += 64)
+    {
+        std::vector<uint8_t> routine = routines[Random() % routines.size()];
+        routine[Random() % 64] = Random();
+        memory.Load(address, routine);
+    }
+}
+
+void Run(Mem& memory)
+{
+    for (uint32_t address = 0x0400; address < 0x1400; address++)
+        memory[address] = Random();
+    for (uint32_t address = 0x2000; address < 0x2800; address++)
+        memory[address] = "the quick brown fox jumps over the lazy dog "[address % 44];
+    memory.Fill(0x0100, 0x100, 0x5A);
+}
+
+// The codec for the argument: 0 without a reference image, 1 with the ROM as loaded.
+std::unique_ptr<SnapshotCodec> Codec(const benchmark::State& state, CPU& cpu, Mem& memory)
+{
+    LoadRom(cpu, memory);
+    std::unique_ptr<SnapshotCodec> codec =
+        state.range(0) ? std::make_unique<SnapshotCodec>(SaveState(cpu, memory).Memory())
+                       : std::make_unique<SnapshotCodec>();
+    Run(memory);
+    return codec;
+}
+}  // namespace
+
+// Throughput in bytes of address space, compared to a SaveState of the same machine.
+static void BM_Compress(benchmark::State& state)
+{
+    CPU cpu;
+    Mem memory;
+    const std::unique_ptr<SnapshotCodec> codec = Codec(state, cpu, memory);
+
+    size_t size = 0;
+    for (auto _ : state)
+        size = codec->Compress(cpu, memory).size();
+
+    state.SetBytesProcessed(state.iterations() * Mem::max_size);
+    state.counters["bytes"] = size;
+    state.counters["ratio"] = double(SaveState::size) / size;
+}
+BENCHMARK(BM_Compress)->Arg(0)->Arg(1);
+
+static void BM_Decompress(benchmark::State& state)
+{
+    CPU cpu;
+    Mem memory;
+    const std::unique_ptr<SnapshotCodec> codec = Codec(state, cpu, memory);
+    const std::vector<uint8_t> bytes = codec->Compress(cpu, memory);
+
+    CPU restored_cpu;
+    Mem restored_memory;
+    for (auto _ : state)
+    {
+        codec->Decompress(bytes, restored_cpu, restored_memory);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * Mem::max_size);
+}
+BENCHMARK(BM_Decompress)->Arg(0)->Arg(1);
@@ -0,0 +1,103 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ALU_H
+#define ALU_H
+
+#include <cstdint>
+
+// The arithmetic of the instructions as plain functions of their inputs, shared by CPU and
+// Lockstep so both engines compute the same results and flags. Z and N of a result value are
+// set by the caller, the functions return the flags that depend on more than the value.
+namespace alu
+{
+struct Sum
+{
+    uint8_t value;
+    bool carry;
+    bool overflow;
+};
+
+struct Shift
+{
+    uint8_t value;
+    bool carry;
+};
+
+struct Flags
+{
+    bool carry;
+    bool zero;
+    bool overflow;
+    bool negative;
+};
+
+// ADC in binary mode, SBC adds the complement of its operand.
+inline Sum AddWithCarry(uint8_t a, uint8_t operand, bool carry)
+{
+    const bool sign_bits_match = !(operand & 0b10000000) ^ (a & 0b10000000);
+
+    const uint16_t sum = a + carry + operand;
+    const uint8_t value = sum & 0xFF;
+
+    // The addition overflowed if the sign bit of the operand and the pre-addition accumulator
+    // matched and if the sign bit of the pre-op accumulator and the result differ.
+    return {value, sum > 0xFF, sign_bits_match && ((value ^ operand) & 0b10000000)};
+}
+
+// CMP, CPX and CPY, which leave overflow alone.
+inline Flags Compare(uint8_t reg, uint8_t operand)
+{
+    return {reg >= operand, reg == operand, false, ((reg - operand) & 0b10000000) != 0};
+}
+
+// BIT, which leaves carry alone.
+inline Flags Bit(uint8_t a, uint8_t operand)
+{
+    const uint8_t result = a & operand;
+    return {false, result == 0, (result & 0b01000000) != 0, (result & 0b10000000) != 0};
+}
+
+inline Shift ShiftLeft(uint8_t operand)
+{
+    return {static_cast<uint8_t>(operand << 1), (operand & 0b10000000) != 0};
+}
+
+inline Shift ShiftRight(uint8_t operand)
+{
+    return {static_cast<uint8_t>(operand >> 1), (operand & 0b00000001) != 0};
+}
+
+inline Shift RotateLeft(uint8_t operand, bool carry)
+{
+    return {static_cast<uint8_t>((operand << 1) | carry), (operand & 0b10000000) != 0};
+}
+
+inline Shift RotateRight(uint8_t operand, bool carry)
+{
+    return {static_cast<uint8_t>((operand >> 1) | (carry << 7)), (operand & 0b00000001) != 0};
+}
+}  // namespace alu
+
+#endif  // ALU_H
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+
+// An independent CPU and memory run: the machine is powered on, the image loaded and the
+// program executed until the cycle budget is used or the PC reaches a stop address.
+struct BatchJob
+{
+    // Image copied to load_address after power-on, jobs can share one image.
+    std::shared_ptr<const std::vector<uint8_t>> image;
+    uint16_t load_address = 0;
+
+    // Initial registers, without them the CPU starts from the reset vector.
+    std::optional<CPU::Registers> registers;
+
+    uint32_t cycles = 0;
+    std::vector<uint16_t> stop_addresses;
+};
+
+struct BatchResult
+{
+    CPU::Registers registers = {};
+    uint32_t cycles = 0;
+
+    // True when the PC reached one of the stop addresses.
+    bool stopped = false;
+
+    // The message of the exception that ended the job, such as an illegal opcode or an image
+    // that does not fit the address space, or of one thrown by the inspector.
+    std::string error;
+};
+
+// Called on the worker thread with the final machine state of every job.
+using BatchInspector = std::function<void(size_t job, const CPU& cpu, const Mem& memory)>;
+
+// Runs the jobs on the pool and returns their results in the same order. Each worker reuses
+// one CPU and memory for all of its jobs. With a cache, a job repeating an earlier one with the
+// same image, registers, budget and stop addresses gets its result without executing, and the
+// inspector still sees its final state.
+std::vector<BatchResult> RunBatch(const std::vector<BatchJob>& jobs, ThreadPool& pool,
+                                  const BatchInspector& inspect = nullptr,
+                                  ResultCache* cache = nullptr);
+
+#endif  // BATCH_H
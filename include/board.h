@@ -0,0 +1,120 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpu.h"
+#include "thread_pool.h"
+
+struct BoardConfig
+{
+    size_t processors = 2;
+
+    // Address ranges every processor sees as one shared RAM, such as mailboxes and latches.
+    std::vector<Mem::Range> shared;
+
+    // Cycles each processor runs between synchronizations.
+    uint32_t quantum = 1000;
+
+    // Ends a processor's quantum right after it touches a shared address, so the exchange
+    // happens at the next synchronization instead of the end of the quantum.
+    bool sync_on_shared_access = false;
+
+    // Worker threads, 0 runs every processor on its own thread.
+    unsigned threads = 0;
+};
+
+// Several CPUs, each with its own memory, connected through shared address ranges. Processors
+// run their quanta in parallel. Shared writes are visible to the writer at once and to the
+// others at the next synchronization, when they are applied to every memory in processor
+// order, so a later processor wins a conflicting write. Results only depend on the quantum and
+// sync_on_shared_access, not on the number of threads, how Run calls are split at multiples
+// of the quantum or where watchpoints of the caller stop them.
+class Board
+{
+   public:
+    explicit Board(const BoardConfig& config);
+
+    size_t Size() const;
+
+    // The board uses the watch callbacks of these memories, other watchpoints stop Run. Host
+    // writes are not shared, shared contents are loaded into every memory.
+    CPU& Processor(size_t index);
+    Mem& Memory(size_t index);
+
+    // Powers on every processor.
+    void PowerOn();
+
+    // Runs until every processor is at least cycles past the one furthest behind, or stopped on
+    // an error. Returns true early when a processor stopped on a watchpoint of the caller, the
+    // next Run continues from there.
+    bool Run(uint64_t cycles);
+
+    // Whether the processor stopped on a watchpoint of the caller in the last Run.
+    bool Stopped(size_t index) const;
+
+    uint64_t Cycles(size_t index) const;
+
+    // The message of the exception that halted a processor, such as an illegal opcode.
+    const std::string& Error(size_t index) const;
+
+    // Synchronizations so far.
+    uint64_t rounds = 0;
+
+   private:
+    struct Node
+    {
+        CPU cpu;
+        Mem memory;
+        uint64_t clock = 0;
+        std::string error;
+
+        // Still running in the current pass, which a watchpoint of the caller interrupted.
+        bool in_pass = false;
+        bool watch_stopped = false;
+
+        std::vector<int> shared_watchpoints;
+        std::vector<uint16_t> shared_writes;
+        std::vector<std::pair<uint16_t, uint8_t>> pending;
+    };
+
+    void RunQuantum(Node& node);
+    void Synchronize();
+
+    BoardConfig config;
+    std::vector<std::unique_ptr<Node>> nodes;
+    ThreadPool pool;
+
+    // Board cycle every processor runs to in the current round.
+    uint64_t boundary = 0;
+};
+
+#endif  // BOARD_H
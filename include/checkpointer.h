@@ -0,0 +1,128 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CHECKPOINTER_H
+#define CHECKPOINTER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "snapshot_codec.h"
+
+struct CheckpointConfig
+{
+    // File holding the latest checkpoint. Each one is written to path + ".tmp", synced and
+    // renamed over it, so a crash at any point leaves a complete checkpoint behind.
+    std::string path;
+
+    // Machine cycles between checkpoints.
+    uint64_t interval = 100000000;
+
+    // Reference image for the SnapshotCodec, empty for none. Resuming needs the same one.
+    std::vector<uint8_t> reference;
+};
+
+// Periodic checkpoints of a long run, persisted in the background, and resuming from the
+// latest one after a crash. Taking a checkpoint only copies the machine into a spare slot; a
+// writer thread compresses and writes it. While the writer is busy, a newer checkpoint
+// replaces the one waiting for it, so the emulation thread never waits for the disk.
+// Checkpoints are due at the same instruction boundaries in a resumed run as in the original
+// one, and execution is deterministic, so the resumed run continues with identical results.
+class Checkpointer
+{
+   public:
+    // Throws std::invalid_argument for an empty path or a zero interval.
+    explicit Checkpointer(const CheckpointConfig& config);
+
+    // Writes the waiting checkpoint first.
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // Restores the checkpoint on disk and returns true, or returns false when there is none.
+    // Throws std::invalid_argument when the file is not a checkpoint of this configuration.
+    bool Resume(CPU& cpu, Mem& memory);
+
+    // Executes like CPU::Execute, taking a checkpoint at the first instruction boundary at or
+    // after every interval since the last one, or since the first call.
+    uint32_t Execute(uint32_t machine_cycles, CPU& cpu, Mem& memory);
+
+    // Takes a checkpoint now.
+    void Checkpoint(const CPU& cpu, const Mem& memory);
+
+    // Blocks until the waiting checkpoint is on disk. Throws the std::system_error of a write
+    // that failed since the last call.
+    void Flush();
+
+    struct Stats
+    {
+        uint64_t taken;
+        uint64_t written;
+        uint64_t replaced;  // Taken but replaced by a newer one before it was written.
+        uint64_t written_cycle;
+        size_t written_bytes;
+    };
+
+    Stats GetStats() const;
+
+   private:
+    struct Slot
+    {
+        CPU cpu;
+        Mem memory;
+    };
+
+    void Write();
+    size_t Persist(const Slot& slot) const;
+
+    CheckpointConfig config;
+    SnapshotCodec codec;
+
+    // Owned by the emulation thread.
+    std::unique_ptr<Slot> spare;
+    uint64_t due = 0;
+    bool scheduled = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable checkpoint_queued;
+    std::condition_variable checkpoint_written;
+    std::unique_ptr<Slot> queued;
+    std::unique_ptr<Slot> free_slot;
+    bool writing = false;
+    bool stopping = false;
+    std::exception_ptr error;
+    Stats stats = {};
+
+    // Last, so it starts after the members it uses.
+    std::thread writer;
+};
+
+#endif  // CHECKPOINTER_H
@@ -0,0 +1,221 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#if __cplusplus < 202002L
+#error "coroutine.h needs C++20, configure with -DMOS6502_COROUTINES=ON"
+#endif
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+
+// Coroutine type of the machines and host logic run by an EmulationScheduler. Tasks start
+// suspended and are owned by the scheduler once spawned.
+class EmulationTask
+{
+   public:
+    struct promise_type
+    {
+        std::exception_ptr exception;
+
+        EmulationTask get_return_object()
+        {
+            return EmulationTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    EmulationTask(EmulationTask&& other) noexcept;
+    EmulationTask& operator=(EmulationTask&& other) noexcept;
+    ~EmulationTask();
+
+   private:
+    friend class EmulationScheduler;
+
+    explicit EmulationTask(std::coroutine_handle<promise_type> handle) : handle(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Multiplexes many emulated machines on one thread. A task co_awaits Emulate to run a CPU for
+// a number of cycles; the scheduler runs every emulating task one slice at a time, round robin,
+// and resumes the task when its cycles are used up or an event stopped the CPU: a watchpoint,
+// which covers breakpoints and I/O reads and writes, or an exception such as an illegal opcode.
+class EmulationScheduler
+{
+   public:
+    enum class Event
+    {
+        Cycles,      // The requested cycles were used.
+        Watchpoint,  // A watchpoint stopped the CPU, see hit.
+        Error        // Execute threw, see error.
+    };
+
+    struct Result
+    {
+        uint32_t cycles = 0;
+        Event event = Event::Cycles;
+        Mem::WatchHit hit = {};
+        std::string error;
+    };
+
+    class EmulateAwaiter
+    {
+       public:
+        bool await_ready() const noexcept
+        {
+            return cycles == 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            this->handle = handle;
+            scheduler.ready.push_back({handle, this});
+        }
+
+        Result await_resume()
+        {
+            return result;
+        }
+
+       private:
+        friend class EmulationScheduler;
+
+        EmulateAwaiter(EmulationScheduler& scheduler, CPU& cpu, Mem& memory, uint32_t cycles)
+            : scheduler(scheduler), cpu(cpu), memory(memory), cycles(cycles)
+        {
+        }
+
+        EmulationScheduler& scheduler;
+        CPU& cpu;
+        Mem& memory;
+        uint32_t cycles;
+        std::coroutine_handle<> handle;
+        Result result;
+    };
+
+    class YieldAwaiter
+    {
+       public:
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            scheduler.ready.push_back({handle, nullptr});
+        }
+
+        void await_resume()
+        {
+        }
+
+       private:
+        friend class EmulationScheduler;
+
+        explicit YieldAwaiter(EmulationScheduler& scheduler) : scheduler(scheduler)
+        {
+        }
+
+        EmulationScheduler& scheduler;
+    };
+
+    // Cycles a CPU runs before the next emulating task gets its turn.
+    explicit EmulationScheduler(uint32_t slice = 1000);
+    ~EmulationScheduler();
+
+    EmulationScheduler(const EmulationScheduler&) = delete;
+    EmulationScheduler& operator=(const EmulationScheduler&) = delete;
+
+    void Spawn(EmulationTask task);
+
+    // Runs tasks until all have finished. An exception escaping a task is rethrown here after
+    // that task is destroyed, the other tasks stay suspended and can be continued.
+    void Run();
+
+    // Tasks that have not finished.
+    size_t Active() const;
+
+    EmulateAwaiter Emulate(CPU& cpu, Mem& memory, uint32_t cycles)
+    {
+        return EmulateAwaiter(*this, cpu, memory, cycles);
+    }
+
+    // Lets every other ready task and emulation run once.
+    YieldAwaiter Yield()
+    {
+        return YieldAwaiter(*this);
+    }
+
+    // Slices executed so far.
+    uint64_t slices = 0;
+
+   private:
+    struct Entry
+    {
+        std::coroutine_handle<> handle;
+
+        // Set while the task waits for an emulation to finish.
+        EmulateAwaiter* emulation;
+    };
+
+    // Runs one slice and returns whether the emulation is finished.
+    bool Step(EmulateAwaiter& emulation);
+    void Resume(std::coroutine_handle<> handle);
+
+    uint32_t slice;
+    std::deque<Entry> ready;
+    std::vector<std::coroutine_handle<EmulationTask::promise_type>> tasks;
+};
+
+#endif  // COROUTINE_H
@@ -35,9 +35,75 @@
 class CPU
 {
    public:
-    CPU();
+    // PowerOn clears memory and resets the CPU. Reset only touches the CPU state and loads the
+    // program counter from the reset vector at 0xFFFC.
+    void PowerOn(Mem& memory);
     void Reset(Mem& memory);
+
+    // The programmer-visible registers.
+    struct Registers
+    {
+        uint16_t PC;
+        uint8_t SP;
+        uint8_t A, X, Y;
+        uint8_t PS;
+
+        bool operator==(const Registers& other) const;
+        bool operator!=(const Registers& other) const;
+    };
+
+    Registers GetRegisters() const;
+    void SetRegisters(const Registers& registers);
+
+    // Why the last call to Execute returned.
+    enum class StopReason
+    {
+        Cycles,     // At least the requested number of machine cycles was used.
+        Watchpoint  // A watchpoint asked to stop, see Mem::LastWatchHit.
+    };
+
+    // Executes whole instructions until the machine cycles are used up or a watchpoint stops
+    // execution, and returns the number of cycles used.
     uint32_t Execute(uint32_t machine_cycles, Mem& memory);
+    StopReason stop_reason = StopReason::Cycles;
+
+    // Machine cycles executed since power-on.
+    uint64_t cycles = 0;
+
+    // Everything besides memory that execution depends on, for save states.
+    struct State
+    {
+        Registers registers;
+        uint64_t cycles;
+        bool consume_cycle;
+        bool page_crossed;
+        bool watch_stopped;
+        uint16_t watch_stop_pc;
+    };
+
+    State GetState() const;
+    void SetState(const State& state);
+
+    // Hash of the registers and memory for deduplication and fingerprints, O(1) like Mem::Hash.
+    // The cycle counter is not part of it.
+    uint64_t StateHash(Mem& memory) const;
+
+    // Hardware interrupts, raised by the host between calls to Execute.
+    enum class Interrupt
+    {
+        IRQ,  // Masked by the I flag, vectored through 0xFFFE.
+        NMI   // Never masked, vectored through 0xFFFA.
+    };
+
+    // Takes the interrupt at the current instruction boundary: pushes the program counter and
+    // the status flags with B clear, sets I and continues at the vector, using 7 machine cycles.
+    // Returns false for a masked IRQ, which a level-triggered device raises again later.
+    bool RaiseInterrupt(Interrupt interrupt, Mem& memory);
+
+    // Edge coverage for fuzzing. When set, every branch, jump, call and return increments the
+    // entry of its source and target pair in this map of coverage_size counters.
+    static const uint32_t coverage_size = 0x10000;
+    uint8_t* coverage = nullptr;
 
     // Program counter, stack pointer and general-purpose registers A, X and Y.
     uint16_t PC;
@@ -72,8 +138,14 @@ class CPU
         uint8_t cycles;
     };
 
-    std::array<Instruction, 256> dispatch_table;
-    void ExecInstruction(Instruction instruction, uint32_t& machine_cycles, Mem& memory);
+    static const std::array<Instruction, 256>& DispatchTable();
+    static std::array<Instruction, 256> MakeDispatchTable();
+    void ExecInstruction(Instruction instruction, uint32_t& machine_cycles_used, Mem& memory);
+
+    // Set when execution stopped before the instruction at watch_stop_pc, resuming from there
+    // executes it instead of stopping again.
+    bool watch_stopped = false;
+    uint16_t watch_stop_pc = 0;
 
     // Addressing mode functions
     uint16_t AddrOpcode(Mem& memory);  // Used for debugging illegal opcodes
@@ -99,9 +171,19 @@ class CPU
     bool consume_cycle = false;
     bool page_crossed = false;
 
+    // Records the edge from the current PC, which is past the operands, to target.
+    void RecordEdge(uint16_t target)
+    {
+        if (coverage)
+            coverage[(PC >> 1) ^ target]++;
+    }
+
     // Sets the Z, N flag for the LDA, LDX and LDY instructions
     void SetFlagsZN(uint8_t reg);
 
+    // Shared by ADC and SBC
+    void AddWithCarry(uint8_t operand);
+
     // Used for all branching operations
     void ConditionalBranch(bool flag, bool status, uint16_t address);
 
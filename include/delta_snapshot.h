@@ -0,0 +1,84 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DELTA_SNAPSHOT_H
+#define DELTA_SNAPSHOT_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "save_state.h"
+
+// The CPU state and the memory pages written since the previous snapshot of a chain.
+struct DeltaSnapshot
+{
+    CPU::State cpu;
+
+    // Page numbers in ascending order, with Mem::page_size bytes of contents each.
+    std::vector<uint8_t> pages;
+    std::vector<uint8_t> contents;
+};
+
+// A full save state followed by deltas, using the modification tracking of the memory. A delta
+// costs a scan of the page attributes plus a copy of each page written since the previous
+// snapshot. Rebuilding a point copies every page at most once, from the newest delta that has
+// it. Like SaveState, read-only pages keep their contents.
+class SnapshotChain
+{
+   public:
+    // Starts the chain with a full state, point 0, and clears the memory's modification
+    // tracking. Every later snapshot has to be taken of the same memory.
+    SnapshotChain(const CPU& cpu, Mem& memory);
+
+    // Appends a delta and returns its point.
+    size_t Snapshot(const CPU& cpu, Mem& memory);
+
+    // Rebuilds a point into any machine.
+    void Rebuild(size_t point, CPU& cpu, Mem& memory) const;
+
+    // Returns the chain's own machine to a point, copying only the pages written since. Later
+    // points are discarded, the machine continues from this one.
+    void Rewind(size_t point, CPU& cpu, Mem& memory);
+
+    // Points including the base.
+    size_t Size() const;
+
+    const SaveState& Base() const;
+    const DeltaSnapshot& Delta(size_t point) const;
+
+    // Bytes held by the deltas.
+    size_t DeltaBytes() const;
+
+   private:
+    using PageSet = std::bitset<Mem::page_count>;
+
+    void CopyPages(size_t point, PageSet done, Mem& memory) const;
+
+    SaveState base;
+    std::vector<DeltaSnapshot> deltas;
+};
+
+#endif  // DELTA_SNAPSHOT_H
@@ -0,0 +1,105 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "thread_pool.h"
+
+// An execution engine under differential test. Engines own their memory and throw
+// std::invalid_argument on an illegal opcode, like CPU::Execute.
+class DiffEngine
+{
+   public:
+    virtual ~DiffEngine() = default;
+
+    virtual void SetState(const CPU::Registers& registers, const Mem& memory) = 0;
+    virtual uint32_t Execute(uint32_t machine_cycles) = 0;
+    virtual CPU::Registers GetRegisters() const = 0;
+    virtual const Mem& Memory() const = 0;
+};
+
+using EngineFactory = std::function<std::unique_ptr<DiffEngine>()>;
+
+// The dispatch table interpreter of CPU, and one lane of Lockstep.
+std::unique_ptr<DiffEngine> MakeReferenceEngine();
+std::unique_ptr<DiffEngine> MakeLockstepEngine();
+
+struct DiffOptions
+{
+    // Cycles per step, 1 compares after every instruction.
+    uint32_t step_cycles = 1;
+    uint32_t max_steps = 1000;
+    bool compare_memory = true;
+};
+
+// The first step after which the engines disagree.
+struct Divergence
+{
+    uint32_t step = 0;
+
+    // Where the step started on the reference engine.
+    uint16_t pc = 0;
+    uint8_t opcode = 0;
+
+    CPU::Registers expected = {}, actual = {};
+    uint32_t expected_cycles = 0, actual_cycles = 0;
+    std::string expected_error, actual_error;
+    std::vector<Mem::Range> memory;
+
+    // One line with the PC, the opcode and every field that differs.
+    std::string Describe() const;
+};
+
+// Runs both engines from the same state step by step until they diverge, both stop on an
+// error or max_steps is reached.
+std::optional<Divergence> RunDifferential(DiffEngine& reference, DiffEngine& candidate,
+                                          const CPU::Registers& registers, const Mem& memory,
+                                          const DiffOptions& options = {});
+
+// Fills memory with random legal opcodes and operands, and picks random registers.
+void RandomProgram(uint64_t seed, Mem& memory, CPU::Registers& registers);
+
+struct DiffFailure
+{
+    uint64_t seed;
+    Divergence divergence;
+};
+
+// Runs RandomProgram for every seed in [first_seed, first_seed + count) on the pool and
+// returns the divergences ordered by seed.
+std::vector<DiffFailure> RunRandomPrograms(const EngineFactory& reference,
+                                           const EngineFactory& candidate, uint64_t first_seed,
+                                           uint64_t count, ThreadPool& pool,
+                                           const DiffOptions& options = {});
+
+#endif  // DIFFERENTIAL_H
@@ -0,0 +1,205 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu.h"
+#include "thread_pool.h"
+
+// A point where the exploration forks: whenever execution reaches pc, one branch continues for
+// every value, stored at address before the instruction at pc runs.
+struct DecisionPoint
+{
+    uint16_t pc;
+    uint16_t address;
+    std::vector<uint8_t> values;
+};
+
+// A program whose reachable behaviors are explored. Execution starts from the image with the
+// given registers, forks at the decision points and ends a path when it reaches a stop
+// address, executes an illegal opcode or has used its cycle budget since the start.
+struct ExploreConfig
+{
+    std::vector<uint8_t> image;
+    uint16_t load_address = 0;
+    CPU::Registers registers = {};
+
+    std::vector<DecisionPoint> decisions;
+    std::vector<uint16_t> stop_addresses;
+    uint64_t cycles = 100000;
+
+    // Exploration ends after this many distinct states.
+    uint64_t max_states = 1000000;
+
+    // Depth-first keeps fewer states alive, breadth-first finds the shortest input sequences.
+    bool depth_first = true;
+
+    // Worker threads, 0 uses every hardware thread.
+    unsigned threads = 0;
+};
+
+// Explores every path through a program's decision points in parallel. States at decision
+// points and stop addresses are deduplicated by CPU::StateHash, so a state reached along several
+// paths is only expanded once; two states are taken to be equal when their hashes are. The
+// cycle counter is not part of a state. A state is stored as
+// the CPU state plus the pages that differ from the image, and workers move between states by
+// copying only the pages either of them changed.
+class Explorer
+{
+   public:
+    enum class Outcome
+    {
+        Stopped,  // Execution reached a stop address.
+        Hang,     // The cycle budget was used up.
+        Crash     // An illegal opcode was executed.
+    };
+
+    // The end of a path and the decision values that lead there.
+    struct Terminal
+    {
+        Outcome outcome;
+        CPU::Registers registers;
+        uint64_t cycles;
+        std::vector<uint8_t> inputs;
+    };
+
+    using TerminalCallback = std::function<void(const Terminal& terminal)>;
+
+    struct Stats
+    {
+        uint64_t states = 0;  // Distinct states at decision points and stop addresses.
+        uint64_t duplicates = 0;
+        uint64_t stopped = 0;
+        uint64_t hangs = 0;
+        uint64_t crashes = 0;
+
+        // Whether every path was explored, false when max_states ended the exploration.
+        bool complete = true;
+
+        // Most bytes held at once by pending states and the set of seen states.
+        size_t peak_bytes = 0;
+    };
+
+    // Throws std::invalid_argument when a decision point has no values or shares its pc.
+    explicit Explorer(const ExploreConfig& config);
+
+    // Explores from the start. The callback is called for every distinct stop state, every
+    // hang and crash, one call at a time from the worker threads.
+    Stats Explore(TerminalCallback callback = nullptr);
+
+   private:
+    using PageSet = std::bitset<Mem::page_count>;
+
+    struct Node
+    {
+        CPU::State cpu;
+
+        // Pages that differ from the image in ascending order, with their contents.
+        std::vector<uint8_t> pages;
+        std::vector<uint8_t> contents;
+
+        std::vector<uint8_t> inputs;
+
+        // Index of the decision point the state waits at, -1 for the start.
+        int decision;
+
+        size_t Bytes() const;
+    };
+
+    struct Worker
+    {
+        CPU cpu;
+        Mem memory;
+        PageSet loaded;
+    };
+
+    // Set of state hashes, split into independently locked open addressing tables.
+    class StateSet
+    {
+       public:
+        static const size_t shard_count = 64;
+
+        // Returns false when the hash is already in the set.
+        bool Insert(uint64_t hash);
+        void Clear();
+        size_t Bytes() const;
+
+       private:
+        struct Shard
+        {
+            std::mutex mutex;
+            std::vector<uint64_t> slots;
+            size_t size = 0;
+        };
+
+        Shard shards[shard_count];
+        std::atomic<size_t> bytes{0};
+    };
+
+    void Expand(const Node& node);
+    void Branch(Worker& worker, const Node& node, const uint8_t* value);
+    void Load(Worker& worker, const Node& node);
+    Node Capture(Worker& worker, int decision, std::vector<uint8_t> inputs, uint64_t* hash) const;
+    void Report(Outcome outcome, const Worker& worker, const std::vector<uint8_t>& inputs);
+    void Enqueue(Node&& node);
+    void Account(ptrdiff_t bytes);
+
+    ExploreConfig config;
+    Mem image;
+    std::unordered_map<uint16_t, int> decision_at;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    TerminalCallback callback;
+    std::mutex callback_mutex;
+
+    StateSet seen;
+    std::atomic<uint64_t> states{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<uint64_t> stopped{0};
+    std::atomic<uint64_t> hangs{0};
+    std::atomic<uint64_t> crashes{0};
+    std::atomic<bool> truncated{false};
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<size_t> peak_bytes{0};
+
+    // The next breadth-first level.
+    std::mutex level_mutex;
+    std::vector<Node> next_level;
+
+    // Last, so workers finish before the members they use are destroyed.
+    ThreadPool pool;
+};
+
+#endif  // EXPLORER_H
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "cpu.h"
+
+// A program under test and where its input goes. Every run starts from the image with the
+// given registers, receives an input at input_address and ends when execution reaches a stop
+// address, an illegal opcode is hit or the cycle budget is used.
+struct FuzzTarget
+{
+    std::vector<uint8_t> image;
+    uint16_t load_address = 0;
+    CPU::Registers registers = {};
+
+    uint16_t input_address = 0;
+    uint16_t max_input_length = 256;
+
+    // When set, the input length is stored here as a little-endian word before each run. The
+    // word has to fit below 0x10000.
+    std::optional<uint16_t> length_address;
+
+    uint32_t cycles = 100000;
+    std::vector<uint16_t> stop_addresses;
+};
+
+// Coverage-guided fuzzer. Inputs are mutated from a corpus, and an input is kept when its run
+// covers a new edge or an edge a new number of times. Between runs only the memory ranges
+// that differ from the image are restored, the CPU and memory are never rebuilt.
+class Fuzzer
+{
+   public:
+    explicit Fuzzer(const FuzzTarget& target, uint64_t seed = 0);
+
+    // The CPU points into trace.
+    Fuzzer(const Fuzzer&) = delete;
+    Fuzzer& operator=(const Fuzzer&) = delete;
+
+    enum class Outcome
+    {
+        Stopped,  // Execution reached a stop address.
+        Hang,     // The cycle budget was used up.
+        Crash     // An illegal opcode was executed.
+    };
+
+    // Runs one input and merges its coverage. new_coverage is set when the run covered
+    // something no earlier run did.
+    Outcome Run(const std::vector<uint8_t>& input, bool* new_coverage = nullptr);
+
+    // Runs the input and adds it to the corpus, mutation starts from the corpus.
+    void AddSeed(const std::vector<uint8_t>& input);
+
+    // Runs mutated corpus entries, crashing inputs with new coverage are kept in Crashes.
+    void Fuzz(uint64_t iterations);
+
+    const std::vector<std::vector<uint8_t>>& Corpus() const;
+    const std::vector<std::vector<uint8_t>>& Crashes() const;
+
+    // Number of distinct edges covered so far.
+    uint32_t Edges() const;
+
+    uint64_t executions = 0;
+    uint64_t crashes = 0;
+    uint64_t hangs = 0;
+
+   private:
+    std::vector<uint8_t> Mutate();
+    void Restore();
+    bool MergeCoverage();
+
+    FuzzTarget target;
+    Mem image;
+    Mem memory;
+    CPU cpu;
+
+    // Edge hit counts of the current run, and the hit count classes seen by any run.
+    std::vector<uint8_t> trace;
+    std::vector<uint8_t> seen;
+
+    std::vector<std::vector<uint8_t>> corpus;
+    std::vector<std::vector<uint8_t>> crashing;
+    std::mt19937_64 random;
+};
+
+#endif  // FUZZ_H
@@ -0,0 +1,153 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "cpu.h"
+
+// Binary log of everything that enters a machine from outside, so a run can be replayed
+// exactly from the state it started in. All integers are little-endian, counts and cycle
+// deltas are LEB128 varints. The header holds the magic, version, start cycle and input
+// ranges, followed by the length of the event section, the event section and the read
+// section. Events are host actions stamped with the cycle delta to the previous one. Reads are
+// the values of CPU reads from input ranges in the order they happened; they need no
+// timestamps, since replaying the same inputs makes the same reads.
+namespace input_log
+{
+const uint32_t magic = 0x4C303536;  // "650L"
+const uint16_t version = 1;
+
+enum Event : uint8_t
+{
+    kInterrupt = 1,  // varint cycle delta, u8 CPU::Interrupt
+    kWrite = 2       // varint cycle delta, u16 address, varint length, bytes
+};
+
+enum Read : uint8_t
+{
+    kRead = 1,      // u16 address, u8 value
+    kReadSame = 2,  // u8 value, from the address of the previous read
+    kRepeat = 3     // varint count of at least 1, more reads of the previous address and value
+};
+}  // namespace input_log
+
+// Records the inputs of a machine while the host runs it with CPU::Execute. CPU reads from the
+// input ranges get their value from the device, which is stored at the address before the
+// read completes. Interrupts and host writes have to go through the recorder to be logged.
+// Uses the watch callback of the memory: other watchpoints stop execution as without one.
+class InputRecorder
+{
+   public:
+    using Device = std::function<uint8_t(uint16_t address)>;
+
+    InputRecorder(CPU& cpu, Mem& memory, const std::vector<Mem::Range>& inputs, Device device);
+    ~InputRecorder();
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    bool Interrupt(CPU::Interrupt interrupt);
+    void Write(uint16_t address, const std::vector<uint8_t>& bytes);
+
+    // The log of everything recorded so far.
+    std::vector<uint8_t> Log() const;
+
+    uint64_t reads = 0;
+
+   private:
+    void BeginEvent(input_log::Event event);
+
+    CPU& cpu;
+    Mem& memory;
+    std::vector<Mem::Range> inputs;
+    Device device;
+    std::vector<int> watchpoints;
+
+    uint64_t start_cycle;
+    uint64_t event_cycle;
+    std::vector<uint8_t> events;
+
+    // The last read is kept back while it repeats.
+    std::vector<uint8_t> read_records;
+    int32_t last_address = -1;
+    uint8_t last_value = 0;
+    uint64_t repeats = 0;
+};
+
+// Replays a log into a machine in the state the recording started in. Execute runs at the
+// speed of CPU::Execute between events: only the pages of the input ranges leave the fast
+// path. Uses the watch callback of the memory like the recorder.
+class InputReplayer
+{
+   public:
+    // Throws std::invalid_argument when the log is malformed or the CPU is not at its start
+    // cycle.
+    InputReplayer(CPU& cpu, Mem& memory, const std::vector<uint8_t>& log);
+    ~InputReplayer();
+
+    InputReplayer(const InputReplayer&) = delete;
+    InputReplayer& operator=(const InputReplayer&) = delete;
+
+    // Executes like CPU::Execute, raising the recorded interrupts and making the recorded writes
+    // as soon as the CPU reaches their cycle. The cycles used include those of the interrupts.
+    // Throws std::runtime_error when the run diverges from the recording.
+    uint32_t Execute(uint32_t machine_cycles);
+
+    // Whether every event and read has been replayed.
+    bool Done() const;
+
+   private:
+    struct Event
+    {
+        uint64_t cycle;
+        input_log::Event type;
+        CPU::Interrupt interrupt;
+        uint16_t address;
+        std::vector<uint8_t> bytes;
+    };
+
+    void Apply();
+    uint8_t NextRead(uint16_t address);
+
+    CPU& cpu;
+    Mem& memory;
+    std::vector<int> watchpoints;
+
+    std::vector<Event> events;
+    size_t next_event = 0;
+
+    std::vector<uint8_t> read_records;
+    size_t read_offset = 0;
+    uint16_t read_address = 0;
+    uint8_t read_value = 0;
+    uint64_t repeats = 0;
+};
+
+#endif  // INPUT_LOG_H
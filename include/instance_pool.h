@@ -0,0 +1,96 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INSTANCE_POOL_H
+#define INSTANCE_POOL_H
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu.h"
+
+struct ArenaConfig
+{
+    size_t capacity = 0;
+
+    // Backs the memory images with huge pages: reserved ones when available, transparent huge
+    // pages otherwise.
+    bool huge_pages = false;
+
+    // Binds the arena to this NUMA node, -1 leaves placement to the kernel.
+    int numa_node = -1;
+};
+
+// Fixed set of CPU and memory instances carved from two page-aligned arenas: one holds the
+// 64 KB memory images back to back, the other the CPU and Mem objects. Acquire and Release
+// only pop and push a free list, pages of the arena are faulted in when first written. The
+// pool is not thread-safe, use one per thread.
+class InstancePool
+{
+   public:
+    struct Instance
+    {
+        explicit Instance(uint8_t* storage) : memory(storage)
+        {
+        }
+
+        CPU cpu;
+        Mem memory;
+    };
+
+    explicit InstancePool(const ArenaConfig& config);
+    ~InstancePool();
+
+    InstancePool(const InstancePool&) = delete;
+    InstancePool& operator=(const InstancePool&) = delete;
+
+    // Returns a powered-off instance with zeroed memory, or throws std::bad_alloc when every
+    // instance is in use.
+    Instance* Acquire();
+
+    // Zeroes the pages the instance wrote and returns it to the free list. Discarding also
+    // returns the physical pages of its memory image to the kernel, so the free instance
+    // costs no resident memory until it is written again.
+    void Release(Instance* instance, bool discard = false);
+
+    size_t Capacity() const;
+    size_t Live() const;
+
+    // Whether the memory images are backed by huge pages.
+    bool HugePages() const;
+
+   private:
+    size_t capacity;
+    bool huge_pages = false;
+
+    uint8_t* images = nullptr;
+    size_t images_size = 0;
+    Instance* instances = nullptr;
+    size_t instances_size = 0;
+
+    std::vector<uint32_t> free_slots;
+    std::vector<bool> live;
+};
+
+#endif  // INSTANCE_POOL_H
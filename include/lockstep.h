@@ -0,0 +1,91 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <array>
+#include <cstdint>
+
+#include "cpu.h"
+#include "mem.h"
+
+// Runs up to 16 CPUs, each with its own memory, in structure-of-arrays form. Lanes whose PCs
+// agree execute an instruction together: it is decoded and dispatched once and the register
+// operations run across all lanes of the group as vector selects. When branches diverge the
+// group with the lowest PC runs first while the others are masked off, so lanes regroup as soon
+// as their PCs meet again. Every lane behaves exactly like CPU::Execute on its own memory.
+class Lockstep
+{
+   public:
+    static const unsigned max_lanes = 16;
+
+    // Why a lane stopped during the last call to Execute.
+    enum class LaneStop : uint8_t
+    {
+        Cycles,
+        Watchpoint,
+        IllegalOpcode
+    };
+
+    // Attaches a lane to its memory, which it must not share with another lane, and sets its
+    // registers. Passing a null memory detaches the lane.
+    void SetLane(unsigned lane, Mem* memory, const CPU::Registers& registers);
+    CPU::Registers GetRegisters(unsigned lane) const;
+
+    // Runs every attached lane until it used at least machine_cycles, or stopped.
+    void Execute(uint32_t machine_cycles);
+
+    uint32_t Cycles(unsigned lane) const;
+    LaneStop Stop(unsigned lane) const;
+
+    // Instructions dispatched and executed summed over the lanes, their ratio is the average
+    // number of lanes sharing a dispatch.
+    uint64_t dispatches = 0;
+    uint64_t lane_instructions = 0;
+
+   private:
+    using Lanes = std::array<uint8_t, max_lanes>;
+
+    void Step(uint8_t opcode, uint32_t group);
+    uint8_t PackStatus(unsigned lane) const;
+    void UnpackStatus(unsigned lane, uint8_t status);
+
+    alignas(32) std::array<uint16_t, max_lanes> pc = {};
+    alignas(16) Lanes sp = {};
+    alignas(16) Lanes a = {}, x = {}, y = {};
+
+    // One byte per flag and lane, so flag updates are plain vector selects.
+    alignas(16) Lanes c = {}, z = {}, i = {}, d = {}, b = {}, u = {}, v = {}, n = {};
+
+    std::array<uint32_t, max_lanes> used = {};
+    std::array<Mem*, max_lanes> memory = {};
+    std::array<LaneStop, max_lanes> stops = {};
+
+    // Same as CPU::watch_stopped, per lane.
+    std::array<bool, max_lanes> watch_stopped = {};
+    std::array<uint16_t, max_lanes> watch_stop_pc = {};
+};
+
+#endif  // LOCKSTEP_H
@@ -26,21 +26,303 @@
 #define MEM_H
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class RomImage;
 
 class Mem
 {
    public:
+    // How Map places a file in the address space.
+    enum class Mapping
+    {
+        Private,  // Copy-on-write, writes never reach the file (ROM images).
+        Shared    // Writes go straight to the file (battery-backed RAM).
+    };
+
+    // Kinds of access a watchpoint triggers on, combined as a mask.
+    enum Access : uint8_t
+    {
+        kRead = 1 << 0,
+        kWrite = 1 << 1,
+        kExecute = 1 << 2
+    };
+
+    struct WatchHit
+    {
+        int id;
+        uint16_t address;
+        Access access;
+    };
+
+    // A range of addresses, end is exclusive.
+    struct Range
+    {
+        uint32_t begin;
+        uint32_t end;
+
+        bool operator==(const Range& other) const
+        {
+            return begin == other.begin && end == other.end;
+        }
+    };
+
+    // Read-only window on memory in the style of std::span.
+    class View
+    {
+       public:
+        View(const uint8_t* data, size_t size) : pointer(data), length(size)
+        {
+        }
+
+        const uint8_t* data() const
+        {
+            return pointer;
+        }
+
+        size_t size() const
+        {
+            return length;
+        }
+
+        const uint8_t* begin() const
+        {
+            return pointer;
+        }
+
+        const uint8_t* end() const
+        {
+            return pointer + length;
+        }
+
+        uint8_t operator[](size_t index) const
+        {
+            return pointer[index];
+        }
+
+       private:
+        const uint8_t* pointer;
+        size_t length;
+    };
+
+    // Called for every watchpoint hit. Execution stops after the current instruction when it
+    // returns true, or before it for execute watchpoints. Without a callback every hit stops.
+    using WatchCallback = std::function<bool(const WatchHit& hit)>;
+
+    Mem();
+    ~Mem();
+
+    // Uses max_size bytes of zeroed, host page aligned storage that outlives this Mem, such as
+    // a slot of an InstancePool arena. Files cannot be mapped into borrowed storage.
+    explicit Mem(uint8_t* storage);
+
+    Mem(const Mem& other);
+    Mem(Mem&& other) noexcept;
+    Mem& operator=(const Mem& other);
+    Mem& operator=(Mem&& other) noexcept;
+
+    // Restores the power-on contents: RAM reads as zero and privately mapped files as their
+    // file contents again, shared mappings are left alone. Only pages written since the last
+    // call are touched.
     void Initialize();
-    void WriteWord(uint16_t value, uint32_t address, uint32_t& machine_cycles);
+
+    // Maps length bytes of a file, starting at offset, directly into the address space at
+    // address without copying. Both address and offset must be multiples of the host page size
+    // and the mapping is rounded up to whole host pages. A length of 0 maps the rest of the file.
+    void Map(const std::string& path, uint16_t address, Mapping mapping, size_t offset = 0,
+             size_t length = 0);
+
+    // Maps a ROM image at address, a multiple of the host page size, and protects it. Every Mem
+    // mapping the same image shares its physical pages until the host writes to one through
+    // operator[], which gives this Mem a private copy of that host page.
+    void MapRom(const RomImage& rom, uint16_t address);
+
+    // Makes the pages in [address, address + length) read-only for the CPU, writes to them are
+    // silently ignored as on real hardware. Both must be multiples of the 256 byte page size.
+    // ROM pages never change once protected, so decode caches do not need to invalidate them.
+    // The host still writes through operator[], which is how images are loaded.
+    void Protect(uint16_t address, uint32_t length, bool read_only = true);
+    bool IsReadOnly(uint16_t address) const;
+
+    // Watches the inclusive range [begin, end] for the accesses in the access mask and returns
+    // an id for RemoveWatchpoint. Only the pages overlapping a watchpoint leave the fast path.
+    // Data reads (immediate operands included) and writes by the CPU trigger kRead and kWrite,
+    // opcode fetches trigger kExecute.
+    // Host access through operator[] never triggers a watchpoint.
+    int AddWatchpoint(uint16_t begin, uint16_t end, uint8_t access);
+    void RemoveWatchpoint(int id);
+    void SetWatchCallback(WatchCallback callback);
+    const WatchHit& LastWatchHit() const;
+
+    // Block access from the host. Like operator[] they bypass ROM protection and watchpoints.
+    // Ranges must lie within the address space. Filling with zeros skips pages never written.
+    void Load(uint16_t address, const uint8_t* bytes, size_t length);
+    void Load(uint16_t address, const std::vector<uint8_t>& bytes);
+    void Dump(uint16_t address, uint8_t* bytes, size_t length) const;
+    void Fill(uint16_t address, size_t length, uint8_t value);
+    View Slice(uint16_t address, size_t length) const;
+
+    // Compare returns whether the whole address space equals other, Diff the ranges where it
+    // differs in ascending order. Pages neither side has written are skipped without reading.
+    bool Compare(const Mem& other) const;
+    std::vector<Range> Diff(const Mem& other) const;
+
+    // For incremental snapshots: whether a 256 byte page may have changed since the last
+    // ClearModified, by a write from the CPU or host, power-on or a mapping. Pages start out
+    // modified. The first CPU write to each page after ClearModified takes the slow path.
+    bool IsModified(uint32_t page) const;
+    void ClearModified();
+
+    // Hash of the whole address space, for equality checks and fingerprints: the sum of a
+    // 64-bit key of every address times its byte. CPU writes update it from the old and new
+    // byte at the cost of a few arithmetic instructions. Host writes cannot be seen through
+    // operator[], so the first one to a page takes the page out of the sum, and the next CPU
+    // write to it or call adds it back; without those the call is O(1). Writes of other
+    // processes to a shared mapping are not seen.
+    uint64_t Hash();
 
     // Enables reading and writing to memory using the [] operator.
     uint8_t operator[](uint32_t address) const;
     uint8_t& operator[](uint32_t address);
 
-   private:
+    // Reads and writes performed by the CPU. Fetch reads the instruction stream and never
+    // triggers a watchpoint.
+    uint8_t Read(uint16_t address);
+    uint8_t Fetch(uint16_t address) const;
+    void Write(uint16_t address, uint8_t value);
+
+    // Used by the CPU between instructions. WatchExecute returns true when execution has to stop
+    // before the opcode at address, ConsumeStop when a watchpoint hit asked to stop.
+    bool WatchExecute(uint16_t address);
+    bool ConsumeStop();
+
     static const uint32_t max_size = 64 * 1024;
-    std::array<uint8_t, max_size> data;
+    static const uint32_t page_size = 256;
+    static const uint32_t page_count = max_size / page_size;
+
+   private:
+    // Attributes kept for every 256 byte page. Accesses to a page with any bit of the matching
+    // trap mask set leave the fast path.
+    enum PageAttribute : uint16_t
+    {
+        kClean = 1 << 0,  // Not written since the last Initialize.
+        kPrivate = 1 << 1,
+        kShared = 1 << 2,
+        kReadOnly = 1 << 3,
+        kWatchRead = 1 << 4,
+        kWatchWrite = 1 << 5,
+        kWatchExecute = 1 << 6,
+        kUnmodified = 1 << 7,  // Not written since the last ClearModified.
+        kUnhashed = 1 << 8,    // Left out of the hash since a host write.
+
+        kReadTrap = kWatchRead,
+        kWriteTrap = kClean | kReadOnly | kWatchWrite | kUnmodified | kUnhashed,
+
+        // Cleared by every write.
+        kWritten = kClean | kUnmodified
+    };
+
+    struct Watchpoint
+    {
+        int id;
+        uint16_t begin;
+        uint16_t end;
+        uint8_t access;
+    };
+
+    void MapPages(int fd, uint16_t address, size_t length, size_t offset, bool shared,
+                  const std::string& name);
+    bool IsZero(uint32_t page) const;
+    void MarkWritten(uint32_t address, size_t length);
+
+    // The key of an address is the product of the keys of its page and its offset in the page.
+    // Keys are odd, so changing one byte always changes the hash.
+    static const std::array<uint64_t, page_count> page_keys;
+    static const std::array<uint64_t, page_size> offset_keys;
+
+    static uint64_t HashKey(uint16_t address);
+    uint64_t HashPage(uint32_t page) const;
+    void Unhash(uint32_t page);
+    void Rehash(uint32_t page);
+
+    uint8_t ReadSlow(uint16_t address);
+    void WriteSlow(uint16_t address, uint8_t value);
+    bool WatchSlow(uint16_t address, Access access);
+    void UpdateWatchAttributes();
+
+    // The whole address space is a single mapping so files can be mapped over parts of it.
+    uint8_t* data;
+    bool owns_data = true;
+    std::array<uint16_t, page_count> attributes;
+
+    // Hash of the pages without kUnhashed.
+    uint64_t hash = 0;
+    uint32_t unhashed_pages = 0;
+
+    std::vector<Watchpoint> watchpoints;
+    WatchCallback watch_callback;
+    WatchHit last_watch_hit = {};
+    int next_watch_id = 0;
+    bool stop_requested = false;
 };
 
+inline uint8_t Mem::Read(uint16_t address)
+{
+    if (attributes[address >> 8] & kReadTrap)
+        return ReadSlow(address);
+
+    return data[address];
+}
+
+inline uint8_t Mem::Fetch(uint16_t address) const
+{
+    return data[address];
+}
+
+inline bool Mem::IsReadOnly(uint16_t address) const
+{
+    return attributes[address >> 8] & kReadOnly;
+}
+
+inline void Mem::Write(uint16_t address, uint8_t value)
+{
+    if (attributes[address >> 8] & kWriteTrap)
+    {
+        WriteSlow(address, value);
+    }
+    else
+    {
+        hash += HashKey(address) * (uint64_t{value} - data[address]);
+        data[address] = value;
+    }
+}
+
+inline bool Mem::IsModified(uint32_t page) const
+{
+    return !(attributes[page] & kUnmodified);
+}
+
+inline uint64_t Mem::HashKey(uint16_t address)
+{
+    return page_keys[address >> 8] * offset_keys[address & 0xFF];
+}
+
+inline bool Mem::WatchExecute(uint16_t address)
+{
+    return (attributes[address >> 8] & kWatchExecute) && WatchSlow(address, kExecute);
+}
+
+inline bool Mem::ConsumeStop()
+{
+    if (!stop_requested)
+        return false;
+
+    stop_requested = false;
+    return true;
+}
+
 #endif  // MEM_H
\ No newline at end of file
@@ -0,0 +1,196 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef OPCODE_TABLE_H
+#define OPCODE_TABLE_H
+
+// The documented instruction set as one list, so the engines cannot disagree on decoding:
+// OPCODE(opcode, operation, machine cycles, addressing mode) for every legal opcode. The
+// cycles exclude page crossing and branch penalties. Used by the dispatch table of the CPU
+// and the decode table of Lockstep.
+#define MOS6502_OPCODES(OPCODE)            \
+    /* LOAD & STORE */                     \
+    OPCODE(0xA9, LDA, 2, Immediate)        \
+    OPCODE(0xA5, LDA, 3, ZeroPage)         \
+    OPCODE(0xB5, LDA, 4, ZeroPageX)        \
+    OPCODE(0xAD, LDA, 4, Absolute)         \
+    OPCODE(0xBD, LDA, 4, AbsoluteX)        \
+    OPCODE(0xB9, LDA, 4, AbsoluteY)        \
+    OPCODE(0xA1, LDA, 6, IndexedIndirect)  \
+    OPCODE(0xB1, LDA, 5, IndirectIndexed)  \
+    OPCODE(0xA2, LDX, 2, Immediate)        \
+    OPCODE(0xA6, LDX, 3, ZeroPage)         \
+    OPCODE(0xB6, LDX, 4, ZeroPageY)        \
+    OPCODE(0xAE, LDX, 4, Absolute)         \
+    OPCODE(0xBE, LDX, 4, AbsoluteY)        \
+    OPCODE(0xA0, LDY, 2, Immediate)        \
+    OPCODE(0xA4, LDY, 3, ZeroPage)         \
+    OPCODE(0xB4, LDY, 4, ZeroPageX)        \
+    OPCODE(0xAC, LDY, 4, Absolute)         \
+    OPCODE(0xBC, LDY, 4, AbsoluteX)        \
+    OPCODE(0x85, STA, 3, ZeroPage)         \
+    OPCODE(0x95, STA, 4, ZeroPageX)        \
+    OPCODE(0x8D, STA, 4, Absolute)         \
+    OPCODE(0x9D, STA, 5, AbsoluteX5)       \
+    OPCODE(0x99, STA, 5, AbsoluteY5)       \
+    OPCODE(0x81, STA, 6, IndexedIndirect)  \
+    OPCODE(0x91, STA, 6, IndirectIndexed6) \
+    OPCODE(0x86, STX, 3, ZeroPage)         \
+    OPCODE(0x96, STX, 4, ZeroPageY)        \
+    OPCODE(0x8e, STX, 4, Absolute)         \
+    OPCODE(0x84, STY, 3, ZeroPage)         \
+    OPCODE(0x94, STY, 4, ZeroPageX)        \
+    OPCODE(0x8C, STY, 4, Absolute)         \
+    /* REGISTER TRANSFERS */               \
+    OPCODE(0xAA, TAX, 2, Implied)          \
+    OPCODE(0xA8, TAY, 2, Implied)          \
+    OPCODE(0x8A, TXA, 2, Implied)          \
+    OPCODE(0x98, TYA, 2, Implied)          \
+    /* STACK OPERATIONS */                 \
+    OPCODE(0xBA, TSX, 2, Implied)          \
+    OPCODE(0x9A, TXS, 2, Implied)          \
+    OPCODE(0x48, PHA, 3, Implied)          \
+    OPCODE(0x08, PHP, 3, Implied)          \
+    OPCODE(0x68, PLA, 4, Implied)          \
+    OPCODE(0x28, PLP, 4, Implied)          \
+    /* LOGICAL OPERATIONS */               \
+    OPCODE(0x29, AND, 2, Immediate)        \
+    OPCODE(0x25, AND, 3, ZeroPage)         \
+    OPCODE(0x35, AND, 4, ZeroPageX)        \
+    OPCODE(0x2D, AND, 4, Absolute)         \
+    OPCODE(0x3D, AND, 4, AbsoluteX)        \
+    OPCODE(0x39, AND, 4, AbsoluteY)        \
+    OPCODE(0x21, AND, 6, IndexedIndirect)  \
+    OPCODE(0x31, AND, 5, IndirectIndexed)  \
+    OPCODE(0x49, EOR, 2, Immediate)        \
+    OPCODE(0x45, EOR, 3, ZeroPage)         \
+    OPCODE(0x55, EOR, 4, ZeroPageX)        \
+    OPCODE(0x4D, EOR, 4, Absolute)         \
+    OPCODE(0x5D, EOR, 4, AbsoluteX)        \
+    OPCODE(0x59, EOR, 4, AbsoluteY)        \
+    OPCODE(0x41, EOR, 6, IndexedIndirect)  \
+    OPCODE(0x51, EOR, 5, IndirectIndexed)  \
+    OPCODE(0x09, ORA, 2, Immediate)        \
+    OPCODE(0x05, ORA, 3, ZeroPage)         \
+    OPCODE(0x15, ORA, 4, ZeroPageX)        \
+    OPCODE(0x0D, ORA, 4, Absolute)         \
+    OPCODE(0x1D, ORA, 4, AbsoluteX)        \
+    OPCODE(0x19, ORA, 4, AbsoluteY)        \
+    OPCODE(0x01, ORA, 6, IndexedIndirect)  \
+    OPCODE(0x11, ORA, 5, IndirectIndexed)  \
+    OPCODE(0x24, BIT, 3, ZeroPage)         \
+    OPCODE(0x2C, BIT, 4, Absolute)         \
+    /* ARITHMETIC OPERATIONS */            \
+    OPCODE(0x69, ADC, 2, Immediate)        \
+    OPCODE(0x65, ADC, 3, ZeroPage)         \
+    OPCODE(0x75, ADC, 4, ZeroPageX)        \
+    OPCODE(0x6D, ADC, 4, Absolute)         \
+    OPCODE(0x7D, ADC, 4, AbsoluteX)        \
+    OPCODE(0x79, ADC, 4, AbsoluteY)        \
+    OPCODE(0x61, ADC, 6, IndexedIndirect)  \
+    OPCODE(0x71, ADC, 5, IndirectIndexed)  \
+    OPCODE(0xE9, SBC, 2, Immediate)        \
+    OPCODE(0xE5, SBC, 3, ZeroPage)         \
+    OPCODE(0xF5, SBC, 4, ZeroPageX)        \
+    OPCODE(0xED, SBC, 4, Absolute)         \
+    OPCODE(0xFD, SBC, 4, AbsoluteX)        \
+    OPCODE(0xF9, SBC, 4, AbsoluteY)        \
+    OPCODE(0xE1, SBC, 6, IndexedIndirect)  \
+    OPCODE(0xF1, SBC, 5, IndirectIndexed)  \
+    OPCODE(0xC9, CMP, 2, Immediate)        \
+    OPCODE(0xC5, CMP, 3, ZeroPage)         \
+    OPCODE(0xD5, CMP, 4, ZeroPageX)        \
+    OPCODE(0xCD, CMP, 4, Absolute)         \
+    OPCODE(0xDD, CMP, 4, AbsoluteX)        \
+    OPCODE(0xD9, CMP, 4, AbsoluteY)        \
+    OPCODE(0xC1, CMP, 6, IndexedIndirect)  \
+    OPCODE(0xD1, CMP, 5, IndirectIndexed)  \
+    OPCODE(0xE0, CPX, 2, Immediate)        \
+    OPCODE(0xE4, CPX, 3, ZeroPage)         \
+    OPCODE(0xEC, CPX, 4, Absolute)         \
+    OPCODE(0xC0, CPY, 2, Immediate)        \
+    OPCODE(0xC4, CPY, 3, ZeroPage)         \
+    OPCODE(0xCC, CPY, 4, Absolute)         \
+    /* INCREMENT & DECREMENT OPERATIONS */ \
+    OPCODE(0xE6, INC, 5, ZeroPage)         \
+    OPCODE(0xF6, INC, 6, ZeroPageX)        \
+    OPCODE(0xEE, INC, 6, Absolute)         \
+    OPCODE(0xFE, INC, 7, AbsoluteX)        \
+    OPCODE(0xE8, INX, 2, Implied)          \
+    OPCODE(0xC8, INY, 2, Implied)          \
+    OPCODE(0xC6, DEC, 5, ZeroPage)         \
+    OPCODE(0xD6, DEC, 6, ZeroPageX)        \
+    OPCODE(0xCE, DEC, 6, Absolute)         \
+    OPCODE(0xDE, DEC, 7, AbsoluteX)        \
+    OPCODE(0xCA, DEX, 2, Implied)          \
+    OPCODE(0x88, DEY, 2, Implied)          \
+    /* SHIFT OPERATIONS */                 \
+    OPCODE(0x0A, ASLA, 2, Accumulator)     \
+    OPCODE(0x06, ASL, 5, ZeroPage)         \
+    OPCODE(0x16, ASL, 6, ZeroPageX)        \
+    OPCODE(0x0E, ASL, 6, Absolute)         \
+    OPCODE(0x1E, ASL, 7, AbsoluteX)        \
+    OPCODE(0x4A, LSRA, 2, Accumulator)     \
+    OPCODE(0x46, LSR, 5, ZeroPage)         \
+    OPCODE(0x56, LSR, 6, ZeroPageX)        \
+    OPCODE(0x4E, LSR, 6, Absolute)         \
+    OPCODE(0x5E, LSR, 7, AbsoluteX)        \
+    OPCODE(0x2A, ROLA, 2, Accumulator)     \
+    OPCODE(0x26, ROL, 5, ZeroPage)         \
+    OPCODE(0x36, ROL, 6, ZeroPageX)        \
+    OPCODE(0x2E, ROL, 6, Absolute)         \
+    OPCODE(0x3E, ROL, 7, AbsoluteX)        \
+    OPCODE(0x6A, RORA, 2, Accumulator)     \
+    OPCODE(0x66, ROR, 5, ZeroPage)         \
+    OPCODE(0x76, ROR, 6, ZeroPageX)        \
+    OPCODE(0x6E, ROR, 6, Absolute)         \
+    OPCODE(0x7E, ROR, 7, AbsoluteX)        \
+    /* JUMPS & CALLS OPERATIONS */         \
+    OPCODE(0x4C, JMP, 3, Absolute)         \
+    OPCODE(0x6C, JMP, 5, Indirect)         \
+    OPCODE(0x20, JSR, 6, Absolute)         \
+    OPCODE(0x60, RTS, 6, Implied)          \
+    /* BRANCH OPERATIONS */                \
+    OPCODE(0x90, BCC, 2, Relative)         \
+    OPCODE(0xB0, BCS, 2, Relative)         \
+    OPCODE(0xF0, BEQ, 2, Relative)         \
+    OPCODE(0x30, BMI, 2, Relative)         \
+    OPCODE(0xD0, BNE, 2, Relative)         \
+    OPCODE(0x10, BPL, 2, Relative)         \
+    OPCODE(0x50, BVC, 2, Relative)         \
+    OPCODE(0x70, BVS, 2, Relative)         \
+    /* STATUS FLAG OPERATIONS */           \
+    OPCODE(0x18, CLC, 2, Implied)          \
+    OPCODE(0xD8, CLD, 2, Implied)          \
+    OPCODE(0x58, CLI, 2, Implied)          \
+    OPCODE(0xB8, CLV, 2, Implied)          \
+    OPCODE(0x38, SEC, 2, Implied)          \
+    OPCODE(0xF8, SED, 2, Implied)          \
+    OPCODE(0x78, SEI, 2, Implied)          \
+    /* SYSTEM OPERATIONS */                \
+    OPCODE(0x00, BRK, 7, Implied)          \
+    OPCODE(0xEA, NOP, 2, Implied)          \
+    OPCODE(0x40, RTI, 6, Implied)
+
+#endif  // OPCODE_TABLE_H
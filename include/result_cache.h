@@ -0,0 +1,122 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "snapshot_codec.h"
+
+struct ResultCacheConfig
+{
+    // Directory holding one file per cached run, created if missing. One process uses it at a
+    // time.
+    std::string directory;
+
+    // The least recently used runs are evicted beyond either limit.
+    uint64_t max_bytes = 256 * 1024 * 1024;
+    size_t max_entries = 65536;
+
+    // Reference image for the SnapshotCodec of the final states, empty for none. Runs cached
+    // with another one are misses.
+    std::vector<uint8_t> reference;
+};
+
+// Memoizes runs that are repeated with identical inputs, such as regression jobs. A run is keyed
+// by the registers and the rest of the CPU state except the cycle counter, the Mem::Hash of the
+// memory, the cycle budget and a caller-defined parameters hash. A hit restores the final state
+// and cycle count from the store without executing, through a compressed snapshot of the final
+// machine. Entries are written to a temporary file and renamed, and carry a checksum and their
+// whole key, so a torn or colliding file is a miss. The use order survives restarts through
+// the modification times of the files.
+class ResultCache
+{
+   public:
+    static const uint32_t magic = 0x4D303536;  // "650M"
+    static const uint16_t version = 1;
+
+    // Indexes the entries in the directory and evicts beyond the limits. Throws
+    // std::invalid_argument for an empty directory or a zero limit and std::system_error when
+    // the directory cannot be created or read.
+    explicit ResultCache(const ResultCacheConfig& config);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Executes like CPU::Execute, or restores the result of an identical run. The key does not
+    // cover anything else execution depends on: parameters has to identify the mappings,
+    // protection and watchpoints of the memory, and watch callbacks are not called on a hit.
+    // Runs that throw are not cached, runs with coverage enabled bypass the cache. Throws
+    // std::system_error when an entry cannot be read or written. Thread-safe for distinct
+    // machines.
+    uint32_t Execute(uint32_t machine_cycles, CPU& cpu, Mem& memory, uint64_t parameters = 0);
+
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evicted;
+        size_t entries;
+        uint64_t bytes;
+    };
+
+    Stats GetStats() const;
+
+   private:
+    struct Key;
+    struct Entry
+    {
+        uint64_t bytes;
+        std::list<uint64_t>::iterator use;
+    };
+
+    bool Restore(uint64_t id, const Key& key, uint32_t& used, CPU& cpu, Mem& memory);
+    void Store(uint64_t id, const Key& key, uint32_t used, const CPU& cpu, const Mem& memory);
+    void Insert(uint64_t id, uint64_t bytes);
+    void Remove(uint64_t id);
+    timespec UseTime();
+    std::string Path(uint64_t id) const;
+
+    ResultCacheConfig config;
+    SnapshotCodec codec;
+    std::atomic<uint64_t> next_temporary{0};
+
+    // Entries by the hash of their key, with the most recently used first.
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::list<uint64_t> uses;
+    int64_t last_use = 0;  // Nanoseconds since the epoch.
+    Stats stats = {};
+};
+
+#endif  // RESULT_CACHE_H
@@ -0,0 +1,110 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "cpu.h"
+
+struct RewindConfig
+{
+    // Machine cycles between checkpoints.
+    uint64_t interval = 100000;
+
+    // Checkpoints kept, the oldest is dropped to make room for a new one.
+    size_t capacity = 600;
+};
+
+// Bounded history of periodic checkpoints of one machine, for stepping back in time. Checkpoints
+// are compressed by sharing pages: a page not written since the previous checkpoint, or
+// written back to the same contents, points to the same stored copy, and zero pages are not
+// stored at all. A checkpoint costs a scan of the page attributes plus a copy of each changed
+// page, and holds a table of page references. Like SaveState, read-only pages keep their
+// contents. Execution is deterministic, so any cycle between the oldest checkpoint and now is
+// reached again by restoring the checkpoint before it and executing forward.
+class RewindBuffer
+{
+   public:
+    // Takes the first checkpoint and clears the memory's modification tracking. Throws
+    // std::invalid_argument for a zero interval or capacity.
+    RewindBuffer(const RewindConfig& config, const CPU& cpu, Mem& memory);
+
+    // Executes like CPU::Execute, taking a checkpoint at the first instruction boundary at or
+    // after every interval since the newest one. Returns early when a watchpoint stops.
+    uint32_t Execute(uint32_t machine_cycles, CPU& cpu, Mem& memory);
+
+    // Takes a checkpoint now.
+    void Checkpoint(const CPU& cpu, Mem& memory);
+
+    // Restores checkpoint index, 0 being the oldest, into any machine.
+    void Restore(size_t index, CPU& cpu, Mem& memory) const;
+
+    // Returns the buffer's own machine to the first instruction boundary at or after cycle,
+    // which is cycle itself when the original run had one there. Restores the newest checkpoint
+    // at or before cycle, copying only the pages that differ, and executes forward; watchpoint
+    // callbacks fire again and stops are resumed. Later checkpoints are discarded. Throws
+    // std::out_of_range when cycle is before the oldest checkpoint.
+    void Seek(uint64_t cycle, CPU& cpu, Mem& memory);
+
+    size_t Size() const;
+    uint64_t Cycle(size_t index) const;
+
+    // Bytes held by the stored pages and the checkpoint tables.
+    size_t Bytes() const;
+
+   private:
+    struct Page
+    {
+        std::array<uint8_t, Mem::page_size> bytes;
+        uint32_t references;
+    };
+
+    struct Entry
+    {
+        CPU::State cpu;
+        std::array<uint32_t, Mem::page_count> pages;
+    };
+
+    // Entry page reference of pages that are not stored.
+    static const uint32_t kZeroPage = 0;
+
+    uint32_t Store(const uint8_t* bytes);
+    void Release(const Entry& entry);
+    void Load(const Entry& entry, uint32_t page, Mem& memory) const;
+
+    RewindConfig config;
+    std::deque<Entry> entries;
+
+    // Index 0 stands for the zero page and is never used.
+    std::vector<Page> pages;
+    std::vector<uint32_t> free_pages;
+};
+
+#endif  // REWIND_BUFFER_H
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SAVE_STATE_H
+#define SAVE_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cpu.h"
+
+// Versioned binary snapshot of a CPU and its memory. The buffer is the serialized format, so it
+// can be written out as is: a little-endian header with the version and CPU state, followed by
+// the whole address space. Capture and Restore are a few bulk copies. Mappings, protection and
+// watchpoints belong to the machine's setup rather than its state: they are not saved, and
+// read-only pages keep their contents on Restore.
+class SaveState
+{
+   public:
+    static const uint32_t magic = 0x32303536;  // "6502"
+    static const uint16_t version = 1;
+    static const size_t header_size = 32;
+    static const size_t size = header_size + Mem::max_size;
+
+    SaveState();
+    SaveState(const CPU& cpu, const Mem& memory);
+
+    // Parses a serialized state, throws std::invalid_argument when it is not one, of an
+    // unsupported version or truncated.
+    static SaveState FromBytes(const uint8_t* bytes, size_t length);
+
+    void Capture(const CPU& cpu, const Mem& memory);
+    void Restore(CPU& cpu, Mem& memory) const;
+
+    const std::vector<uint8_t>& Bytes() const;
+    CPU::State CpuState() const;
+    Mem::View Memory() const;
+
+    // The CPU state as the header stores it, for formats that store the memory differently.
+    static const size_t cpu_state_size = 24;
+    static void PutCpuState(const CPU::State& state, uint8_t* out);
+    static CPU::State GetCpuState(const uint8_t* in);
+
+   private:
+    std::vector<uint8_t> bytes;
+};
+
+#endif  // SAVE_STATE_H
@@ -0,0 +1,179 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cpu.h"
+
+struct SchedulerConfig
+{
+    // Worker threads, 0 uses every hardware thread.
+    unsigned threads = 0;
+
+    // Cycles an instance runs before the next one gets its turn.
+    uint32_t slice = 10000;
+
+    // Quotas are cycles per period.
+    std::chrono::microseconds period{10000};
+};
+
+// Time-slices long-lived CPU and memory instances over a fixed set of worker threads. The
+// instance that has used the least cycles relative to its priority runs next, so an instance
+// of priority 2 gets twice the cycles of one of priority 1 while both are runnable. Instances
+// that halt or wait for input are parked until woken and take no worker time.
+class Scheduler
+{
+   public:
+    using Id = uint32_t;
+
+    enum class State
+    {
+        Ready,      // Waiting for a worker.
+        Running,    // On a worker.
+        Throttled,  // Used its quota for this period.
+        Idle,       // Reached one of its idle addresses, waits for Wake.
+        Halted,     // Jumped to itself or failed, waits for Wake.
+        Stopped     // Stopped by one of the caller's watchpoints, waits for Wake.
+    };
+
+    struct Options
+    {
+        // Share of the cycles relative to the other instances, at least 1.
+        unsigned priority = 1;
+
+        // Cycles per period, 0 for no limit.
+        uint32_t quota = 0;
+
+        // Addresses of loops that wait for input, such as one polling a device register. The
+        // instance parks when it is about to execute one of them.
+        std::vector<uint16_t> idle_addresses;
+    };
+
+    struct Stats
+    {
+        State state = State::Ready;
+        uint64_t cycles = 0;
+        uint64_t slices = 0;
+        uint64_t parks = 0;
+
+        // Time from becoming runnable to getting a worker, over all slices.
+        std::chrono::nanoseconds total_latency{0};
+        std::chrono::nanoseconds max_latency{0};
+
+        // The message of the exception that halted the instance, such as an illegal opcode.
+        std::string error;
+    };
+
+    explicit Scheduler(const SchedulerConfig& config);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Schedules an instance at once. The scheduler adds execute watchpoints for the idle
+    // addresses to the memory, which must outlive the instance's removal.
+    Id Add(CPU& cpu, Mem& memory, const Options& options);
+    Id Add(CPU& cpu, Mem& memory);
+    // Throws std::invalid_argument for an unknown instance, like the calls below, also when
+    // another thread removes the instance while this one waits for it.
+    void Remove(Id id);
+
+    // Makes a parked instance runnable again. Waking an instance that is running keeps it from
+    // parking at the end of its slice, so input delivered meanwhile is not missed.
+    void Wake(Id id);
+
+    // Calls function with the instance held off the workers, such as to deliver input.
+    void Access(Id id, const std::function<void(CPU& cpu, Mem& memory)>& function);
+
+    // Waits until the instance is parked, returns false on timeout.
+    bool WaitParked(Id id, std::chrono::milliseconds timeout);
+
+    Stats GetStats(Id id) const;
+    size_t Size() const;
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        CPU& cpu;
+        Mem& memory;
+        Options options;
+        std::vector<int> idle_watchpoints;
+
+        Stats stats = {};
+        bool held = false;
+        bool wake_pending = false;
+
+        // Cycles scaled by the inverse priority, the lowest runs next.
+        uint64_t pass = 0;
+        Clock::time_point runnable_since = {};
+
+        Clock::time_point period_start = {};
+        Clock::time_point throttled_until = {};
+        uint64_t period_cycles = 0;
+    };
+
+    Entry& Find(Id id) const;
+    void MakeReady(Id id, Entry& entry);
+    Entry& Hold(std::unique_lock<std::mutex>& lock, Id id);
+    void Throttle(Id id, Entry& entry);
+    void ReleaseThrottled(Clock::time_point now);
+    void Run();
+
+    SchedulerConfig config;
+
+    mutable std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable slice_done;
+
+    std::unordered_map<Id, std::unique_ptr<Entry>> entries;
+    Id next_id = 1;
+
+    std::set<std::pair<uint64_t, Id>> ready;
+    std::set<std::pair<Clock::time_point, Id>> throttled;
+
+    // Pass of the last instance dispatched. Instances becoming runnable start no lower, so
+    // time spent parked does not turn into a burst of slices.
+    uint64_t virtual_time = 0;
+
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+#endif  // SCHEDULER_H
@@ -0,0 +1,268 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SESSION_SERVER_H
+#define SESSION_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cpu.h"
+#include "instance_pool.h"
+#include "snapshot_codec.h"
+#include "thread_pool.h"
+
+// Wire format of the session protocol. Every message is a frame: a 32-bit payload length
+// followed by the payload, all integers little-endian. A request payload is a sequence of
+// operations, each an opcode byte and its arguments. The response payload holds one result per
+// operation in the same order: a status byte, then the values of the operation on success or a
+// 16-bit length and message on failure. A malformed operation fails and ends the request.
+namespace session_protocol
+{
+enum Opcode : uint8_t
+{
+    kCreate = 1,        // -> u32 session
+    kDestroy = 2,       // u32 session
+    kReset = 3,         // u32 session, loads the program counter from the reset vector
+    kWrite = 4,         // u32 session, u16 address, u32 length, bytes
+    kRead = 5,          // u32 session, u16 address, u32 length -> u32 length, bytes
+    kRun = 6,           // u32 session, u32 cycles -> u32 cycles used
+    kGetRegisters = 7,  // u32 session -> u16 PC, u8 SP, A, X, Y, PS
+    kSetRegisters = 8   // u32 session, u16 PC, u8 SP, A, X, Y, PS
+};
+
+enum Status : uint8_t
+{
+    kOk = 0,
+    kError = 1
+};
+}  // namespace session_protocol
+
+struct ServerConfig
+{
+    // UNIX domain socket to listen on, replaced if it exists. Empty only serves Handle.
+    std::string socket_path;
+
+    size_t max_sessions = 4096;
+
+    // Sessions with an instance, 0 for max_sessions. When every instance is in use, creating
+    // or waking a session hibernates the least recently used idle one.
+    size_t max_resident = 0;
+
+    // Serve hibernates sessions idle for this long, 0 never does.
+    std::chrono::milliseconds hibernate_after{0};
+
+    // Workers executing requests, 0 uses every hardware thread.
+    unsigned threads = 0;
+
+    // Connections sending a larger frame are closed.
+    uint32_t max_frame = 16 * 1024 * 1024;
+};
+
+// Hosts CPU and memory sessions for other processes on the same machine. An epoll loop accepts
+// connections and reads request frames, the worker pool executes them. A connection has one
+// request in flight at a time and gets its responses in order, requests of different
+// connections run in parallel. Operations on one session are serialized. A hibernated session
+// is kept as a compressed snapshot without an instance, the next operation on it wakes it.
+class SessionServer
+{
+   public:
+    explicit SessionServer(const ServerConfig& config);
+    ~SessionServer();
+
+    SessionServer(const SessionServer&) = delete;
+    SessionServer& operator=(const SessionServer&) = delete;
+
+    // Executes a request payload and returns the response payload. Thread-safe.
+    std::vector<uint8_t> Handle(const uint8_t* request, size_t length);
+
+    // Runs the event loop until Stop is called, from any thread or a signal handler.
+    void Serve();
+    void Stop() noexcept;
+
+    size_t Sessions() const;
+
+    // Compresses the session into memory and releases its instance and the pages of its image.
+    // Returns false when it already is hibernated. Throws std::invalid_argument for an
+    // unknown session.
+    bool Hibernate(uint32_t id);
+
+    // Hibernates every session idle for at least idle, skipping busy ones, and returns how
+    // many.
+    size_t HibernateIdle(std::chrono::milliseconds idle);
+
+    // Sessions with an instance, and the bytes of the snapshots of the others.
+    size_t Resident() const;
+    size_t HibernatedBytes() const;
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    // Guarded by its mutex. A hibernated session has a snapshot instead of an instance.
+    struct Session
+    {
+        std::mutex mutex;
+        InstancePool::Instance* instance;
+        std::vector<uint8_t> snapshot;
+        Clock::time_point last_used;
+    };
+
+    struct Connection
+    {
+        int fd = -1;
+
+        // Received bytes, the first consumed of them already dispatched.
+        std::vector<uint8_t> input;
+        size_t consumed = 0;
+
+        std::vector<uint8_t> output;
+        size_t written = 0;
+        bool busy = false;
+
+        // The epoll events currently requested.
+        uint32_t events = 0;
+    };
+
+    std::shared_ptr<Session> Find(uint32_t id);
+    uint32_t Create();
+    void Destroy(uint32_t id);
+
+    // Need the lock of the session.
+    void Wake(Session& session);
+    void Suspend(Session& session);
+
+    // Need sessions_mutex and the lock of the session.
+    void Release(Session& session, std::vector<uint8_t> snapshot);
+
+    // Needs sessions_mutex held by lock. Hibernates the least recently used idle session other
+    // than waking when every instance is in use, dropping lock while it compresses.
+    InstancePool::Instance* AcquireInstance(std::unique_lock<std::mutex>& lock,
+                                            const Session* waking);
+
+    void Accept();
+    void Receive(uint64_t id);
+    void Dispatch(uint64_t id);
+    void Flush(uint64_t id);
+    void Complete();
+    void Close(uint64_t id);
+    void Watch(uint64_t id);
+
+    ServerConfig config;
+
+    mutable std::mutex sessions_mutex;
+    InstancePool instances;
+    std::unordered_map<uint32_t, std::shared_ptr<Session>> sessions;
+    uint32_t next_session = 1;
+    size_t hibernated_bytes = 0;
+    SnapshotCodec codec;
+
+    int listener = -1;
+    int epoll = -1;
+    int wakeup = -1;
+    std::atomic<bool> stopping{false};
+
+    // Owned by the event loop thread. Ids 0 and 1 are the listener and wakeup descriptors.
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t next_connection = 2;
+
+    // Responses finished by workers, picked up by the event loop.
+    std::mutex completed_mutex;
+    std::vector<std::pair<uint64_t, std::vector<uint8_t>>> completed;
+
+    // Last, so workers finish before the members they use are destroyed.
+    ThreadPool pool;
+};
+
+// Builds a request payload operation by operation.
+class SessionRequest
+{
+   public:
+    void Create();
+    void Destroy(uint32_t session);
+    void Reset(uint32_t session);
+    void Write(uint32_t session, uint16_t address, const std::vector<uint8_t>& bytes);
+    void Read(uint32_t session, uint16_t address, uint32_t length);
+    void Run(uint32_t session, uint32_t cycles);
+    void GetRegisters(uint32_t session);
+    void SetRegisters(uint32_t session, const CPU::Registers& registers);
+
+    const std::vector<uint8_t>& Payload() const;
+    const std::vector<session_protocol::Opcode>& Operations() const;
+
+   private:
+    void Begin(session_protocol::Opcode opcode, uint32_t session);
+
+    std::vector<uint8_t> payload;
+    std::vector<session_protocol::Opcode> operations;
+};
+
+// Decodes a response payload with the operations of its request.
+class SessionResponse
+{
+   public:
+    struct Result
+    {
+        bool ok = false;
+        std::string error;
+
+        uint32_t session = 0;
+        uint32_t cycles = 0;
+        std::vector<uint8_t> bytes;
+        CPU::Registers registers = {};
+    };
+
+    // Throws std::invalid_argument when the payload does not match the request.
+    SessionResponse(const SessionRequest& request, const std::vector<uint8_t>& payload);
+
+    const std::vector<Result>& Results() const;
+    const Result& operator[](size_t index) const;
+
+   private:
+    std::vector<Result> results;
+};
+
+// Blocking connection to a SessionServer socket.
+class SessionClient
+{
+   public:
+    explicit SessionClient(const std::string& socket_path);
+    ~SessionClient();
+
+    SessionClient(const SessionClient&) = delete;
+    SessionClient& operator=(const SessionClient&) = delete;
+
+    SessionResponse Call(const SessionRequest& request);
+
+   private:
+    int fd = -1;
+};
+
+#endif  // SESSION_SERVER_H
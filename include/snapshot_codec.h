@@ -0,0 +1,81 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SNAPSHOT_CODEC_H
+#define SNAPSHOT_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu.h"
+
+// Compressed snapshots of a CPU and its memory for archives, with a built-in compressor. A
+// little-endian header holds the magic, version, fingerprint of the reference image and the CPU
+// state in the layout of SaveState. A map with a kind byte per page follows: zero pages cost
+// that byte, pages found anywhere in the reference image one more for its page number. The
+// remaining pages are stored in ascending order as one LZ stream of sequences in the style of
+// LZ4: a token with the literal length in the high and the match length minus 4 in the low
+// nibble, both extended by bytes while they read 15 or 255, the literals, then a 16-bit match
+// offset of at most window. The last sequence has no match.
+class SnapshotCodec
+{
+   public:
+    static const uint32_t magic = 0x5A303536;  // "650Z"
+    static const uint16_t version = 1;
+    static const size_t window = 16 * 1024;
+
+    enum Page : uint8_t
+    {
+        kZero = 0,
+        kStored = 1,
+        kReference = 2  // u8 page of the reference image
+    };
+
+    // Without a reference image only zero pages are deduplicated.
+    SnapshotCodec();
+
+    // reference is a whole address space, such as the memory of a SaveState taken right after
+    // loading the ROMs. The codec keeps a copy.
+    explicit SnapshotCodec(Mem::View reference);
+
+    std::vector<uint8_t> Compress(const CPU& cpu, const Mem& memory) const;
+
+    // Decodes the stored pages into a window that slides over them and loads each into the
+    // memory as soon as it is complete. Like SaveState, read-only pages keep their contents.
+    // Throws std::invalid_argument when the bytes are not a snapshot or were compressed with
+    // another reference image; the memory may be partially restored then.
+    void Decompress(const uint8_t* bytes, size_t length, CPU& cpu, Mem& memory) const;
+    void Decompress(const std::vector<uint8_t>& bytes, CPU& cpu, Mem& memory) const;
+
+   private:
+    std::vector<uint8_t> reference;
+    uint64_t fingerprint = 0;
+
+    // Reference pages by the hash of their contents, the first of equal pages.
+    std::unordered_map<uint64_t, uint8_t> reference_pages;
+};
+
+#endif  // SNAPSHOT_CODEC_H
@@ -0,0 +1,104 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing thread pool. Every worker owns a deque of tasks: it runs its own tasks
+// newest first and, when it runs dry, steals the oldest task of another worker. Tasks submitted
+// from a worker go to that worker's deque, so divide-and-conquer work stays local until an idle
+// worker takes it. Tasks must not throw.
+class ThreadPool
+{
+   public:
+    using Task = std::function<void()>;
+
+    // A thread count of 0 uses every hardware thread.
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Counts the unfinished tasks submitted with it, so a caller waits for its own work only.
+    // Must outlive those tasks.
+    struct Group
+    {
+        std::atomic<size_t> pending{0};
+    };
+
+    void Submit(Task task);
+    void Submit(Task task, Group& group);
+
+    // Blocks until every submitted task, including the ones they submitted, has finished. Called
+    // from a task, the tasks running on the calling thread are not waited for.
+    void Wait();
+
+    // Blocks until every task of group has finished. A worker helps out meanwhile.
+    void Wait(Group& group);
+
+    unsigned Size() const;
+
+    // Index of the worker running the calling thread, or -1 outside of this pool.
+    int CurrentWorker() const;
+
+   private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void Run(unsigned index);
+    bool TryRun(unsigned index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> pending{0};
+    std::atomic<unsigned> next_worker{0};
+    bool stopping = false;
+};
+
+// Calls body(begin, end) on the pool for ranges covering [0, count), each at most grain long.
+// Ranges split in halves until they are small, so idle workers steal the large halves. Returns
+// once every range has run, other work on the pool is not waited for.
+void ParallelFor(ThreadPool& pool, uint64_t count, uint64_t grain,
+                 const std::function<void(uint64_t, uint64_t)>& body);
+
+#endif  // THREAD_POOL_H
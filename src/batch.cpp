@@ -0,0 +1,121 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "batch.h"
+
+#include <exception>
+
+namespace
+{
+struct Machine
+{
+    CPU cpu;
+    Mem memory;
+};
+
+// Jobs per task below which a range is no longer split.
+const size_t grain = 4;
+
+BatchResult RunJob(const BatchJob& job, Machine& machine, ResultCache* cache)
+{
+    CPU& cpu = machine.cpu;
+    Mem& memory = machine.memory;
+    BatchResult result;
+
+    // Pool tasks must not throw, so a job that cannot be set up fails on its own as well.
+    std::vector<int> watchpoints;
+    try
+    {
+        cpu.PowerOn(memory);
+        if (job.image)
+            memory.Load(job.load_address, *job.image);
+
+        if (job.registers)
+            cpu.SetRegisters(*job.registers);
+        else
+            cpu.Reset(memory);
+
+        for (uint16_t address : job.stop_addresses)
+            watchpoints.push_back(memory.AddWatchpoint(address, address, Mem::kExecute));
+
+        if (cache)
+        {
+            // The stop addresses are the only setup of the memory besides its contents.
+            uint64_t parameters = job.stop_addresses.size();
+            for (uint16_t address : job.stop_addresses)
+                parameters = (parameters ^ address) * 0x9E3779B97F4A7C15;
+            result.cycles = cache->Execute(job.cycles, cpu, memory, parameters);
+        }
+        else
+        {
+            result.cycles = cpu.Execute(job.cycles, memory);
+        }
+        result.stopped = (cpu.stop_reason == CPU::StopReason::Watchpoint);
+    }
+    catch (const std::exception& e)
+    {
+        result.error = e.what();
+    }
+
+    for (int id : watchpoints)
+        memory.RemoveWatchpoint(id);
+
+    result.registers = cpu.GetRegisters();
+    return result;
+}
+}  // namespace
+
+std::vector<BatchResult> RunBatch(const std::vector<BatchJob>& jobs, ThreadPool& pool,
+                                  const BatchInspector& inspect, ResultCache* cache)
+{
+    std::vector<BatchResult> results(jobs.size());
+    std::vector<std::unique_ptr<Machine>> machines(pool.Size());
+
+    ParallelFor(pool, jobs.size(), grain,
+                [&](uint64_t begin, uint64_t end)
+                {
+                    std::unique_ptr<Machine>& machine = machines[pool.CurrentWorker()];
+                    if (!machine)
+                        machine = std::make_unique<Machine>();
+
+                    for (uint64_t i = begin; i < end; i++)
+                    {
+                        results[i] = RunJob(jobs[i], *machine, cache);
+                        if (!inspect)
+                            continue;
+
+                        try
+                        {
+                            inspect(i, machine->cpu, machine->memory);
+                        }
+                        catch (const std::exception& e)
+                        {
+                            if (results[i].error.empty())
+                                results[i].error = e.what();
+                        }
+                    }
+                });
+
+    return results;
+}
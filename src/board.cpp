@@ -0,0 +1,217 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "board.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+Board::Board(const BoardConfig& config)
+    : config(config),
+      pool(config.threads ? config.threads : std::max<size_t>(config.processors, 2) - 1)
+{
+    if (config.processors == 0)
+        throw std::invalid_argument("A board needs at least one processor");
+    if (config.quantum == 0)
+        throw std::invalid_argument("The quantum must not be zero");
+
+    for (const Mem::Range& range : config.shared)
+    {
+        if (range.begin >= range.end || range.end > Mem::max_size)
+            throw std::invalid_argument("Invalid shared range");
+    }
+
+    const uint8_t access = Mem::kWrite | (config.sync_on_shared_access ? Mem::kRead : 0);
+
+    for (size_t index = 0; index < config.processors; index++)
+    {
+        nodes.push_back(std::make_unique<Node>());
+        Node& node = *nodes.back();
+
+        for (const Mem::Range& range : config.shared)
+            node.shared_watchpoints.push_back(
+                node.memory.AddWatchpoint(range.begin, range.end - 1, access));
+
+        node.memory.SetWatchCallback(
+            [this, &node](const Mem::WatchHit& hit)
+            {
+                const std::vector<int>& shared = node.shared_watchpoints;
+                if (std::find(shared.begin(), shared.end(), hit.id) == shared.end())
+                {
+                    node.watch_stopped = true;
+                    return true;
+                }
+
+                if (hit.access == Mem::kWrite)
+                    node.shared_writes.push_back(hit.address);
+
+                return this->config.sync_on_shared_access;
+            });
+    }
+}
+
+size_t Board::Size() const
+{
+    return nodes.size();
+}
+
+CPU& Board::Processor(size_t index)
+{
+    return nodes.at(index)->cpu;
+}
+
+Mem& Board::Memory(size_t index)
+{
+    return nodes.at(index)->memory;
+}
+
+void Board::PowerOn()
+{
+    for (std::unique_ptr<Node>& node : nodes)
+    {
+        node->cpu.PowerOn(node->memory);
+        node->clock = boundary;
+        node->error.clear();
+    }
+}
+
+bool Board::Run(uint64_t cycles)
+{
+    // Processors stopped on a watchpoint of the caller are behind the others.
+    uint64_t start = boundary;
+    for (std::unique_ptr<Node>& node : nodes)
+    {
+        if (node->in_pass)
+            start = std::min(start, node->clock);
+        node->watch_stopped = false;
+    }
+
+    const uint64_t end = start + cycles;
+
+    while (true)
+    {
+        // A pass stopped on a watchpoint of the caller continues before a new one starts.
+        std::vector<Node*> running;
+        for (std::unique_ptr<Node>& node : nodes)
+        {
+            if (node->in_pass)
+                running.push_back(node.get());
+        }
+
+        if (running.empty())
+        {
+            for (std::unique_ptr<Node>& node : nodes)
+            {
+                node->in_pass = node->error.empty() && node->clock < boundary;
+                if (node->in_pass)
+                    running.push_back(node.get());
+            }
+        }
+
+        if (running.empty())
+        {
+            if (boundary >= end)
+                return false;
+
+            // Rounds end at multiples of the quantum wherever a Run starts.
+            boundary = std::min((boundary / config.quantum + 1) * config.quantum, end);
+            continue;
+        }
+
+        // The calling thread runs one processor itself instead of waiting idle.
+        for (size_t index = 1; index < running.size(); index++)
+            pool.Submit([this, node = running[index]] { RunQuantum(*node); });
+        RunQuantum(*running.front());
+        pool.Wait();
+
+        // Processors stopped by the caller have not finished the pass, so the synchronization
+        // happens at the same point as without their watchpoints.
+        const bool finished = std::none_of(running.begin(), running.end(),
+                                           [](const Node* node) { return node->in_pass; });
+        if (finished)
+        {
+            Synchronize();
+            rounds++;
+        }
+
+        const bool stopped = std::any_of(running.begin(), running.end(),
+                                         [](const Node* node) { return node->watch_stopped; });
+        if (stopped)
+            return true;
+    }
+}
+
+bool Board::Stopped(size_t index) const
+{
+    return nodes.at(index)->watch_stopped;
+}
+
+uint64_t Board::Cycles(size_t index) const
+{
+    return nodes.at(index)->clock;
+}
+
+const std::string& Board::Error(size_t index) const
+{
+    return nodes.at(index)->error;
+}
+
+void Board::RunQuantum(Node& node)
+{
+    try
+    {
+        node.clock += node.cpu.Execute(boundary - node.clock, node.memory);
+        node.in_pass = node.watch_stopped && node.clock < boundary;
+    }
+    catch (const std::exception& e)
+    {
+        node.error = e.what();
+        node.in_pass = false;
+    }
+}
+
+// Shared writes of the round are applied to every memory in processor order, the writer's
+// included, so all copies agree even when processors wrote the same address.
+void Board::Synchronize()
+{
+    for (std::unique_ptr<Node>& node : nodes)
+    {
+        const Mem& memory = node->memory;
+
+        node->pending.clear();
+        for (uint16_t address : node->shared_writes)
+            node->pending.emplace_back(address, memory[address]);
+        node->shared_writes.clear();
+    }
+
+    for (std::unique_ptr<Node>& node : nodes)
+    {
+        for (const auto& [address, value] : node->pending)
+        {
+            for (std::unique_ptr<Node>& other : nodes)
+                other->memory[address] = value;
+        }
+    }
+}
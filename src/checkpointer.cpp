@@ -0,0 +1,260 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "checkpointer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace
+{
+const CheckpointConfig& Validate(const CheckpointConfig& config)
+{
+    if (config.path.empty() || config.interval == 0)
+        throw std::invalid_argument("Checkpoints need a path and a non-zero interval");
+    return config;
+}
+
+SnapshotCodec MakeCodec(const std::vector<uint8_t>& reference)
+{
+    if (reference.empty())
+        return SnapshotCodec();
+    return SnapshotCodec(Mem::View(reference.data(), reference.size()));
+}
+
+[[noreturn]] void Fail(const std::string& message)
+{
+    throw std::system_error(errno, std::generic_category(), message);
+}
+
+void Sync(int fd, const std::string& path)
+{
+    const int result = fsync(fd);
+    const int code = errno;
+    close(fd);
+    if (result < 0)
+        throw std::system_error(code, std::generic_category(), "Unable to sync " + path);
+}
+}  // namespace
+
+Checkpointer::Checkpointer(const CheckpointConfig& config)
+    : config(Validate(config)),
+      codec(MakeCodec(config.reference)),
+      spare(std::make_unique<Slot>()),
+      writer(&Checkpointer::Write, this)
+{
+}
+
+Checkpointer::~Checkpointer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    checkpoint_queued.notify_one();
+    writer.join();
+}
+
+bool Checkpointer::Resume(CPU& cpu, Mem& memory)
+{
+    const int fd = open(config.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT)
+        return false;
+    if (fd < 0)
+        Fail("Unable to open " + config.path);
+
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[64 * 1024];
+    ssize_t count;
+    while ((count = read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+        {
+            const int code = errno;
+            close(fd);
+            throw std::system_error(code, std::generic_category(), "Unable to read " + config.path);
+        }
+
+        bytes.insert(bytes.end(), buffer, buffer + count);
+    }
+    close(fd);
+
+    codec.Decompress(bytes, cpu, memory);
+    due = cpu.cycles + config.interval;
+    scheduled = true;
+    return true;
+}
+
+uint32_t Checkpointer::Execute(uint32_t machine_cycles, CPU& cpu, Mem& memory)
+{
+    if (!scheduled)
+    {
+        due = cpu.cycles + config.interval;
+        scheduled = true;
+    }
+
+    uint32_t used = 0;
+    while (used < machine_cycles)
+    {
+        const uint64_t slice = std::min<uint64_t>(machine_cycles - used, due - cpu.cycles);
+        used += cpu.Execute(static_cast<uint32_t>(slice), memory);
+
+        if (cpu.cycles >= due)
+            Checkpoint(cpu, memory);
+        if (cpu.stop_reason == CPU::StopReason::Watchpoint)
+            break;
+    }
+
+    return used;
+}
+
+void Checkpointer::Checkpoint(const CPU& cpu, const Mem& memory)
+{
+    spare->cpu.SetState(cpu.GetState());
+    spare->memory = memory;
+    due = cpu.cycles + config.interval;
+    scheduled = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.taken++;
+        if (queued)
+        {
+            stats.replaced++;
+            std::swap(spare, queued);
+        }
+        else
+        {
+            // A third slot is only needed once a checkpoint is taken during a write.
+            queued = std::move(spare);
+            spare = free_slot ? std::move(free_slot) : std::make_unique<Slot>();
+        }
+    }
+
+    checkpoint_queued.notify_one();
+}
+
+void Checkpointer::Flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    checkpoint_written.wait(lock, [this] { return !queued && !writing; });
+    if (error)
+        std::rethrow_exception(std::exchange(error, nullptr));
+}
+
+Checkpointer::Stats Checkpointer::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void Checkpointer::Write()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        checkpoint_queued.wait(lock, [this] { return queued || stopping; });
+        if (!queued)
+            return;
+
+        std::unique_ptr<Slot> slot = std::move(queued);
+        writing = true;
+        lock.unlock();
+
+        std::exception_ptr failure;
+        size_t bytes = 0;
+        try
+        {
+            bytes = Persist(*slot);
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
+
+        lock.lock();
+        writing = false;
+        if (failure)
+        {
+            error = failure;
+        }
+        else
+        {
+            stats.written++;
+            stats.written_cycle = slot->cpu.cycles;
+            stats.written_bytes = bytes;
+        }
+
+        free_slot = std::move(slot);
+        checkpoint_written.notify_all();
+    }
+}
+
+size_t Checkpointer::Persist(const Slot& slot) const
+{
+    const std::vector<uint8_t> bytes = codec.Compress(slot.cpu, slot.memory);
+
+    const std::string temporary = config.path + ".tmp";
+    const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        Fail("Unable to create " + temporary);
+
+    for (size_t written = 0; written < bytes.size();)
+    {
+        const ssize_t count = write(fd, bytes.data() + written, bytes.size() - written);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+        {
+            const int code = errno;
+            close(fd);
+            throw std::system_error(code, std::generic_category(), "Unable to write " + temporary);
+        }
+
+        written += count;
+    }
+
+    Sync(fd, temporary);
+    if (rename(temporary.c_str(), config.path.c_str()) < 0)
+        Fail("Unable to rename " + temporary);
+
+    // The rename itself is only durable once the directory is synced.
+    const size_t slash = config.path.rfind('/');
+    const std::string directory =
+        slash == std::string::npos ? "." : slash == 0 ? "/" : config.path.substr(0, slash);
+    const int directory_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory_fd < 0)
+        Fail("Unable to open " + directory);
+    Sync(directory_fd, directory);
+    return bytes.size();
+}
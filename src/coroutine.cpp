@@ -0,0 +1,133 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "coroutine.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+EmulationTask::EmulationTask(EmulationTask&& other) noexcept
+    : handle(std::exchange(other.handle, nullptr))
+{
+}
+
+EmulationTask& EmulationTask::operator=(EmulationTask&& other) noexcept
+{
+    std::swap(handle, other.handle);
+    return *this;
+}
+
+EmulationTask::~EmulationTask()
+{
+    if (handle)
+        handle.destroy();
+}
+
+EmulationScheduler::EmulationScheduler(uint32_t slice) : slice(slice)
+{
+    if (slice == 0)
+        throw std::invalid_argument("The slice must not be zero");
+}
+
+EmulationScheduler::~EmulationScheduler()
+{
+    for (std::coroutine_handle<EmulationTask::promise_type> task : tasks)
+        task.destroy();
+}
+
+void EmulationScheduler::Spawn(EmulationTask task)
+{
+    std::coroutine_handle<EmulationTask::promise_type> handle =
+        std::exchange(task.handle, nullptr);
+
+    tasks.push_back(handle);
+    ready.push_back({handle, nullptr});
+}
+
+void EmulationScheduler::Run()
+{
+    while (!ready.empty())
+    {
+        Entry entry = ready.front();
+        ready.pop_front();
+
+        // Unfinished emulations go to the back of the queue.
+        if (entry.emulation && !Step(*entry.emulation))
+        {
+            ready.push_back(entry);
+            continue;
+        }
+
+        Resume(entry.handle);
+    }
+}
+
+size_t EmulationScheduler::Active() const
+{
+    return tasks.size();
+}
+
+bool EmulationScheduler::Step(EmulateAwaiter& emulation)
+{
+    Result& result = emulation.result;
+    const uint32_t budget = std::min(slice, emulation.cycles - result.cycles);
+    slices++;
+
+    try
+    {
+        result.cycles += emulation.cpu.Execute(budget, emulation.memory);
+    }
+    catch (const std::exception& e)
+    {
+        result.event = Event::Error;
+        result.error = e.what();
+        return true;
+    }
+
+    if (emulation.cpu.stop_reason == CPU::StopReason::Watchpoint)
+    {
+        result.event = Event::Watchpoint;
+        result.hit = emulation.memory.LastWatchHit();
+        return true;
+    }
+
+    return result.cycles >= emulation.cycles;
+}
+
+// Every handle in the queue belongs to a spawned task, awaiting is only done by tasks.
+void EmulationScheduler::Resume(std::coroutine_handle<> handle)
+{
+    auto task = std::coroutine_handle<EmulationTask::promise_type>::from_address(handle.address());
+    task.resume();
+    if (!task.done())
+        return;
+
+    std::exception_ptr exception = task.promise().exception;
+    tasks.erase(std::find(tasks.begin(), tasks.end(), task));
+    task.destroy();
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
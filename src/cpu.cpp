@@ -27,14 +27,26 @@
 #include <iomanip>
 #include <sstream>
 
+#include "alu.h"
+#include "opcode_table.h"
+
 #define ADD_DISPATCH(HEX, NAME, CYCLES, ADDRESSING_MODE) \
     instruction.addr = &CPU::Addr##ADDRESSING_MODE;      \
     instruction.op = &CPU::Op##NAME;                     \
     instruction.cycles = CYCLES;                         \
-    dispatch_table[HEX] = instruction
+    dispatch_table[HEX] = instruction;
 
-CPU::CPU()
+// Shared by every instance, built on first use.
+const std::array<CPU::Instruction, 256>& CPU::DispatchTable()
 {
+    static const std::array<Instruction, 256> dispatch_table = MakeDispatchTable();
+    return dispatch_table;
+}
+
+std::array<CPU::Instruction, 256> CPU::MakeDispatchTable()
+{
+    std::array<Instruction, 256> dispatch_table;
+
     // Prefill dispatch table with illegal opcode handlers
     Instruction instruction;
     instruction.addr = &CPU::AddrOpcode;
@@ -42,199 +54,22 @@ CPU::CPU()
     instruction.cycles = 0;
     dispatch_table.fill(instruction);
 
-    // LOAD & STORE
-    ADD_DISPATCH(0xA9, LDA, 2, Immediate);
-    ADD_DISPATCH(0xA5, LDA, 3, ZeroPage);
-    ADD_DISPATCH(0xB5, LDA, 4, ZeroPageX);
-    ADD_DISPATCH(0xAD, LDA, 4, Absolute);
-    ADD_DISPATCH(0xBD, LDA, 4, AbsoluteX);
-    ADD_DISPATCH(0xB9, LDA, 4, AbsoluteY);
-    ADD_DISPATCH(0xA1, LDA, 6, IndexedIndirect);
-    ADD_DISPATCH(0xB1, LDA, 5, IndirectIndexed);
-
-    ADD_DISPATCH(0xA2, LDX, 2, Immediate);
-    ADD_DISPATCH(0xA6, LDX, 3, ZeroPage);
-    ADD_DISPATCH(0xB6, LDX, 4, ZeroPageY);
-    ADD_DISPATCH(0xAE, LDX, 4, Absolute);
-    ADD_DISPATCH(0xBE, LDX, 4, AbsoluteY);
-
-    ADD_DISPATCH(0xA0, LDY, 2, Immediate);
-    ADD_DISPATCH(0xA4, LDY, 3, ZeroPage);
-    ADD_DISPATCH(0xB4, LDY, 4, ZeroPageX);
-    ADD_DISPATCH(0xAC, LDY, 4, Absolute);
-    ADD_DISPATCH(0xBC, LDY, 4, AbsoluteX);
-
-    ADD_DISPATCH(0x85, STA, 3, ZeroPage);
-    ADD_DISPATCH(0x95, STA, 4, ZeroPageX);
-    ADD_DISPATCH(0x8D, STA, 4, Absolute);
-    ADD_DISPATCH(0x9D, STA, 5, AbsoluteX5);
-    ADD_DISPATCH(0x99, STA, 5, AbsoluteY5);
-    ADD_DISPATCH(0x81, STA, 6, IndexedIndirect);
-    ADD_DISPATCH(0x91, STA, 6, IndirectIndexed6);
-
-    ADD_DISPATCH(0x86, STX, 3, ZeroPage);
-    ADD_DISPATCH(0x96, STX, 4, ZeroPageY);
-    ADD_DISPATCH(0x8e, STX, 4, Absolute);
-
-    ADD_DISPATCH(0x84, STY, 3, ZeroPage);
-    ADD_DISPATCH(0x94, STY, 4, ZeroPageX);
-    ADD_DISPATCH(0x8C, STY, 4, Absolute);
-
-    // REGISTER TRANSFERS
-    ADD_DISPATCH(0xAA, TAX, 2, Implied);
-    ADD_DISPATCH(0xA8, TAY, 2, Implied);
-    ADD_DISPATCH(0x8A, TXA, 2, Implied);
-    ADD_DISPATCH(0x98, TYA, 2, Implied);
-
-    // STACK OPERATIONS
-    ADD_DISPATCH(0xBA, TSX, 2, Implied);
-    ADD_DISPATCH(0x9A, TXS, 2, Implied);
-    ADD_DISPATCH(0x48, PHA, 3, Implied);
-    ADD_DISPATCH(0x08, PHP, 3, Implied);
-    ADD_DISPATCH(0x68, PLA, 4, Implied);
-    ADD_DISPATCH(0x28, PLP, 4, Implied);
-
-    // LOGICAL OPERATIONS
-    ADD_DISPATCH(0x29, AND, 2, Immediate);
-    ADD_DISPATCH(0x25, AND, 3, ZeroPage);
-    ADD_DISPATCH(0x35, AND, 4, ZeroPageX);
-    ADD_DISPATCH(0x2D, AND, 4, Absolute);
-    ADD_DISPATCH(0x3D, AND, 4, AbsoluteX);
-    ADD_DISPATCH(0x39, AND, 4, AbsoluteY);
-    ADD_DISPATCH(0x21, AND, 6, IndexedIndirect);
-    ADD_DISPATCH(0x31, AND, 5, IndirectIndexed);
-
-    ADD_DISPATCH(0x49, EOR, 2, Immediate);
-    ADD_DISPATCH(0x45, EOR, 3, ZeroPage);
-    ADD_DISPATCH(0x55, EOR, 4, ZeroPageX);
-    ADD_DISPATCH(0x4D, EOR, 4, Absolute);
-    ADD_DISPATCH(0x5D, EOR, 4, AbsoluteX);
-    ADD_DISPATCH(0x59, EOR, 4, AbsoluteY);
-    ADD_DISPATCH(0x41, EOR, 6, IndexedIndirect);
-    ADD_DISPATCH(0x51, EOR, 5, IndirectIndexed);
-
-    ADD_DISPATCH(0x09, ORA, 2, Immediate);
-    ADD_DISPATCH(0x05, ORA, 3, ZeroPage);
-    ADD_DISPATCH(0x15, ORA, 4, ZeroPageX);
-    ADD_DISPATCH(0x0D, ORA, 4, Absolute);
-    ADD_DISPATCH(0x1D, ORA, 4, AbsoluteX);
-    ADD_DISPATCH(0x19, ORA, 4, AbsoluteY);
-    ADD_DISPATCH(0x01, ORA, 6, IndexedIndirect);
-    ADD_DISPATCH(0x11, ORA, 5, IndirectIndexed);
-
-    ADD_DISPATCH(0x24, BIT, 3, ZeroPage);
-    ADD_DISPATCH(0x2C, BIT, 4, Absolute);
-
-    // ARITHMETIC OPERATIONS
-    ADD_DISPATCH(0x69, ADC, 2, Immediate);
-    ADD_DISPATCH(0x65, ADC, 3, ZeroPage);
-    ADD_DISPATCH(0x75, ADC, 4, ZeroPageX);
-    ADD_DISPATCH(0x6D, ADC, 4, Absolute);
-    ADD_DISPATCH(0x7D, ADC, 4, AbsoluteX);
-    ADD_DISPATCH(0x79, ADC, 4, AbsoluteY);
-    ADD_DISPATCH(0x61, ADC, 6, IndexedIndirect);
-    ADD_DISPATCH(0x71, ADC, 5, IndirectIndexed);
-
-    ADD_DISPATCH(0xE9, SBC, 2, Immediate);
-    ADD_DISPATCH(0xE5, SBC, 3, ZeroPage);
-    ADD_DISPATCH(0xF5, SBC, 4, ZeroPageX);
-    ADD_DISPATCH(0xED, SBC, 4, Absolute);
-    ADD_DISPATCH(0xFD, SBC, 4, AbsoluteX);
-    ADD_DISPATCH(0xF9, SBC, 4, AbsoluteY);
-    ADD_DISPATCH(0xE1, SBC, 6, IndexedIndirect);
-    ADD_DISPATCH(0xF1, SBC, 5, IndirectIndexed);
-
-    ADD_DISPATCH(0xC9, CMP, 2, Immediate);
-    ADD_DISPATCH(0xC5, CMP, 3, ZeroPage);
-    ADD_DISPATCH(0xD5, CMP, 4, ZeroPageX);
-    ADD_DISPATCH(0xCD, CMP, 4, Absolute);
-    ADD_DISPATCH(0xDD, CMP, 4, AbsoluteX);
-    ADD_DISPATCH(0xD9, CMP, 4, AbsoluteY);
-    ADD_DISPATCH(0xC1, CMP, 6, IndexedIndirect);
-    ADD_DISPATCH(0xD1, CMP, 5, IndirectIndexed);
-
-    ADD_DISPATCH(0xE0, CPX, 2, Immediate);
-    ADD_DISPATCH(0xE4, CPX, 3, ZeroPage);
-    ADD_DISPATCH(0xEC, CPX, 4, Absolute);
-
-    ADD_DISPATCH(0xC0, CPY, 2, Immediate);
-    ADD_DISPATCH(0xC4, CPY, 3, ZeroPage);
-    ADD_DISPATCH(0xCC, CPY, 4, Absolute);
-
-    // INCREMENT & DECREMENT OPERATIONS
-    ADD_DISPATCH(0xE6, INC, 5, ZeroPage);
-    ADD_DISPATCH(0xF6, INC, 6, ZeroPageX);
-    ADD_DISPATCH(0xEE, INC, 6, Absolute);
-    ADD_DISPATCH(0xFE, INC, 7, AbsoluteX);
-    ADD_DISPATCH(0xE8, INX, 2, Implied);
-    ADD_DISPATCH(0xC8, INY, 2, Implied);
-
-    ADD_DISPATCH(0xC6, DEC, 5, ZeroPage);
-    ADD_DISPATCH(0xD6, DEC, 6, ZeroPageX);
-    ADD_DISPATCH(0xCE, DEC, 6, Absolute);
-    ADD_DISPATCH(0xDE, DEC, 7, AbsoluteX);
-    ADD_DISPATCH(0xCA, DEX, 2, Implied);
-    ADD_DISPATCH(0x88, DEY, 2, Implied);
-
-    // SHIFT OPERATIONS
-    ADD_DISPATCH(0x0A, ASLA, 2, Accumulator);
-    ADD_DISPATCH(0x06, ASL, 5, ZeroPage);
-    ADD_DISPATCH(0x16, ASL, 6, ZeroPageX);
-    ADD_DISPATCH(0x0E, ASL, 6, Absolute);
-    ADD_DISPATCH(0x1E, ASL, 7, AbsoluteX);
-
-    ADD_DISPATCH(0x4A, LSRA, 2, Accumulator);
-    ADD_DISPATCH(0x46, LSR, 5, ZeroPage);
-    ADD_DISPATCH(0x56, LSR, 6, ZeroPageX);
-    ADD_DISPATCH(0x4E, LSR, 6, Absolute);
-    ADD_DISPATCH(0x5E, LSR, 7, AbsoluteX);
-
-    ADD_DISPATCH(0x2A, ROLA, 2, Accumulator);
-    ADD_DISPATCH(0x26, ROL, 5, ZeroPage);
-    ADD_DISPATCH(0x36, ROL, 6, ZeroPageX);
-    ADD_DISPATCH(0x2E, ROL, 6, Absolute);
-    ADD_DISPATCH(0x3E, ROL, 7, AbsoluteX);
-
-    ADD_DISPATCH(0x6A, RORA, 2, Accumulator);
-    ADD_DISPATCH(0x66, ROR, 5, ZeroPage);
-    ADD_DISPATCH(0x76, ROR, 6, ZeroPageX);
-    ADD_DISPATCH(0x6E, ROR, 6, Absolute);
-    ADD_DISPATCH(0x7E, ROR, 7, AbsoluteX);
-
-    // JUMPS & CALLS OPERATIONS
-    ADD_DISPATCH(0x4C, JMP, 3, Absolute);
-    ADD_DISPATCH(0x6C, JMP, 5, Indirect);
-    ADD_DISPATCH(0x20, JSR, 6, Absolute);
-    ADD_DISPATCH(0x60, RTS, 6, Implied);
-
-    // BRANCH OPERATIONS
-    ADD_DISPATCH(0x90, BCC, 2, Relative);
-    ADD_DISPATCH(0xB0, BCS, 2, Relative);
-    ADD_DISPATCH(0xF0, BEQ, 2, Relative);
-    ADD_DISPATCH(0x30, BMI, 2, Relative);
-    ADD_DISPATCH(0xD0, BNE, 2, Relative);
-    ADD_DISPATCH(0x10, BPL, 2, Relative);
-    ADD_DISPATCH(0x50, BVC, 2, Relative);
-    ADD_DISPATCH(0x70, BVS, 2, Relative);
-    // TAKE A LOOK AT THIS, IT IS 2 + 1 OR 2
-    // STATUS FLAG OPERATIONS
-    ADD_DISPATCH(0x18, CLC, 2, Implied);
-    ADD_DISPATCH(0xD8, CLD, 2, Implied);
-    ADD_DISPATCH(0x58, CLI, 2, Implied);
-    ADD_DISPATCH(0xB8, CLV, 2, Implied);
-    ADD_DISPATCH(0x38, SEC, 2, Implied);
-    ADD_DISPATCH(0xF8, SED, 2, Implied);
-    ADD_DISPATCH(0x78, SEI, 2, Implied);
-
-    // // SYSTEM OPERATIONS
-    ADD_DISPATCH(0x00, BRK, 7, Implied);
-    ADD_DISPATCH(0xEA, NOP, 2, Implied);
-    ADD_DISPATCH(0x40, RTI, 6, Implied);
+    MOS6502_OPCODES(ADD_DISPATCH)
+
+    return dispatch_table;
+}
+
+void CPU::PowerOn(Mem& memory)
+{
+    // Clear the memory written since the last power-on.
+    memory.Initialize();
+    cycles = 0;
+
+    Reset(memory);
 }
 
 void CPU::Reset(Mem& memory)
 {
-    PC = 0xFFFC;
     SP = 0xFF;
 
     // Clear processor status flags
@@ -245,14 +80,70 @@ void CPU::Reset(Mem& memory)
     X = 0;
     Y = 0;
 
-    // Fill memory with 0s.
-    memory.Initialize();
+    consume_cycle = false;
+    page_crossed = false;
+    watch_stopped = false;
+
+    // Start executing at the address held by the reset vector.
+    PC = ReadWord(0xFFFC, memory);
+}
+
+bool CPU::Registers::operator==(const Registers& other) const
+{
+    return PC == other.PC && SP == other.SP && A == other.A && X == other.X && Y == other.Y &&
+           PS == other.PS;
+}
+
+bool CPU::Registers::operator!=(const Registers& other) const
+{
+    return !(*this == other);
+}
+
+CPU::Registers CPU::GetRegisters() const
+{
+    return {PC, SP, A, X, Y, PS};
+}
+
+void CPU::SetRegisters(const Registers& registers)
+{
+    PC = registers.PC;
+    SP = registers.SP;
+    A = registers.A;
+    X = registers.X;
+    Y = registers.Y;
+    PS = registers.PS;
+}
+
+CPU::State CPU::GetState() const
+{
+    return {GetRegisters(), cycles, consume_cycle, page_crossed, watch_stopped, watch_stop_pc};
+}
+
+void CPU::SetState(const State& state)
+{
+    SetRegisters(state.registers);
+    cycles = state.cycles;
+    consume_cycle = state.consume_cycle;
+    page_crossed = state.page_crossed;
+    watch_stopped = state.watch_stopped;
+    watch_stop_pc = state.watch_stop_pc;
+}
+
+uint64_t CPU::StateHash(Mem& memory) const
+{
+    uint64_t registers = PC | uint64_t{SP} << 16 | uint64_t{A} << 24 | uint64_t{X} << 32 |
+                         uint64_t{Y} << 40 | uint64_t{PS} << 48;
+
+    // The SplitMix64 finalizer, so the registers do not cancel out against the memory sum.
+    registers = (registers ^ (registers >> 30)) * 0xBF58476D1CE4E5B9;
+    registers = (registers ^ (registers >> 27)) * 0x94D049BB133111EB;
+    return memory.Hash() ^ registers ^ (registers >> 31);
 }
 
 // Fetch a single byte from memory offsetted by the PC.
 uint8_t CPU::FetchByte(Mem& memory)
 {
-    uint8_t b = memory[PC];
+    uint8_t b = memory.Fetch(PC);
     PC++;
 
     return b;
@@ -260,8 +151,8 @@ uint8_t CPU::FetchByte(Mem& memory)
 
 uint16_t CPU::FetchWord(Mem& memory)
 {
-    uint16_t w = memory[PC];
-    w |= (memory[PC + 1] << 8);
+    uint16_t w = memory.Fetch(PC);
+    w |= (memory.Fetch(PC + 1) << 8);
 
     PC += 2;
 
@@ -272,14 +163,14 @@ uint16_t CPU::FetchWord(Mem& memory)
 // increment the program counter.
 uint8_t CPU::ReadByte(uint16_t address, Mem& memory)
 {
-    uint8_t b = memory[address];
+    uint8_t b = memory.Read(address);
 
     return b;
 }
 
 void CPU::StoreByte(uint16_t address, uint8_t value, Mem& memory)
 {
-    memory[address] = value;
+    memory.Write(address, value);
 }
 
 uint16_t CPU::ReadWord(uint16_t address, Mem& memory)
@@ -292,8 +183,8 @@ uint16_t CPU::ReadWord(uint16_t address, Mem& memory)
 
 void CPU::StoreWord(uint16_t address, uint16_t value, Mem& memory)
 {
-    memory[address] = (uint8_t)value << 8;
-    memory[address + 1] = (uint8_t)value >> 8;
+    StoreByte(address, value & 0xFF, memory);
+    StoreByte(address + 1, value >> 8, memory);
 }
 
 void CPU::PushByteToStack(uint8_t value, Mem& memory)
@@ -329,6 +220,10 @@ void CPU::SetFlagsZN(uint8_t reg)
 void CPU::ConditionalBranch(bool flag, bool status, uint16_t address)
 {
     int8_t relative_address = (int8_t)address;
+
+    // Both outcomes are edges, the one not taken goes to the next instruction.
+    RecordEdge(flag == status ? PC + relative_address : PC);
+
     if (flag == status)
     {
         // If the branching is succesful, consume an extra cycle.
@@ -341,44 +236,80 @@ void CPU::ConditionalBranch(bool flag, bool status, uint16_t address)
     }
 }
 
-void CPU::ExecInstruction(Instruction instruction, uint32_t& machine_cycles, Mem& memory)
+void CPU::ExecInstruction(Instruction instruction, uint32_t& machine_cycles_used, Mem& memory)
 {
     uint16_t address = (this->*instruction.addr)(memory);
     (this->*instruction.op)(address, memory);
 
-    machine_cycles -= instruction.cycles;
+    machine_cycles_used += instruction.cycles;
 
     if (consume_cycle)
     {
-        machine_cycles--;
+        machine_cycles_used++;
         consume_cycle = false;
     }
 
     if (page_crossed)
     {
-        machine_cycles--;
+        machine_cycles_used++;
         page_crossed = false;
     }
 }
 
 uint32_t CPU::Execute(uint32_t machine_cycles, Mem& memory)
 {
-    const uint32_t machine_cycles_requested = machine_cycles;
-    while (machine_cycles > 0)
+    const std::array<Instruction, 256>& dispatch_table = DispatchTable();
+    uint32_t machine_cycles_used = 0;
+    stop_reason = StopReason::Cycles;
+
+    bool watch_execute = !(watch_stopped && watch_stop_pc == PC);
+    watch_stopped = false;
+
+    while (machine_cycles_used < machine_cycles)
     {
+        if (watch_execute && memory.WatchExecute(PC))
+        {
+            stop_reason = StopReason::Watchpoint;
+            watch_stopped = true;
+            watch_stop_pc = PC;
+            break;
+        }
+
+        watch_execute = true;
+
         uint8_t instruction = FetchByte(memory);
         Instruction ins = dispatch_table[instruction];
-        ExecInstruction(ins, machine_cycles, memory);
+        ExecInstruction(ins, machine_cycles_used, memory);
+
+        if (memory.ConsumeStop())
+        {
+            stop_reason = StopReason::Watchpoint;
+            break;
+        }
     }
 
-    const uint32_t machine_cycles_used = machine_cycles_requested - machine_cycles;
+    cycles += machine_cycles_used;
     return machine_cycles_used;
 }
 
+bool CPU::RaiseInterrupt(Interrupt interrupt, Mem& memory)
+{
+    if (interrupt == Interrupt::IRQ && I)
+        return false;
+
+    PushWordToStack(PC, memory);
+    PushByteToStack(PS & ~0b00010000, memory);
+    I = true;
+
+    PC = ReadWord(interrupt == Interrupt::NMI ? 0xFFFA : 0xFFFE, memory);
+    cycles += 7;
+    return true;
+}
+
 // Addressing mode functions
 uint16_t CPU::AddrOpcode(Mem& memory)
 {
-    return memory[PC - 1];
+    return memory.Fetch(PC - 1);
 }
 
 uint16_t CPU::AddrAccumulator(Mem&)
@@ -620,60 +551,54 @@ void CPU::OpORA(uint16_t address, Mem& memory)
 
 void CPU::OpBIT(uint16_t address, Mem& memory)
 {
-    uint8_t result = ReadByte(address, memory) & A;
+    const alu::Flags flags = alu::Bit(A, ReadByte(address, memory));
+    Z = flags.zero;
+    V = flags.overflow;
+    N = flags.negative;
+}
 
-    Z = (result == 0);
-    V = result & 0x40;
-    N = (result & 0b1000000) > 0;
+void CPU::AddWithCarry(uint8_t operand)
+{
+    const alu::Sum sum = alu::AddWithCarry(A, operand, C);
+    A = sum.value;
+    V = sum.overflow;
+    C = sum.carry;
+    SetFlagsZN(A);
 }
 
 void CPU::OpADC(uint16_t address, Mem& memory)
 {
-    uint8_t operand = ReadByte(address, memory);
-    const bool sign_bits_match = !(operand & 0b10000000) ^ (A & 0b10000000);
-
-    uint16_t sum = A + C + operand;
-    A = (sum & 0xFF);
-
-    // The addition overflowed if the sign bit of the
-    // operand and the pre-addition accumulator matched and...
-    // if the sign bit of the pre-op accumulator and
-    // the result differ.
-    V = sign_bits_match && ((A ^ operand) & 0b10000000);
-    Z = (A == 0);
-    N = (A & 0b10000000) > 0;
-    C = (sum > 0xFF);
+    AddWithCarry(ReadByte(address, memory));
 }
 
 void CPU::OpSBC(uint16_t address, Mem& memory)
 {
     // Subtraction is the same as addition with the negated operand.
-    memory[address] = ~memory[address];
-    OpADC(address, memory);
+    AddWithCarry(~ReadByte(address, memory));
 }
 
 void CPU::OpCMP(uint16_t address, Mem& memory)
 {
-    uint8_t operand = ReadByte(address, memory);
-    C = (A >= operand);
-    Z = (A == operand);
-    N = ((A - operand) & 0b10000000) > 0;
+    const alu::Flags flags = alu::Compare(A, ReadByte(address, memory));
+    C = flags.carry;
+    Z = flags.zero;
+    N = flags.negative;
 }
 
 void CPU::OpCPX(uint16_t address, Mem& memory)
 {
-    uint8_t operand = ReadByte(address, memory);
-    C = (X >= operand);
-    Z = (X == operand);
-    N = ((X - operand) & 0b10000000) > 0;
+    const alu::Flags flags = alu::Compare(X, ReadByte(address, memory));
+    C = flags.carry;
+    Z = flags.zero;
+    N = flags.negative;
 }
 
 void CPU::OpCPY(uint16_t address, Mem& memory)
 {
-    uint8_t operand = ReadByte(address, memory);
-    C = (Y >= operand);
-    Z = (Y == operand);
-    N = ((Y - operand) & 0b10000000) > 0;
+    const alu::Flags flags = alu::Compare(Y, ReadByte(address, memory));
+    C = flags.carry;
+    Z = flags.zero;
+    N = flags.negative;
 }
 
 void CPU::OpINC(uint16_t address, Mem& memory)
@@ -719,103 +644,87 @@ void CPU::OpDEY(uint16_t address, Mem& memory)
 
 void CPU::OpASLA(uint16_t address, Mem& memory)
 {
-    C = (A & 0b10000000) > 0;
-    A <<= 1;
+    const alu::Shift shift = alu::ShiftLeft(A);
+    A = shift.value;
+    C = shift.carry;
     SetFlagsZN(A);
 }
 
 void CPU::OpASL(uint16_t address, Mem& memory)
 {
-    uint8_t operand = ReadByte(address, memory);
-    C = (operand & 0b10000000) > 0;
-
-    operand <<= 1;
-    StoreByte(address, operand, memory);
-    SetFlagsZN(operand);
+    const alu::Shift shift = alu::ShiftLeft(ReadByte(address, memory));
+    StoreByte(address, shift.value, memory);
+    C = shift.carry;
+    SetFlagsZN(shift.value);
 }
 
 void CPU::OpLSRA(uint16_t address, Mem& memory)
 {
-    C = (A & 0b00000001);
-    A >>= 1;
+    const alu::Shift shift = alu::ShiftRight(A);
+    A = shift.value;
+    C = shift.carry;
     SetFlagsZN(A);
 }
 
 void CPU::OpLSR(uint16_t address, Mem& memory)
 {
-    uint8_t operand = ReadByte(address, memory);
-    C = (operand & 0b00000001);
-
-    operand >>= 1;
-    StoreByte(address, operand, memory);
-    SetFlagsZN(operand);
+    const alu::Shift shift = alu::ShiftRight(ReadByte(address, memory));
+    StoreByte(address, shift.value, memory);
+    C = shift.carry;
+    SetFlagsZN(shift.value);
 }
 
 void CPU::OpROLA(uint16_t address, Mem& memory)
 {
-    const uint8_t operand = A;
-    A <<= 1;
-
-    if (C)
-        A |= 0b00000001;
-
-    C = (operand & 0b10000000) > 0;
+    const alu::Shift shift = alu::RotateLeft(A, C);
+    A = shift.value;
+    C = shift.carry;
     SetFlagsZN(A);
 }
 
 void CPU::OpROL(uint16_t address, Mem& memory)
 {
-    const uint8_t operand = ReadByte(address, memory);
-    uint8_t result = operand << 1;
-
-    if (C)
-        result |= 0b00000001;
-
-    StoreByte(address, result, memory);
-    C = (operand & 0b10000000) > 0;
-    SetFlagsZN(result);
+    const alu::Shift shift = alu::RotateLeft(ReadByte(address, memory), C);
+    StoreByte(address, shift.value, memory);
+    C = shift.carry;
+    SetFlagsZN(shift.value);
 }
 
 void CPU::OpRORA(uint16_t address, Mem& memory)
 {
-    const uint8_t operand = A;
-    A >>= 1;
-
-    if (C)
-        A |= 0b10000000;
-
-    C = (operand & 0b00000001) > 0;
+    const alu::Shift shift = alu::RotateRight(A, C);
+    A = shift.value;
+    C = shift.carry;
     SetFlagsZN(A);
 }
 
 void CPU::OpROR(uint16_t address, Mem& memory)
 {
-    const uint8_t operand = ReadByte(address, memory);
-    uint8_t result = operand >> 1;
-
-    if (C)
-        result |= 0b10000000;
-
-    StoreByte(address, result, memory);
-    C = (operand & 0b00000001) > 0;
-    SetFlagsZN(result);
+    const alu::Shift shift = alu::RotateRight(ReadByte(address, memory), C);
+    StoreByte(address, shift.value, memory);
+    C = shift.carry;
+    SetFlagsZN(shift.value);
 }
 
 // Implements the bug the 6502 has with jumping in the indirect addressing function.
 void CPU::OpJMP(uint16_t address, Mem& memory)
 {
+    RecordEdge(address);
     PC = address;
 }
 
 void CPU::OpJSR(uint16_t address, Mem& memory)
 {
     PushWordToStack(PC - 1, memory);
+    RecordEdge(address);
     PC = address;
 }
 
 void CPU::OpRTS(uint16_t address, Mem& memory)
 {
-    PC = PullWordFromStack(memory);
+    uint16_t target = PullWordFromStack(memory);
+    RecordEdge(target);
+    PC = target;
 }
 
 void CPU::OpBCC(uint16_t address, Mem& memory)
@@ -897,7 +806,10 @@ void CPU::OpBRK(uint16_t address, Mem& memory)
 {
     PushWordToStack(PC, memory);
     PushByteToStack(PS, memory);
-    PC = FetchWord(memory);
+
+    uint16_t target = FetchWord(memory);
+    RecordEdge(target);
+    PC = target;
     B = true;
 }
 
@@ -909,7 +821,10 @@ void CPU::OpNOP(uint16_t address, Mem& memory)
 void CPU::OpRTI(uint16_t address, Mem& memory)
 {
     PS = PullByteFromStack(memory);
-    PC = PullWordFromStack(memory);
+
+    uint16_t target = PullWordFromStack(memory);
+    RecordEdge(target);
+    PC = target;
 }
 
 void CPU::OpIllegal(uint16_t address, Mem& memory)
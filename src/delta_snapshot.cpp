@@ -0,0 +1,141 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "delta_snapshot.h"
+
+#include <stdexcept>
+
+SnapshotChain::SnapshotChain(const CPU& cpu, Mem& memory) : base(cpu, memory)
+{
+    memory.ClearModified();
+}
+
+size_t SnapshotChain::Snapshot(const CPU& cpu, Mem& memory)
+{
+    DeltaSnapshot& delta = deltas.emplace_back();
+    delta.cpu = cpu.GetState();
+
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        if (memory.IsModified(page))
+            delta.pages.push_back(page);
+    }
+
+    delta.contents.resize(delta.pages.size() * Mem::page_size);
+    for (size_t i = 0; i < delta.pages.size(); i++)
+    {
+        memory.Dump(delta.pages[i] * Mem::page_size, &delta.contents[i * Mem::page_size],
+                    Mem::page_size);
+    }
+
+    memory.ClearModified();
+    return deltas.size();
+}
+
+void SnapshotChain::Rebuild(size_t point, CPU& cpu, Mem& memory) const
+{
+    if (point >= Size())
+        throw std::out_of_range("Snapshot point out of range");
+
+    CopyPages(point, PageSet(), memory);
+    cpu.SetState(point ? deltas[point - 1].cpu : base.CpuState());
+}
+
+void SnapshotChain::Rewind(size_t point, CPU& cpu, Mem& memory)
+{
+    if (point >= Size())
+        throw std::out_of_range("Snapshot point out of range");
+
+    // Pages that differ from the point were written after the last snapshot or by a later one.
+    PageSet stale;
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+        stale[page] = memory.IsModified(page);
+    for (size_t later = point; later < deltas.size(); later++)
+    {
+        for (uint8_t page : deltas[later].pages)
+            stale[page] = true;
+    }
+
+    CopyPages(point, ~stale, memory);
+    cpu.SetState(point ? deltas[point - 1].cpu : base.CpuState());
+
+    memory.ClearModified();
+    deltas.resize(point);
+}
+
+size_t SnapshotChain::Size() const
+{
+    return deltas.size() + 1;
+}
+
+const SaveState& SnapshotChain::Base() const
+{
+    return base;
+}
+
+const DeltaSnapshot& SnapshotChain::Delta(size_t point) const
+{
+    if (point == 0 || point >= Size())
+        throw std::out_of_range("Snapshot point out of range");
+
+    return deltas[point - 1];
+}
+
+size_t SnapshotChain::DeltaBytes() const
+{
+    size_t bytes = 0;
+    for (const DeltaSnapshot& delta : deltas)
+        bytes += sizeof(delta) + delta.pages.size() + delta.contents.size();
+    return bytes;
+}
+
+// Copies every page not in done as of point, newest delta first.
+void SnapshotChain::CopyPages(size_t point, PageSet done, Mem& memory) const
+{
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+        done[page] = done[page] || memory.IsReadOnly(page * Mem::page_size);
+
+    for (size_t index = point; index > 0 && !done.all(); index--)
+    {
+        const DeltaSnapshot& delta = deltas[index - 1];
+        for (size_t i = 0; i < delta.pages.size(); i++)
+        {
+            const uint8_t page = delta.pages[i];
+            if (done[page])
+                continue;
+
+            memory.Load(page * Mem::page_size, &delta.contents[i * Mem::page_size],
+                        Mem::page_size);
+            done[page] = true;
+        }
+    }
+
+    const Mem::View contents = base.Memory();
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        if (!done[page])
+            memory.Load(page * Mem::page_size, contents.data() + page * Mem::page_size,
+                        Mem::page_size);
+    }
+}
@@ -0,0 +1,269 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "differential.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "lockstep.h"
+#include "opcode_table.h"
+
+namespace
+{
+class ReferenceEngine : public DiffEngine
+{
+   public:
+    void SetState(const CPU::Registers& registers, const Mem& memory) override
+    {
+        this->memory = memory;
+        cpu.SetRegisters(registers);
+    }
+
+    uint32_t Execute(uint32_t machine_cycles) override
+    {
+        return cpu.Execute(machine_cycles, memory);
+    }
+
+    CPU::Registers GetRegisters() const override
+    {
+        return cpu.GetRegisters();
+    }
+
+    const Mem& Memory() const override
+    {
+        return memory;
+    }
+
+   private:
+    CPU cpu;
+    Mem memory;
+};
+
+class LockstepEngine : public DiffEngine
+{
+   public:
+    void SetState(const CPU::Registers& registers, const Mem& memory) override
+    {
+        this->memory = memory;
+        lockstep.SetLane(0, &this->memory, registers);
+    }
+
+    uint32_t Execute(uint32_t machine_cycles) override
+    {
+        lockstep.Execute(machine_cycles);
+        if (lockstep.Stop(0) == Lockstep::LaneStop::IllegalOpcode)
+        {
+            // The same message as CPU::OpIllegal, the lane stopped past the opcode.
+            std::stringstream stream;
+            stream << "Unhandled instruction: 0x" << std::hex
+                   << int(memory.Fetch(lockstep.GetRegisters(0).PC - 1));
+            throw std::invalid_argument(stream.str());
+        }
+
+        return lockstep.Cycles(0);
+    }
+
+    CPU::Registers GetRegisters() const override
+    {
+        return lockstep.GetRegisters(0);
+    }
+
+    const Mem& Memory() const override
+    {
+        return memory;
+    }
+
+   private:
+    Lockstep lockstep;
+    Mem memory;
+};
+
+struct EnginePair
+{
+    std::unique_ptr<DiffEngine> reference;
+    std::unique_ptr<DiffEngine> candidate;
+};
+
+// Programs per task below which a range is no longer split.
+const uint64_t grain = 4;
+
+uint32_t Step(DiffEngine& engine, uint32_t machine_cycles, std::string& error)
+{
+    try
+    {
+        return engine.Execute(machine_cycles);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        error = e.what();
+        return 0;
+    }
+}
+
+std::string Hex(uint32_t value, int digits)
+{
+    char text[8];
+    std::snprintf(text, sizeof(text), "$%0*X", digits, value);
+    return text;
+}
+
+// The opcodes CPU::Execute accepts, in ascending order.
+std::vector<uint8_t> LegalOpcodes()
+{
+#define LEGAL_OPCODE(HEX, NAME, CYCLES, ADDRESSING_MODE) HEX,
+    std::vector<uint8_t> opcodes = {MOS6502_OPCODES(LEGAL_OPCODE)};
+#undef LEGAL_OPCODE
+
+    std::sort(opcodes.begin(), opcodes.end());
+    return opcodes;
+}
+}  // namespace
+
+std::unique_ptr<DiffEngine> MakeReferenceEngine()
+{
+    return std::make_unique<ReferenceEngine>();
+}
+
+std::unique_ptr<DiffEngine> MakeLockstepEngine()
+{
+    return std::make_unique<LockstepEngine>();
+}
+
+std::string Divergence::Describe() const
+{
+    std::string text = "step " + std::to_string(step) + " at PC " + Hex(pc, 4) + " opcode " +
+                       Hex(opcode, 2) + ":";
+
+    auto field = [&](const char* name, uint32_t left, uint32_t right, int digits)
+    {
+        if (left != right)
+            text += std::string(" ") + name + " " + Hex(left, digits) + " != " + Hex(right, digits);
+    };
+
+    field("PC", expected.PC, actual.PC, 4);
+    field("SP", expected.SP, actual.SP, 2);
+    field("A", expected.A, actual.A, 2);
+    field("X", expected.X, actual.X, 2);
+    field("Y", expected.Y, actual.Y, 2);
+    field("PS", expected.PS, actual.PS, 2);
+
+    if (expected_cycles != actual_cycles)
+        text += " cycles " + std::to_string(expected_cycles) + " != " +
+                std::to_string(actual_cycles);
+
+    if (expected_error != actual_error)
+        text += " error \"" + expected_error + "\" != \"" + actual_error + "\"";
+
+    for (const Mem::Range& range : memory)
+        text += " memory " + Hex(range.begin, 4) + "-" + Hex(range.end - 1, 4);
+
+    return text;
+}
+
+std::optional<Divergence> RunDifferential(DiffEngine& reference, DiffEngine& candidate,
+                                          const CPU::Registers& registers, const Mem& memory,
+                                          const DiffOptions& options)
+{
+    reference.SetState(registers, memory);
+    candidate.SetState(registers, memory);
+
+    for (uint32_t step = 0; step < options.max_steps; step++)
+    {
+        Divergence divergence;
+        divergence.step = step;
+        divergence.pc = reference.GetRegisters().PC;
+        divergence.opcode = reference.Memory()[divergence.pc];
+
+        divergence.expected_cycles =
+            Step(reference, options.step_cycles, divergence.expected_error);
+        divergence.actual_cycles = Step(candidate, options.step_cycles, divergence.actual_error);
+        divergence.expected = reference.GetRegisters();
+        divergence.actual = candidate.GetRegisters();
+
+        if (options.compare_memory && !reference.Memory().Compare(candidate.Memory()))
+            divergence.memory = reference.Memory().Diff(candidate.Memory());
+
+        if (divergence.expected != divergence.actual ||
+            divergence.expected_cycles != divergence.actual_cycles ||
+            divergence.expected_error != divergence.actual_error || !divergence.memory.empty())
+            return divergence;
+
+        // Both engines stopped on the same error.
+        if (!divergence.expected_error.empty())
+            break;
+    }
+
+    return std::nullopt;
+}
+
+void RandomProgram(uint64_t seed, Mem& memory, CPU::Registers& registers)
+{
+    static const std::vector<uint8_t> legal_opcodes = LegalOpcodes();
+    std::mt19937_64 random(seed);
+
+    for (uint32_t address = 0; address < Mem::max_size; address++)
+        memory[address] = legal_opcodes[random() % legal_opcodes.size()];
+
+    registers = CPU::Registers{uint16_t(random()), uint8_t(random()), uint8_t(random()),
+                               uint8_t(random()), uint8_t(random()), uint8_t(random())};
+}
+
+std::vector<DiffFailure> RunRandomPrograms(const EngineFactory& reference,
+                                           const EngineFactory& candidate, uint64_t first_seed,
+                                           uint64_t count, ThreadPool& pool,
+                                           const DiffOptions& options)
+{
+    std::vector<std::optional<Divergence>> results(count);
+    std::vector<std::unique_ptr<EnginePair>> engines(pool.Size());
+
+    ParallelFor(pool, count, grain,
+                [&](uint64_t begin, uint64_t end)
+                {
+                    std::unique_ptr<EnginePair>& pair = engines[pool.CurrentWorker()];
+                    if (!pair)
+                        pair = std::make_unique<EnginePair>(EnginePair{reference(), candidate()});
+
+                    Mem memory;
+                    for (uint64_t i = begin; i < end; i++)
+                    {
+                        CPU::Registers registers;
+                        RandomProgram(first_seed + i, memory, registers);
+                        results[i] = RunDifferential(*pair->reference, *pair->candidate,
+                                                     registers, memory, options);
+                    }
+                });
+
+    std::vector<DiffFailure> failures;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (results[i])
+            failures.push_back({first_seed + i, *results[i]});
+    }
+
+    return failures;
+}
@@ -0,0 +1,344 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "explorer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+const size_t Explorer::StateSet::shard_count;
+
+size_t Explorer::Node::Bytes() const
+{
+    return sizeof(Node) + pages.capacity() + contents.capacity() + inputs.capacity();
+}
+
+bool Explorer::StateSet::Insert(uint64_t hash)
+{
+    // Zero marks an empty slot. The low bits pick the shard, the others the slot.
+    hash |= hash == 0;
+    Shard& shard = shards[hash % shard_count];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if ((shard.size + 1) * 2 > shard.slots.size())
+    {
+        std::vector<uint64_t> slots(std::max<size_t>(64, shard.slots.size() * 2));
+        for (uint64_t entry : shard.slots)
+        {
+            if (!entry)
+                continue;
+
+            size_t index = (entry / shard_count) & (slots.size() - 1);
+            while (slots[index])
+                index = (index + 1) & (slots.size() - 1);
+            slots[index] = entry;
+        }
+
+        bytes += (slots.size() - shard.slots.size()) * sizeof(uint64_t);
+        shard.slots.swap(slots);
+    }
+
+    size_t index = (hash / shard_count) & (shard.slots.size() - 1);
+    while (shard.slots[index])
+    {
+        if (shard.slots[index] == hash)
+            return false;
+        index = (index + 1) & (shard.slots.size() - 1);
+    }
+
+    shard.slots[index] = hash;
+    shard.size++;
+    return true;
+}
+
+void Explorer::StateSet::Clear()
+{
+    for (Shard& shard : shards)
+    {
+        std::vector<uint64_t>().swap(shard.slots);
+        shard.size = 0;
+    }
+
+    bytes = 0;
+}
+
+size_t Explorer::StateSet::Bytes() const
+{
+    return bytes;
+}
+
+Explorer::Explorer(const ExploreConfig& config) : config(config), pool(config.threads)
+{
+    for (size_t i = 0; i < config.decisions.size(); i++)
+    {
+        if (config.decisions[i].values.empty())
+            throw std::invalid_argument("Decision point without values");
+        if (!decision_at.emplace(config.decisions[i].pc, static_cast<int>(i)).second)
+            throw std::invalid_argument("Decision points share a pc");
+    }
+
+    image.Load(config.load_address, config.image);
+
+    for (unsigned i = 0; i < pool.Size(); i++)
+    {
+        std::unique_ptr<Worker>& worker = workers.emplace_back(std::make_unique<Worker>());
+        worker->memory = image;
+        for (const DecisionPoint& decision : config.decisions)
+            worker->memory.AddWatchpoint(decision.pc, decision.pc, Mem::kExecute);
+        for (uint16_t address : config.stop_addresses)
+            worker->memory.AddWatchpoint(address, address, Mem::kExecute);
+
+        // Every page is restored from the image on the first load.
+        worker->loaded.set();
+    }
+}
+
+Explorer::Stats Explorer::Explore(TerminalCallback terminal_callback)
+{
+    callback = std::move(terminal_callback);
+    seen.Clear();
+    states = duplicates = stopped = hangs = crashes = 0;
+    truncated = false;
+    live_bytes = peak_bytes = 0;
+
+    CPU cpu;
+    cpu.SetRegisters(config.registers);
+
+    Node start;
+    start.cpu = cpu.GetState();
+    start.decision = -1;
+    Enqueue(std::move(start));
+
+    if (config.depth_first)
+    {
+        pool.Wait();
+    }
+    else
+    {
+        std::vector<Node> level;
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(level_mutex);
+                level.swap(next_level);
+            }
+
+            if (level.empty())
+                break;
+
+            for (const Node& node : level)
+                pool.Submit([this, &node] { Expand(node); });
+            pool.Wait();
+
+            for (const Node& node : level)
+                Account(-static_cast<ptrdiff_t>(node.Bytes()));
+            level.clear();
+        }
+    }
+
+    Stats stats;
+    stats.states = states;
+    stats.duplicates = duplicates;
+    stats.stopped = stopped;
+    stats.hangs = hangs;
+    stats.crashes = crashes;
+    stats.complete = !truncated;
+    stats.peak_bytes = peak_bytes;
+    return stats;
+}
+
+void Explorer::Expand(const Node& node)
+{
+    Worker& worker = *workers[pool.CurrentWorker()];
+    if (node.decision < 0)
+    {
+        Branch(worker, node, nullptr);
+        return;
+    }
+
+    for (const uint8_t& value : config.decisions[node.decision].values)
+        Branch(worker, node, &value);
+}
+
+// Runs one branch of node, with value stored for its decision, to the next state.
+void Explorer::Branch(Worker& worker, const Node& node, const uint8_t* value)
+{
+    Load(worker, node);
+
+    std::vector<uint8_t> inputs = node.inputs;
+    if (value)
+    {
+        worker.memory[config.decisions[node.decision].address] = *value;
+        inputs.push_back(*value);
+    }
+
+    try
+    {
+        while (worker.cpu.cycles < config.cycles)
+        {
+            const uint64_t remaining = config.cycles - worker.cpu.cycles;
+            worker.cpu.Execute(static_cast<uint32_t>(std::min<uint64_t>(
+                                   remaining, std::numeric_limits<uint32_t>::max())),
+                               worker.memory);
+            if (worker.cpu.stop_reason != CPU::StopReason::Watchpoint)
+                continue;
+
+            const uint16_t pc = worker.cpu.PC;
+            const bool stop = std::find(config.stop_addresses.begin(), config.stop_addresses.end(),
+                                        pc) != config.stop_addresses.end();
+
+            uint64_t hash;
+            Node state = Capture(worker, stop ? -1 : decision_at.at(pc), std::move(inputs), &hash);
+            if (states >= config.max_states)
+            {
+                truncated = true;
+                return;
+            }
+
+            if (!seen.Insert(hash))
+            {
+                duplicates++;
+                return;
+            }
+
+            states++;
+            if (stop)
+            {
+                stopped++;
+                Account(0);
+                Report(Outcome::Stopped, worker, state.inputs);
+            }
+            else
+            {
+                Enqueue(std::move(state));
+            }
+
+            return;
+        }
+    }
+    catch (const std::invalid_argument&)
+    {
+        crashes++;
+        Report(Outcome::Crash, worker, inputs);
+        return;
+    }
+
+    hangs++;
+    Report(Outcome::Hang, worker, inputs);
+}
+
+// Moves the worker's machine to node, restoring the pages it changed from the image.
+void Explorer::Load(Worker& worker, const Node& node)
+{
+    PageSet pages;
+    for (uint8_t page : node.pages)
+        pages[page] = true;
+
+    const Mem::View original = image.Slice(0, Mem::max_size);
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        if ((worker.loaded[page] || worker.memory.IsModified(page)) && !pages[page])
+            worker.memory.Load(page * Mem::page_size, original.data() + page * Mem::page_size,
+                               Mem::page_size);
+    }
+
+    for (size_t i = 0; i < node.pages.size(); i++)
+    {
+        worker.memory.Load(node.pages[i] * Mem::page_size, &node.contents[i * Mem::page_size],
+                           Mem::page_size);
+    }
+
+    worker.loaded = pages;
+    worker.memory.ClearModified();
+    worker.cpu.SetState(node.cpu);
+}
+
+Explorer::Node Explorer::Capture(Worker& worker, int decision, std::vector<uint8_t> inputs,
+                                 uint64_t* hash) const
+{
+    Node node;
+    node.cpu = worker.cpu.GetState();
+    node.inputs = std::move(inputs);
+    node.decision = decision;
+
+    const Mem::View original = image.Slice(0, Mem::max_size);
+    const Mem::View current = worker.memory.Slice(0, Mem::max_size);
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        if (!worker.loaded[page] && !worker.memory.IsModified(page))
+            continue;
+
+        const uint8_t* bytes = current.data() + page * Mem::page_size;
+        if (std::memcmp(bytes, original.data() + page * Mem::page_size, Mem::page_size) == 0)
+            continue;
+
+        node.pages.push_back(page);
+        node.contents.insert(node.contents.end(), bytes, bytes + Mem::page_size);
+    }
+
+    *hash = worker.cpu.StateHash(worker.memory);
+    return node;
+}
+
+void Explorer::Report(Outcome outcome, const Worker& worker, const std::vector<uint8_t>& inputs)
+{
+    if (!callback)
+        return;
+
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    callback({outcome, worker.cpu.GetRegisters(), worker.cpu.cycles, inputs});
+}
+
+void Explorer::Enqueue(Node&& node)
+{
+    const size_t bytes = node.Bytes();
+    Account(bytes);
+
+    if (config.depth_first)
+    {
+        // Workers run their own tasks newest first, which makes the search depth-first.
+        pool.Submit(
+            [this, node = std::move(node), bytes]
+            {
+                Expand(node);
+                Account(-static_cast<ptrdiff_t>(bytes));
+            });
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(level_mutex);
+        next_level.push_back(std::move(node));
+    }
+}
+
+void Explorer::Account(ptrdiff_t bytes)
+{
+    const size_t held = (live_bytes += bytes) + seen.Bytes();
+    size_t peak = peak_bytes;
+    while (held > peak && !peak_bytes.compare_exchange_weak(peak, held))
+    {
+    }
+}
@@ -0,0 +1,264 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "fuzz.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+// Hit counts are compared in classes, so a loop running one more time is not new coverage.
+const std::array<uint8_t, 256> hit_classes = []
+{
+    std::array<uint8_t, 256> classes = {};
+    for (int count = 1; count < 256; count++)
+    {
+        if (count < 4)
+            classes[count] = (count == 3) ? 4 : count;
+        else if (count < 8)
+            classes[count] = 8;
+        else if (count < 16)
+            classes[count] = 16;
+        else if (count < 32)
+            classes[count] = 32;
+        else if (count < 128)
+            classes[count] = 64;
+        else
+            classes[count] = 128;
+    }
+    return classes;
+}();
+
+const uint8_t interesting_values[] = {0x00, 0x01, 0x7F, 0x80, 0xFF, 0x0A, 0x0D, 0x20};
+
+Mem LoadImage(const FuzzTarget& target)
+{
+    if (target.input_address + target.max_input_length > Mem::max_size)
+        throw std::invalid_argument("the input region does not fit in memory");
+    if (target.length_address && uint32_t{*target.length_address} + 2 > Mem::max_size)
+        throw std::invalid_argument("the input length word does not fit in memory");
+
+    Mem image;
+    image.Load(target.load_address, target.image);
+    return image;
+}
+}  // namespace
+
+Fuzzer::Fuzzer(const FuzzTarget& target, uint64_t seed)
+    : target(target),
+      image(LoadImage(target)),
+      memory(image),
+      trace(CPU::coverage_size),
+      seen(CPU::coverage_size),
+      random(seed)
+{
+    for (uint16_t address : target.stop_addresses)
+        memory.AddWatchpoint(address, address, Mem::kExecute);
+
+    cpu.coverage = trace.data();
+}
+
+Fuzzer::Outcome Fuzzer::Run(const std::vector<uint8_t>& input, bool* new_coverage)
+{
+    Restore();
+
+    const uint16_t length = std::min<size_t>(input.size(), target.max_input_length);
+    memory.Load(target.input_address, input.data(), length);
+    if (target.length_address)
+    {
+        const uint8_t word[] = {uint8_t(length & 0xFF), uint8_t(length >> 8)};
+        memory.Load(*target.length_address, word, sizeof(word));
+    }
+
+    cpu.SetRegisters(target.registers);
+
+    Outcome outcome;
+    try
+    {
+        cpu.Execute(target.cycles, memory);
+        outcome = (cpu.stop_reason == CPU::StopReason::Watchpoint) ? Outcome::Stopped
+                                                                    : Outcome::Hang;
+    }
+    catch (const std::invalid_argument&)
+    {
+        outcome = Outcome::Crash;
+    }
+
+    executions++;
+    crashes += (outcome == Outcome::Crash);
+    hangs += (outcome == Outcome::Hang);
+
+    bool found = MergeCoverage();
+    if (new_coverage)
+        *new_coverage = found;
+
+    return outcome;
+}
+
+void Fuzzer::AddSeed(const std::vector<uint8_t>& input)
+{
+    Run(input);
+    corpus.push_back(input);
+}
+
+void Fuzzer::Fuzz(uint64_t iterations)
+{
+    if (corpus.empty())
+        AddSeed({});
+
+    for (uint64_t iteration = 0; iteration < iterations; iteration++)
+    {
+        std::vector<uint8_t> input = Mutate();
+
+        bool new_coverage;
+        Outcome outcome = Run(input, &new_coverage);
+        if (!new_coverage)
+            continue;
+
+        if (outcome == Outcome::Crash)
+            crashing.push_back(std::move(input));
+        else if (outcome == Outcome::Stopped)
+            corpus.push_back(std::move(input));
+    }
+}
+
+const std::vector<std::vector<uint8_t>>& Fuzzer::Corpus() const
+{
+    return corpus;
+}
+
+const std::vector<std::vector<uint8_t>>& Fuzzer::Crashes() const
+{
+    return crashing;
+}
+
+uint32_t Fuzzer::Edges() const
+{
+    return CPU::coverage_size - std::count(seen.begin(), seen.end(), 0);
+}
+
+// Applies a stack of one to eight random mutations to a random corpus entry.
+std::vector<uint8_t> Fuzzer::Mutate()
+{
+    std::vector<uint8_t> input = corpus[random() % corpus.size()];
+    const int mutations = 1 << (random() % 4);
+
+    for (int mutation = 0; mutation < mutations; mutation++)
+    {
+        const size_t position = input.empty() ? 0 : random() % input.size();
+
+        switch (random() % 7)
+        {
+            case 0:
+                if (!input.empty())
+                    input[position] ^= 1 << (random() % 8);
+                break;
+            case 1:
+                if (!input.empty())
+                    input[position] = random();
+                break;
+            case 2:
+                if (!input.empty())
+                    input[position] = interesting_values[random() % sizeof(interesting_values)];
+                break;
+            case 3:
+                if (!input.empty())
+                    input[position] += int(random() % 33) - 16;
+                break;
+            case 4:
+                input.insert(input.begin() + random() % (input.size() + 1), uint8_t(random()));
+                break;
+            case 5:
+                if (!input.empty())
+                    input.erase(input.begin() + position);
+                break;
+            case 6:
+            {
+                // Splices a chunk of another entry over this one.
+                const std::vector<uint8_t>& other = corpus[random() % corpus.size()];
+                if (other.empty())
+                    break;
+
+                const size_t begin = random() % other.size();
+                const size_t length = 1 + random() % (other.size() - begin);
+                if (input.size() < position + length)
+                    input.resize(position + length);
+                std::copy(other.begin() + begin, other.begin() + begin + length,
+                          input.begin() + position);
+                break;
+            }
+        }
+    }
+
+    if (input.size() > target.max_input_length)
+        input.resize(target.max_input_length);
+
+    return input;
+}
+
+// Copies back the ranges the last run changed, untouched pages are skipped by Diff.
+void Fuzzer::Restore()
+{
+    for (const Mem::Range& range : memory.Diff(image))
+    {
+        const uint32_t length = range.end - range.begin;
+        memory.Load(range.begin, image.Slice(range.begin, length).data(), length);
+    }
+}
+
+// Also clears the trace for the next run, only the blocks with hits are written.
+bool Fuzzer::MergeCoverage()
+{
+    const uint32_t block_size = 64;
+    bool found = false;
+
+    for (uint32_t block = 0; block < CPU::coverage_size; block += block_size)
+    {
+        uint64_t words[block_size / sizeof(uint64_t)];
+        std::memcpy(words, &trace[block], block_size);
+
+        uint64_t hits = 0;
+        for (uint64_t word : words)
+            hits |= word;
+        if (!hits)
+            continue;
+
+        for (uint32_t edge = block; edge < block + block_size; edge++)
+        {
+            const uint8_t hit_class = hit_classes[trace[edge]];
+            if (hit_class & ~seen[edge])
+            {
+                seen[edge] |= hit_class;
+                found = true;
+            }
+        }
+
+        std::memset(&trace[block], 0, block_size);
+    }
+
+    return found;
+}
@@ -0,0 +1,438 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "input_log.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace input_log;
+
+namespace
+{
+class MalformedLog : public std::invalid_argument
+{
+   public:
+    MalformedLog() : std::invalid_argument("Malformed input log")
+    {
+    }
+};
+
+class Reader
+{
+   public:
+    Reader(const uint8_t* data, size_t size) : data(data), size(size)
+    {
+    }
+
+    bool Empty() const
+    {
+        return offset == size;
+    }
+
+    size_t Offset() const
+    {
+        return offset;
+    }
+
+    const uint8_t* Bytes(size_t length)
+    {
+        if (length > size - offset)
+            throw MalformedLog();
+
+        const uint8_t* bytes = data + offset;
+        offset += length;
+        return bytes;
+    }
+
+    uint8_t U8()
+    {
+        return *Bytes(1);
+    }
+
+    uint16_t U16()
+    {
+        const uint8_t* bytes = Bytes(2);
+        return bytes[0] | (bytes[1] << 8);
+    }
+
+    uint32_t U32()
+    {
+        const uint8_t* bytes = Bytes(4);
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24);
+    }
+
+    uint64_t U64()
+    {
+        const uint8_t* bytes = Bytes(8);
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; i--)
+            value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    uint64_t Varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            uint8_t byte = U8();
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+
+        throw MalformedLog();
+    }
+
+   private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+void Put(std::vector<uint8_t>& out, uint64_t value, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        out.push_back(value >> (8 * i));
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+
+    out.push_back(value);
+}
+
+std::vector<int> WatchInputs(Mem& memory, const std::vector<Mem::Range>& inputs)
+{
+    std::vector<int> watchpoints;
+    for (const Mem::Range& range : inputs)
+    {
+        if (range.begin >= range.end || range.end > Mem::max_size)
+            throw std::invalid_argument("Input range is empty or exceeds the address space");
+
+        watchpoints.push_back(memory.AddWatchpoint(range.begin, range.end - 1, Mem::kRead));
+    }
+
+    return watchpoints;
+}
+
+void Unwatch(Mem& memory, const std::vector<int>& watchpoints)
+{
+    memory.SetWatchCallback(nullptr);
+    for (int id : watchpoints)
+        memory.RemoveWatchpoint(id);
+}
+
+bool IsInput(const std::vector<int>& watchpoints, int id)
+{
+    return std::find(watchpoints.begin(), watchpoints.end(), id) != watchpoints.end();
+}
+
+[[noreturn]] void Diverged(const std::string& message)
+{
+    throw std::runtime_error("Replay diverged: " + message);
+}
+}  // namespace
+
+InputRecorder::InputRecorder(CPU& cpu, Mem& memory, const std::vector<Mem::Range>& inputs,
+                             Device device)
+    : cpu(cpu),
+      memory(memory),
+      inputs(inputs),
+      device(std::move(device)),
+      watchpoints(WatchInputs(memory, inputs)),
+      start_cycle(cpu.cycles),
+      event_cycle(cpu.cycles)
+{
+    memory.SetWatchCallback(
+        [this](const Mem::WatchHit& hit)
+        {
+            if (!IsInput(watchpoints, hit.id))
+                return true;
+
+            const uint8_t value = this->device(hit.address);
+            this->memory[hit.address] = value;
+            reads++;
+
+            if (hit.address == last_address && value == last_value)
+            {
+                repeats++;
+                return false;
+            }
+
+            if (repeats)
+            {
+                read_records.push_back(kRepeat);
+                PutVarint(read_records, repeats);
+                repeats = 0;
+            }
+
+            if (hit.address == last_address)
+            {
+                read_records.push_back(kReadSame);
+            }
+            else
+            {
+                read_records.push_back(kRead);
+                Put(read_records, hit.address, 2);
+            }
+
+            read_records.push_back(value);
+            last_address = hit.address;
+            last_value = value;
+            return false;
+        });
+}
+
+InputRecorder::~InputRecorder()
+{
+    Unwatch(memory, watchpoints);
+}
+
+void InputRecorder::BeginEvent(Event event)
+{
+    events.push_back(event);
+    PutVarint(events, cpu.cycles - event_cycle);
+    event_cycle = cpu.cycles;
+}
+
+bool InputRecorder::Interrupt(CPU::Interrupt interrupt)
+{
+    BeginEvent(kInterrupt);
+    events.push_back(static_cast<uint8_t>(interrupt));
+    return cpu.RaiseInterrupt(interrupt, memory);
+}
+
+void InputRecorder::Write(uint16_t address, const std::vector<uint8_t>& bytes)
+{
+    if (address + bytes.size() > Mem::max_size)
+        throw std::invalid_argument("Range exceeds the address space");
+
+    BeginEvent(kWrite);
+    Put(events, address, 2);
+    PutVarint(events, bytes.size());
+    events.insert(events.end(), bytes.begin(), bytes.end());
+    memory.Load(address, bytes);
+}
+
+std::vector<uint8_t> InputRecorder::Log() const
+{
+    std::vector<uint8_t> log;
+    Put(log, magic, 4);
+    Put(log, version, 2);
+    Put(log, inputs.size(), 2);
+    Put(log, start_cycle, 8);
+    for (const Mem::Range& range : inputs)
+    {
+        Put(log, range.begin, 4);
+        Put(log, range.end, 4);
+    }
+
+    Put(log, events.size(), 4);
+    log.insert(log.end(), events.begin(), events.end());
+    log.insert(log.end(), read_records.begin(), read_records.end());
+    if (repeats)
+    {
+        log.push_back(kRepeat);
+        PutVarint(log, repeats);
+    }
+
+    return log;
+}
+
+InputReplayer::InputReplayer(CPU& cpu, Mem& memory, const std::vector<uint8_t>& log)
+    : cpu(cpu), memory(memory)
+{
+    Reader reader(log.data(), log.size());
+    if (log.size() < 4 || reader.U32() != magic)
+        throw std::invalid_argument("Not an input log");
+    if (reader.U16() != version)
+        throw std::invalid_argument("Unsupported input log version");
+
+    std::vector<Mem::Range> inputs(reader.U16());
+    const uint64_t start_cycle = reader.U64();
+    for (Mem::Range& range : inputs)
+    {
+        range.begin = reader.U32();
+        range.end = reader.U32();
+    }
+
+    // Host events are few, decode them up front.
+    const uint32_t events_size = reader.U32();
+    Reader event_reader(reader.Bytes(events_size), events_size);
+    uint64_t cycle = start_cycle;
+    while (!event_reader.Empty())
+    {
+        Event event = {};
+        event.type = static_cast<input_log::Event>(event_reader.U8());
+        cycle += event_reader.Varint();
+        event.cycle = cycle;
+        if (event.type == kInterrupt)
+        {
+            const uint8_t interrupt = event_reader.U8();
+            if (interrupt > static_cast<uint8_t>(CPU::Interrupt::NMI))
+                throw MalformedLog();
+            event.interrupt = static_cast<CPU::Interrupt>(interrupt);
+        }
+        else if (event.type == kWrite)
+        {
+            event.address = event_reader.U16();
+            const uint64_t length = event_reader.Varint();
+            if (event.address + length > Mem::max_size)
+                throw MalformedLog();
+            const uint8_t* bytes = event_reader.Bytes(length);
+            event.bytes.assign(bytes, bytes + length);
+        }
+        else
+        {
+            throw MalformedLog();
+        }
+
+        events.push_back(std::move(event));
+    }
+
+    // Reads are decoded as they happen, only check the records here.
+    const size_t reads_offset = reader.Offset();
+    bool first = true;
+    while (!reader.Empty())
+    {
+        const uint8_t record = reader.U8();
+        if (record == kRead)
+            reader.Bytes(3);
+        else if (record == kReadSame && !first)
+            reader.U8();
+        else if (record != kRepeat || first || reader.Varint() == 0)
+            throw MalformedLog();
+        first = false;
+    }
+    read_records.assign(log.begin() + reads_offset, log.end());
+
+    if (cpu.cycles != start_cycle)
+        throw std::invalid_argument("The CPU is not at the start cycle of the input log");
+
+    watchpoints = WatchInputs(memory, inputs);
+    memory.SetWatchCallback(
+        [this](const Mem::WatchHit& hit)
+        {
+            if (!IsInput(watchpoints, hit.id))
+                return true;
+
+            this->memory[hit.address] = NextRead(hit.address);
+            return false;
+        });
+}
+
+InputReplayer::~InputReplayer()
+{
+    Unwatch(memory, watchpoints);
+}
+
+uint8_t InputReplayer::NextRead(uint16_t address)
+{
+    if (!repeats)
+    {
+        if (read_offset == read_records.size())
+            Diverged("more input reads than recorded");
+
+        Reader reader(read_records.data() + read_offset, read_records.size() - read_offset);
+        const uint8_t record = reader.U8();
+        if (record == kRead)
+            read_address = reader.U16();
+        if (record == kRepeat)
+        {
+            repeats = reader.Varint();
+        }
+        else
+        {
+            read_value = reader.U8();
+            repeats = 1;
+        }
+        read_offset += reader.Offset();
+    }
+
+    if (address != read_address)
+    {
+        std::stringstream stream;
+        stream << "input read at 0x" << std::hex << address << " where 0x" << read_address
+               << " was recorded";
+        Diverged(stream.str());
+    }
+
+    repeats--;
+    return read_value;
+}
+
+void InputReplayer::Apply()
+{
+    for (; next_event < events.size() && events[next_event].cycle <= cpu.cycles; next_event++)
+    {
+        const Event& event = events[next_event];
+        if (event.cycle < cpu.cycles)
+        {
+            std::stringstream stream;
+            stream << "event of cycle " << event.cycle << " reached at cycle " << cpu.cycles;
+            Diverged(stream.str());
+        }
+
+        if (event.type == kInterrupt)
+            cpu.RaiseInterrupt(event.interrupt, memory);
+        else
+            memory.Load(event.address, event.bytes);
+    }
+}
+
+uint32_t InputReplayer::Execute(uint32_t machine_cycles)
+{
+    const uint64_t start = cpu.cycles;
+    Apply();
+
+    while (cpu.cycles - start < machine_cycles)
+    {
+        // Instruction boundaries do not depend on how execution is sliced, so slices ending at
+        // the next event land on its cycle exactly.
+        uint64_t slice = machine_cycles - (cpu.cycles - start);
+        if (next_event < events.size())
+            slice = std::min(slice, events[next_event].cycle - cpu.cycles);
+
+        cpu.Execute(slice, memory);
+        Apply();
+        if (cpu.stop_reason == CPU::StopReason::Watchpoint)
+            break;
+    }
+
+    return cpu.cycles - start;
+}
+
+bool InputReplayer::Done() const
+{
+    return next_event == events.size() && read_offset == read_records.size() && !repeats;
+}
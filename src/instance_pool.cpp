@@ -0,0 +1,178 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "instance_pool.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+namespace
+{
+const size_t huge_page_size = 2 * 1024 * 1024;
+
+// From linux/mempolicy.h.
+const int mpol_bind = 2;
+
+size_t RoundUp(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+uint8_t* MapArena(size_t size, int flags)
+{
+    void* address =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return (address == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(address);
+}
+
+// Before any page is touched, so every page is allocated on the node.
+void BindToNode(void* address, size_t size, int node)
+{
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_mbind, address, size, mpol_bind, &mask, sizeof(mask) * 8, 0) != 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to bind the arena");
+}
+}  // namespace
+
+InstancePool::InstancePool(const ArenaConfig& config) : capacity(config.capacity)
+{
+    if (capacity == 0 || capacity > UINT32_MAX)
+        throw std::invalid_argument("Invalid instance pool capacity");
+    if (config.numa_node < -1 || config.numa_node >= 64)
+        throw std::invalid_argument("Invalid NUMA node");
+
+    images_size = capacity * Mem::max_size;
+    if (config.huge_pages)
+    {
+        images_size = RoundUp(images_size, huge_page_size);
+        // Without MAP_NORESERVE the mapping fails up front when too few huge pages are
+        // reserved, instead of faulting later.
+        images = MapArena(images_size, MAP_HUGETLB);
+        huge_pages = (images != nullptr);
+    }
+
+    if (!images)
+    {
+        images = MapArena(images_size, MAP_NORESERVE);
+        if (!images)
+            throw std::system_error(errno, std::generic_category(), "Unable to map the arena");
+
+        if (config.huge_pages)
+            huge_pages = (madvise(images, images_size, MADV_HUGEPAGE) == 0);
+    }
+
+    instances_size = RoundUp(capacity * sizeof(Instance), sysconf(_SC_PAGESIZE));
+    instances = reinterpret_cast<Instance*>(MapArena(instances_size, MAP_NORESERVE));
+    if (!instances)
+    {
+        munmap(images, images_size);
+        throw std::system_error(errno, std::generic_category(), "Unable to map the arena");
+    }
+
+    if (config.numa_node >= 0)
+    {
+        try
+        {
+            BindToNode(images, images_size, config.numa_node);
+            BindToNode(instances, instances_size, config.numa_node);
+        }
+        catch (...)
+        {
+            munmap(images, images_size);
+            munmap(instances, instances_size);
+            throw;
+        }
+    }
+
+    // Low slots are handed out first.
+    free_slots.reserve(capacity);
+    for (size_t slot = capacity; slot > 0; slot--)
+        free_slots.push_back(slot - 1);
+
+    live.resize(capacity);
+}
+
+InstancePool::~InstancePool()
+{
+    for (size_t slot = 0; slot < capacity; slot++)
+    {
+        if (live[slot])
+            instances[slot].~Instance();
+    }
+
+    munmap(images, images_size);
+    munmap(instances, instances_size);
+}
+
+InstancePool::Instance* InstancePool::Acquire()
+{
+    if (free_slots.empty())
+        throw std::bad_alloc();
+
+    const uint32_t slot = free_slots.back();
+    free_slots.pop_back();
+    live[slot] = true;
+
+    return new (&instances[slot]) Instance(images + size_t(slot) * Mem::max_size);
+}
+
+void InstancePool::Release(Instance* instance, bool discard)
+{
+    const size_t slot = instance - instances;
+    if (instance < instances || slot >= capacity || !live[slot])
+        throw std::invalid_argument("Instance does not belong to this pool");
+
+    // Initialize zeroes written pages, except for ROM.
+    instance->memory.Protect(0, Mem::max_size, false);
+    instance->memory.Initialize();
+    instance->~Instance();
+
+    // Fails harmlessly for reserved huge pages, which cannot be partially discarded.
+    if (discard)
+        madvise(images + size_t(slot) * Mem::max_size, Mem::max_size, MADV_DONTNEED);
+
+    live[slot] = false;
+    free_slots.push_back(slot);
+}
+
+size_t InstancePool::Capacity() const
+{
+    return capacity;
+}
+
+size_t InstancePool::Live() const
+{
+    return capacity - free_slots.size();
+}
+
+bool InstancePool::HugePages() const
+{
+    return huge_pages;
+}
@@ -0,0 +1,696 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "lockstep.h"
+
+#include <algorithm>
+
+#include "alu.h"
+#include "opcode_table.h"
+
+namespace
+{
+enum class Mode : uint8_t
+{
+    Illegal,
+    Accumulator,
+    Implied,
+    Immediate,
+    ZeroPage,
+    ZeroPageX,
+    ZeroPageY,
+    Absolute,
+    AbsoluteX,
+    AbsoluteX5,
+    AbsoluteY,
+    AbsoluteY5,
+    Indirect,
+    IndexedIndirect,
+    IndirectIndexed,
+    IndirectIndexed6,
+    Relative
+};
+
+// clang-format off
+enum class Op : uint8_t
+{
+    Illegal,
+    LDA, LDX, LDY, STA, STX, STY,
+    TAX, TAY, TXA, TYA,
+    TSX, TXS, PHA, PHP, PLA, PLP,
+    AND, EOR, ORA, BIT,
+    ADC, SBC, CMP, CPX, CPY,
+    INC, INX, INY, DEC, DEX, DEY,
+    ASLA, ASL, LSRA, LSR, ROLA, ROL, RORA, ROR,
+    JMP, JSR, RTS,
+    BCC, BCS, BEQ, BMI, BNE, BPL, BVC, BVS,
+    CLC, CLD, CLI, CLV, SEC, SED, SEI,
+    BRK, NOP, RTI
+};
+// clang-format on
+
+struct Decoded
+{
+    Op op;
+    Mode mode;
+    uint8_t cycles;
+};
+
+#define DECODE(HEX, NAME, CYCLES, MODE) table[HEX] = {Op::NAME, Mode::MODE, CYCLES};
+
+std::array<Decoded, 256> MakeDecodeTable()
+{
+    std::array<Decoded, 256> table;
+    table.fill({Op::Illegal, Mode::Illegal, 0});
+
+    MOS6502_OPCODES(DECODE)
+
+    return table;
+}
+
+const std::array<Decoded, 256> decode_table = MakeDecodeTable();
+
+// Keeps value in lanes where mask is 0xFF and old in lanes where it is 0x00.
+inline uint8_t Select(uint8_t mask, uint8_t value, uint8_t old)
+{
+    return (value & mask) | (old & ~mask);
+}
+
+// Visits the lanes of a group one at a time, for work that touches memory.
+template <typename Function>
+inline void ForEachLane(uint32_t group, Function function)
+{
+    for (; group; group &= group - 1)
+        function(__builtin_ctz(group));
+}
+}  // namespace
+
+void Lockstep::SetLane(unsigned lane, Mem* memory, const CPU::Registers& registers)
+{
+    this->memory[lane] = memory;
+    pc[lane] = registers.PC;
+    sp[lane] = registers.SP;
+    a[lane] = registers.A;
+    x[lane] = registers.X;
+    y[lane] = registers.Y;
+    UnpackStatus(lane, registers.PS);
+
+    used[lane] = 0;
+    stops[lane] = LaneStop::Cycles;
+    watch_stopped[lane] = false;
+}
+
+CPU::Registers Lockstep::GetRegisters(unsigned lane) const
+{
+    return {pc[lane], sp[lane], a[lane], x[lane], y[lane], PackStatus(lane)};
+}
+
+uint32_t Lockstep::Cycles(unsigned lane) const
+{
+    return used[lane];
+}
+
+Lockstep::LaneStop Lockstep::Stop(unsigned lane) const
+{
+    return stops[lane];
+}
+
+uint8_t Lockstep::PackStatus(unsigned lane) const
+{
+    return c[lane] | (z[lane] << 1) | (i[lane] << 2) | (d[lane] << 3) | (b[lane] << 4) |
+           (u[lane] << 5) | (v[lane] << 6) | (n[lane] << 7);
+}
+
+void Lockstep::UnpackStatus(unsigned lane, uint8_t status)
+{
+    c[lane] = (status >> 0) & 1;
+    z[lane] = (status >> 1) & 1;
+    i[lane] = (status >> 2) & 1;
+    d[lane] = (status >> 3) & 1;
+    b[lane] = (status >> 4) & 1;
+    u[lane] = (status >> 5) & 1;
+    v[lane] = (status >> 6) & 1;
+    n[lane] = (status >> 7) & 1;
+}
+
+void Lockstep::Execute(uint32_t machine_cycles)
+{
+    uint32_t running = 0;
+    std::array<bool, max_lanes> watch_execute;
+
+    for (unsigned lane = 0; lane < max_lanes; lane++)
+    {
+        used[lane] = 0;
+        stops[lane] = LaneStop::Cycles;
+        watch_execute[lane] = !(watch_stopped[lane] && watch_stop_pc[lane] == pc[lane]);
+        watch_stopped[lane] = false;
+
+        if (memory[lane] && machine_cycles > 0)
+            running |= 1u << lane;
+    }
+
+    while (running)
+    {
+        // The group with the lowest PC runs first, lanes that branched ahead wait for it.
+        uint16_t group_pc = 0xFFFF;
+        ForEachLane(running, [&](unsigned lane) { group_pc = std::min(group_pc, pc[lane]); });
+
+        uint32_t group = 0;
+        ForEachLane(running,
+                    [&](unsigned lane)
+                    {
+                        if (pc[lane] == group_pc)
+                            group |= 1u << lane;
+                    });
+
+        ForEachLane(group,
+                    [&](unsigned lane)
+                    {
+                        if (watch_execute[lane] && memory[lane]->WatchExecute(group_pc))
+                        {
+                            stops[lane] = LaneStop::Watchpoint;
+                            watch_stopped[lane] = true;
+                            watch_stop_pc[lane] = group_pc;
+                            group &= ~(1u << lane);
+                            running &= ~(1u << lane);
+                        }
+
+                        watch_execute[lane] = true;
+                    });
+
+        if (!group)
+            continue;
+
+        // Lanes at the same PC normally run the same code, the ones that do not run later.
+        const uint8_t opcode = memory[__builtin_ctz(group)]->Fetch(group_pc);
+        ForEachLane(group,
+                    [&](unsigned lane)
+                    {
+                        if (memory[lane]->Fetch(group_pc) != opcode)
+                            group &= ~(1u << lane);
+                    });
+
+        Step(opcode, group);
+        dispatches++;
+        lane_instructions += __builtin_popcount(group);
+
+        ForEachLane(group,
+                    [&](unsigned lane)
+                    {
+                        if (stops[lane] == LaneStop::IllegalOpcode)
+                            running &= ~(1u << lane);
+                        else if (memory[lane]->ConsumeStop())
+                        {
+                            stops[lane] = LaneStop::Watchpoint;
+                            running &= ~(1u << lane);
+                        }
+                        else if (used[lane] >= machine_cycles)
+                            running &= ~(1u << lane);
+                    });
+    }
+}
+
+// Executes one instruction for every lane in the group. The arithmetic comes from alu.h like
+// the CPU's, the lanes only keep their registers apart.
+void Lockstep::Step(uint8_t opcode, uint32_t group)
+{
+    const Decoded decoded = decode_table[opcode];
+
+    Lanes active;
+    for (unsigned lane = 0; lane < max_lanes; lane++)
+        active[lane] = ((group >> lane) & 1) ? 0xFF : 0x00;
+
+    // The opcode has been fetched.
+    for (unsigned lane = 0; lane < max_lanes; lane++)
+        pc[lane] += active[lane] & 1;
+
+    if (decoded.op == Op::Illegal)
+    {
+        ForEachLane(group, [&](unsigned lane) { stops[lane] = LaneStop::IllegalOpcode; });
+        return;
+    }
+
+    // Per lane memory access.
+    auto fetch = [&](unsigned lane) -> uint8_t { return memory[lane]->Fetch(pc[lane]++); };
+    auto fetch_word = [&](unsigned lane) -> uint16_t
+    {
+        uint16_t w = memory[lane]->Fetch(pc[lane]);
+        w |= memory[lane]->Fetch(pc[lane] + 1) << 8;
+        pc[lane] += 2;
+        return w;
+    };
+    auto read = [&](unsigned lane, uint16_t address) -> uint8_t
+    { return memory[lane]->Read(address); };
+    auto read_word = [&](unsigned lane, uint16_t address) -> uint16_t
+    {
+        uint8_t l = read(lane, address);
+        uint8_t h = read(lane, address + 1);
+        return (h << 8) | l;
+    };
+    auto write = [&](unsigned lane, uint16_t address, uint8_t value)
+    { memory[lane]->Write(address, value); };
+    auto push = [&](unsigned lane, uint8_t value)
+    {
+        write(lane, 0x100 + sp[lane], value);
+        sp[lane]--;
+    };
+    auto push_word = [&](unsigned lane, uint16_t value)
+    {
+        push(lane, value >> 8);
+        push(lane, value & 0xFF);
+    };
+    auto pull = [&](unsigned lane) -> uint8_t
+    {
+        sp[lane]++;
+        return read(lane, 0x100 + sp[lane]);
+    };
+    auto pull_word = [&](unsigned lane) -> uint16_t
+    {
+        sp[lane]++;
+        return read_word(lane, 0x100 + sp[lane]);
+    };
+
+    auto set_zn = [&](unsigned lane, uint8_t value)
+    {
+        z[lane] = (value == 0);
+        n[lane] = value >> 7;
+    };
+
+    // Register operations on all lanes at once, kept only where the group is active.
+    auto transfer = [&](const Lanes& from, Lanes& to, bool flags)
+    {
+        for (unsigned lane = 0; lane < max_lanes; lane++)
+        {
+            to[lane] = Select(active[lane], from[lane], to[lane]);
+            if (flags)
+            {
+                z[lane] = Select(active[lane], to[lane] == 0, z[lane]);
+                n[lane] = Select(active[lane], to[lane] >> 7, n[lane]);
+            }
+        }
+    };
+    auto add = [&](Lanes& reg, uint8_t delta)
+    {
+        for (unsigned lane = 0; lane < max_lanes; lane++)
+        {
+            reg[lane] = Select(active[lane], reg[lane] + delta, reg[lane]);
+            z[lane] = Select(active[lane], reg[lane] == 0, z[lane]);
+            n[lane] = Select(active[lane], reg[lane] >> 7, n[lane]);
+        }
+    };
+    auto set_flag = [&](Lanes& flag, uint8_t value)
+    {
+        for (unsigned lane = 0; lane < max_lanes; lane++)
+            flag[lane] = Select(active[lane], value, flag[lane]);
+    };
+
+    auto add_with_carry = [&](unsigned lane, uint8_t operand)
+    {
+        const alu::Sum sum = alu::AddWithCarry(a[lane], operand, c[lane]);
+        a[lane] = sum.value;
+        v[lane] = sum.overflow;
+        c[lane] = sum.carry;
+        set_zn(lane, a[lane]);
+    };
+    auto compare = [&](unsigned lane, uint8_t reg, uint8_t operand)
+    {
+        const alu::Flags flags = alu::Compare(reg, operand);
+        c[lane] = flags.carry;
+        z[lane] = flags.zero;
+        n[lane] = flags.negative;
+    };
+
+    // Shifts the accumulator of all lanes at once, kept only where the group is active.
+    auto shift_a = [&](auto shift)
+    {
+        for (unsigned lane = 0; lane < max_lanes; lane++)
+        {
+            const alu::Shift result = shift(a[lane], c[lane]);
+            a[lane] = Select(active[lane], result.value, a[lane]);
+            c[lane] = Select(active[lane], result.carry, c[lane]);
+        }
+        transfer(a, a, true);
+    };
+
+    std::array<uint16_t, max_lanes> address = {};
+    Lanes extra = {};
+
+    switch (decoded.mode)
+    {
+        case Mode::Illegal:
+        case Mode::Implied: break;
+        case Mode::Accumulator:
+            ForEachLane(group, [&](unsigned lane) { address[lane] = a[lane]; });
+            break;
+        case Mode::Immediate:
+            ForEachLane(group, [&](unsigned lane) { address[lane] = pc[lane]++; });
+            break;
+        case Mode::ZeroPage:
+        case Mode::Relative:
+            ForEachLane(group, [&](unsigned lane) { address[lane] = fetch(lane); });
+            break;
+        case Mode::ZeroPageX:
+            ForEachLane(group,
+                        [&](unsigned lane) { address[lane] = (fetch(lane) + x[lane]) & 0xFF; });
+            break;
+        case Mode::ZeroPageY:
+            ForEachLane(group,
+                        [&](unsigned lane) { address[lane] = (fetch(lane) + y[lane]) & 0xFF; });
+            break;
+        case Mode::Absolute:
+            ForEachLane(group, [&](unsigned lane) { address[lane] = fetch_word(lane); });
+            break;
+        case Mode::AbsoluteX:
+        case Mode::AbsoluteY:
+        {
+            const Lanes& index = (decoded.mode == Mode::AbsoluteX) ? x : y;
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            uint16_t base = fetch_word(lane);
+                            address[lane] = base + index[lane];
+                            extra[lane] = ((base ^ address[lane]) >> 8) != 0;
+                        });
+            break;
+        }
+        case Mode::AbsoluteX5:
+        case Mode::AbsoluteY5:
+        {
+            const Lanes& index = (decoded.mode == Mode::AbsoluteX5) ? x : y;
+            ForEachLane(group,
+                        [&](unsigned lane) { address[lane] = fetch_word(lane) + index[lane]; });
+            break;
+        }
+        case Mode::Indirect:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            uint8_t l = fetch(lane);
+                            uint8_t h = fetch(lane);
+                            uint8_t low = read(lane, (uint16_t)(h << 8) | l);
+                            uint8_t high = read(lane, (uint16_t)(h << 8) | ((l + 1) & 0xFF));
+                            address[lane] = (uint16_t)(high << 8) | low;
+                        });
+            break;
+        case Mode::IndexedIndirect:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        { address[lane] = read_word(lane, (fetch(lane) + x[lane]) & 0xFF); });
+            break;
+        case Mode::IndirectIndexed:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            uint16_t target = read_word(lane, fetch(lane));
+                            address[lane] = target + y[lane];
+                            extra[lane] = ((target ^ address[lane]) >> 8) != 0;
+                        });
+            break;
+        case Mode::IndirectIndexed6:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        { address[lane] = read_word(lane, fetch(lane)) + y[lane]; });
+            break;
+    }
+
+    auto branch = [&](const Lanes& flag, bool status)
+    {
+        ForEachLane(group,
+                    [&](unsigned lane)
+                    {
+                        int8_t relative_address = (int8_t)address[lane];
+                        if (flag[lane] == status)
+                        {
+                            extra[lane]++;
+                            if ((pc[lane] >> 8) != ((pc[lane] + relative_address) >> 8))
+                                extra[lane]++;
+
+                            pc[lane] += relative_address;
+                        }
+                    });
+    };
+
+    switch (decoded.op)
+    {
+        case Op::Illegal: break;
+
+        // LOAD & STORE
+        case Op::LDA:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            a[lane] = read(lane, address[lane]);
+                            set_zn(lane, a[lane]);
+                        });
+            break;
+        case Op::LDX:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            x[lane] = read(lane, address[lane]);
+                            set_zn(lane, x[lane]);
+                        });
+            break;
+        case Op::LDY:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            y[lane] = read(lane, address[lane]);
+                            set_zn(lane, y[lane]);
+                        });
+            break;
+        case Op::STA:
+            ForEachLane(group, [&](unsigned lane) { write(lane, address[lane], a[lane]); });
+            break;
+        case Op::STX:
+            ForEachLane(group, [&](unsigned lane) { write(lane, address[lane], x[lane]); });
+            break;
+        case Op::STY:
+            ForEachLane(group, [&](unsigned lane) { write(lane, address[lane], y[lane]); });
+            break;
+
+        // REGISTER TRANSFERS
+        case Op::TAX: transfer(a, x, true); break;
+        case Op::TAY: transfer(a, y, true); break;
+        case Op::TXA: transfer(x, a, true); break;
+        case Op::TYA: transfer(y, a, true); break;
+
+        // STACK OPERATIONS
+        case Op::TSX: transfer(sp, x, true); break;
+        case Op::TXS: transfer(x, sp, false); break;
+        case Op::PHA:
+            ForEachLane(group, [&](unsigned lane) { push(lane, a[lane]); });
+            break;
+        case Op::PHP:
+            ForEachLane(group, [&](unsigned lane) { push(lane, PackStatus(lane)); });
+            break;
+        case Op::PLA:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            a[lane] = pull(lane);
+                            set_zn(lane, a[lane]);
+                        });
+            break;
+        case Op::PLP:
+            ForEachLane(group, [&](unsigned lane) { UnpackStatus(lane, pull(lane)); });
+            break;
+
+        // LOGICAL OPERATIONS
+        case Op::AND:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            a[lane] &= read(lane, address[lane]);
+                            set_zn(lane, a[lane]);
+                        });
+            break;
+        case Op::EOR:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            a[lane] ^= read(lane, address[lane]);
+                            set_zn(lane, a[lane]);
+                        });
+            break;
+        case Op::ORA:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            a[lane] |= read(lane, address[lane]);
+                            set_zn(lane, a[lane]);
+                        });
+            break;
+        case Op::BIT:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            const alu::Flags flags = alu::Bit(a[lane], read(lane, address[lane]));
+                            z[lane] = flags.zero;
+                            v[lane] = flags.overflow;
+                            n[lane] = flags.negative;
+                        });
+            break;
+
+        // ARITHMETIC OPERATIONS
+        case Op::ADC:
+            ForEachLane(group,
+                        [&](unsigned lane) { add_with_carry(lane, read(lane, address[lane])); });
+            break;
+        case Op::SBC:
+            ForEachLane(group,
+                        [&](unsigned lane) { add_with_carry(lane, ~read(lane, address[lane])); });
+            break;
+        case Op::CMP:
+            ForEachLane(group,
+                        [&](unsigned lane) { compare(lane, a[lane], read(lane, address[lane])); });
+            break;
+        case Op::CPX:
+            ForEachLane(group,
+                        [&](unsigned lane) { compare(lane, x[lane], read(lane, address[lane])); });
+            break;
+        case Op::CPY:
+            ForEachLane(group,
+                        [&](unsigned lane) { compare(lane, y[lane], read(lane, address[lane])); });
+            break;
+
+        // INCREMENT & DECREMENT OPERATIONS
+        case Op::INC:
+        case Op::DEC:
+        {
+            const uint8_t delta = (decoded.op == Op::INC) ? 1 : 0xFF;
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            uint8_t result = read(lane, address[lane]) + delta;
+                            write(lane, address[lane], result);
+                            set_zn(lane, result);
+                        });
+            break;
+        }
+        case Op::INX: add(x, 1); break;
+        case Op::INY: add(y, 1); break;
+        case Op::DEX: add(x, 0xFF); break;
+        case Op::DEY: add(y, 0xFF); break;
+
+        // SHIFT OPERATIONS
+        case Op::ASLA:
+            shift_a([](uint8_t operand, bool) { return alu::ShiftLeft(operand); });
+            break;
+        case Op::LSRA:
+            shift_a([](uint8_t operand, bool) { return alu::ShiftRight(operand); });
+            break;
+        case Op::ROLA:
+            shift_a([](uint8_t operand, bool carry) { return alu::RotateLeft(operand, carry); });
+            break;
+        case Op::RORA:
+            shift_a([](uint8_t operand, bool carry) { return alu::RotateRight(operand, carry); });
+            break;
+        case Op::ASL:
+        case Op::LSR:
+        case Op::ROL:
+        case Op::ROR:
+        {
+            const Op op = decoded.op;
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            const uint8_t operand = read(lane, address[lane]);
+                            alu::Shift result;
+                            if (op == Op::ASL)
+                                result = alu::ShiftLeft(operand);
+                            else if (op == Op::LSR)
+                                result = alu::ShiftRight(operand);
+                            else if (op == Op::ROL)
+                                result = alu::RotateLeft(operand, c[lane]);
+                            else
+                                result = alu::RotateRight(operand, c[lane]);
+
+                            write(lane, address[lane], result.value);
+                            c[lane] = result.carry;
+                            set_zn(lane, result.value);
+                        });
+            break;
+        }
+
+        // JUMPS & CALLS OPERATIONS
+        case Op::JMP:
+            ForEachLane(group, [&](unsigned lane) { pc[lane] = address[lane]; });
+            break;
+        case Op::JSR:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            push_word(lane, pc[lane] - 1);
+                            pc[lane] = address[lane];
+                        });
+            break;
+        case Op::RTS:
+            ForEachLane(group, [&](unsigned lane) { pc[lane] = pull_word(lane); });
+            break;
+
+        // BRANCH OPERATIONS
+        case Op::BCC: branch(c, false); break;
+        case Op::BCS: branch(c, true); break;
+        case Op::BEQ: branch(z, true); break;
+        case Op::BMI: branch(n, true); break;
+        case Op::BNE: branch(z, false); break;
+        case Op::BPL: branch(n, false); break;
+        case Op::BVC: branch(v, false); break;
+        case Op::BVS: branch(v, true); break;
+
+        // STATUS FLAG OPERATIONS
+        case Op::CLC: set_flag(c, 0); break;
+        case Op::CLD: set_flag(d, 0); break;
+        case Op::CLI: set_flag(i, 0); break;
+        case Op::CLV: set_flag(v, 0); break;
+        case Op::SEC: set_flag(c, 1); break;
+        case Op::SED: set_flag(d, 1); break;
+        case Op::SEI: set_flag(i, 1); break;
+
+        // SYSTEM OPERATIONS
+        case Op::BRK:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            push_word(lane, pc[lane]);
+                            push(lane, PackStatus(lane));
+                            pc[lane] = fetch_word(lane);
+                            b[lane] = 1;
+                        });
+            break;
+        case Op::NOP: break;
+        case Op::RTI:
+            ForEachLane(group,
+                        [&](unsigned lane)
+                        {
+                            UnpackStatus(lane, pull(lane));
+                            pc[lane] = pull_word(lane);
+                        });
+            break;
+    }
+
+    for (unsigned lane = 0; lane < max_lanes; lane++)
+        used[lane] += active[lane] & (decoded.cycles + extra[lane]);
+}
@@ -24,23 +24,607 @@
 
 #include "mem.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "rom_image.h"
+
+namespace
+{
+size_t HostPageSize()
+{
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+// Anonymous mappings are zero-filled lazily by the kernel, so untouched memory costs nothing.
+uint8_t* MapAddressSpace()
+{
+    void* address = mmap(nullptr, Mem::max_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "Unable to map memory");
+
+    return static_cast<uint8_t*>(address);
+}
+
+// Block size of the compare kernel, one bit of the mask per byte.
+const uint32_t block_size = 64;
+
+// Returns a mask with a bit set for every byte that differs between the blocks at a and b.
+uint64_t DiffMask(const uint8_t* a, const uint8_t* b)
+{
+#if defined(__AVX2__)
+    uint64_t equal = 0;
+    for (uint32_t i = 0; i < block_size; i += 32)
+    {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        equal |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)))) << i;
+    }
+    return ~equal;
+#elif defined(__SSE2__)
+    uint64_t equal = 0;
+    for (uint32_t i = 0; i < block_size; i += 16)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        equal |= uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) << i;
+    }
+    return ~equal;
+#else
+    uint64_t differs = 0;
+    for (uint32_t i = 0; i < block_size; i++)
+        differs |= uint64_t(a[i] != b[i]) << i;
+    return differs;
+#endif
+}
+
+// Odd keys from the SplitMix64 sequence, computed at compile time.
+template <size_t count>
+constexpr std::array<uint64_t, count> MakeHashKeys(uint64_t seed)
+{
+    std::array<uint64_t, count> keys = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = (seed + i + 1) * 0x9E3779B97F4A7C15;
+        key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9;
+        key = (key ^ (key >> 27)) * 0x94D049BB133111EB;
+        keys[i] = (key ^ (key >> 31)) | 1;
+    }
+
+    return keys;
+}
+}  // namespace
+
+const std::array<uint64_t, Mem::page_count> Mem::page_keys = MakeHashKeys<page_count>(0);
+const std::array<uint64_t, Mem::page_size> Mem::offset_keys = MakeHashKeys<page_size>(page_count);
+
+Mem::Mem() : data(MapAddressSpace())
+{
+    attributes.fill(kClean);
+}
+
+Mem::Mem(uint8_t* storage) : data(storage), owns_data(false)
+{
+    attributes.fill(kClean);
+}
+
+Mem::~Mem()
+{
+    if (data && owns_data)
+        munmap(data, max_size);
+}
+
+// The copy is plain RAM: pages that differ from zero in other are dirty in the copy.
+Mem::Mem(const Mem& other)
+    : data(MapAddressSpace()), hash(other.hash), unhashed_pages(other.unhashed_pages)
+{
+    std::memcpy(data, other.data, max_size);
+
+    for (uint32_t page = 0; page < page_count; page++)
+    {
+        attributes[page] = (other.IsZero(page) ? kClean : 0) |
+                           (other.attributes[page] & (kReadOnly | kUnhashed));
+    }
+}
+
+Mem::Mem(Mem&& other) noexcept
+    : data(other.data),
+      owns_data(other.owns_data),
+      attributes(other.attributes),
+      hash(other.hash),
+      unhashed_pages(other.unhashed_pages),
+      watchpoints(std::move(other.watchpoints)),
+      watch_callback(std::move(other.watch_callback)),
+      last_watch_hit(other.last_watch_hit),
+      next_watch_id(other.next_watch_id),
+      stop_requested(other.stop_requested)
+{
+    other.data = nullptr;
+}
+
+// Copies the contents only, mappings of this instance stay in place.
+Mem& Mem::operator=(const Mem& other)
+{
+    if (this != &other)
+    {
+        std::memcpy(data, other.data, max_size);
+
+        for (uint32_t page = 0; page < page_count; page++)
+        {
+            attributes[page] &= ~(kWritten | kUnhashed);
+            attributes[page] |= other.attributes[page] & kUnhashed;
+        }
+
+        hash = other.hash;
+        unhashed_pages = other.unhashed_pages;
+    }
+
+    return *this;
+}
+
+Mem& Mem::operator=(Mem&& other) noexcept
+{
+    std::swap(data, other.data);
+    std::swap(owns_data, other.owns_data);
+    std::swap(attributes, other.attributes);
+    std::swap(hash, other.hash);
+    std::swap(unhashed_pages, other.unhashed_pages);
+    std::swap(watchpoints, other.watchpoints);
+    std::swap(watch_callback, other.watch_callback);
+    std::swap(last_watch_hit, other.last_watch_hit);
+    std::swap(next_watch_id, other.next_watch_id);
+    std::swap(stop_requested, other.stop_requested);
+    return *this;
+}
 
 void Mem::Initialize()
 {
-    data.fill(0);
+    const size_t host_page_size = HostPageSize();
+    uint8_t* discarded = nullptr;
+
+    for (uint32_t page = 0; page < page_count; page++)
+    {
+        uint16_t& attribute = attributes[page];
+        if (attribute & (kClean | kShared | kReadOnly))
+            continue;
+
+        Unhash(page);
+
+        uint8_t* begin = data + page * page_size;
+        if (attribute & kPrivate)
+        {
+            // Dropping the private copy of a host page makes it read from the file again.
+            uint8_t* host_page = data + (begin - data) / host_page_size * host_page_size;
+            if (host_page != discarded)
+            {
+                const uint32_t first = (host_page - data) / page_size;
+                for (uint32_t other = first; other < first + host_page_size / page_size; other++)
+                    Unhash(other);
+
+                madvise(host_page, host_page_size, MADV_DONTNEED);
+            }
+
+            discarded = host_page;
+        }
+        else
+        {
+            std::memset(begin, 0, page_size);
+        }
+
+        attribute = (attribute | kClean) & ~kUnmodified;
+    }
+}
+
+void Mem::Map(const std::string& path, uint16_t address, Mapping mapping, size_t offset,
+              size_t length)
+{
+    if (!owns_data)
+        throw std::invalid_argument("Cannot map a file into borrowed storage: " + path);
+
+    const size_t host_page_size = HostPageSize();
+    if (address % host_page_size != 0 || offset % host_page_size != 0)
+        throw std::invalid_argument("Mapped address and offset must be page aligned: " + path);
+
+    const bool shared = (mapping == Mapping::Shared);
+    const int fd = open(path.c_str(), shared ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to open " + path);
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Unable to stat " + path);
+    }
+
+    const size_t file_size = status.st_size;
+    if (length == 0 && offset < file_size)
+        length = file_size - offset;
+
+    if (length == 0 || offset + length > file_size || address + length > max_size)
+    {
+        close(fd);
+        throw std::invalid_argument("Mapping does not fit the file or address space: " + path);
+    }
+
+    try
+    {
+        MapPages(fd, address, length, offset, shared, path);
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    close(fd);
+}
+
+void Mem::MapRom(const RomImage& rom, uint16_t address)
+{
+    if (!owns_data)
+        throw std::invalid_argument("Cannot map a ROM image into borrowed storage");
+    if (address % HostPageSize() != 0 || address + rom.Size() > max_size)
+        throw std::invalid_argument("ROM image does not fit at a page aligned address");
+
+    MapPages(rom.Descriptor(), address, rom.Size(), 0, false, "a ROM image");
+    Protect(address, rom.Size());
+}
+
+void Mem::Protect(uint16_t address, uint32_t length, bool read_only)
+{
+    if (address % page_size != 0 || length % page_size != 0 || address + length > max_size)
+        throw std::invalid_argument("Protected range must cover whole pages");
+
+    for (uint32_t page = address / page_size; page < (address + length) / page_size; page++)
+    {
+        if (read_only)
+            attributes[page] |= kReadOnly;
+        else
+            attributes[page] &= ~kReadOnly;
+    }
+}
+
+int Mem::AddWatchpoint(uint16_t begin, uint16_t end, uint8_t access)
+{
+    if (begin > end || (access & ~(kRead | kWrite | kExecute)) != 0)
+        throw std::invalid_argument("Invalid watchpoint");
+
+    watchpoints.push_back({next_watch_id, begin, end, access});
+    UpdateWatchAttributes();
+
+    return next_watch_id++;
+}
+
+void Mem::RemoveWatchpoint(int id)
+{
+    for (auto it = watchpoints.begin(); it != watchpoints.end(); it++)
+    {
+        if (it->id == id)
+        {
+            watchpoints.erase(it);
+            break;
+        }
+    }
+
+    UpdateWatchAttributes();
+}
+
+void Mem::SetWatchCallback(WatchCallback callback)
+{
+    watch_callback = std::move(callback);
+}
+
+const Mem::WatchHit& Mem::LastWatchHit() const
+{
+    return last_watch_hit;
+}
+
+void Mem::UpdateWatchAttributes()
+{
+    for (uint16_t& attribute : attributes)
+        attribute &= ~(kWatchRead | kWatchWrite | kWatchExecute);
+
+    for (const Watchpoint& watchpoint : watchpoints)
+    {
+        uint8_t watch = 0;
+        watch |= (watchpoint.access & kRead) ? kWatchRead : 0;
+        watch |= (watchpoint.access & kWrite) ? kWatchWrite : 0;
+        watch |= (watchpoint.access & kExecute) ? kWatchExecute : 0;
+
+        for (uint32_t page = watchpoint.begin >> 8; page <= (watchpoint.end >> 8); page++)
+            attributes[page] |= watch;
+    }
+}
+
+void Mem::Load(uint16_t address, const uint8_t* bytes, size_t length)
+{
+    MarkWritten(address, length);
+    std::memcpy(data + address, bytes, length);
+}
+
+void Mem::Load(uint16_t address, const std::vector<uint8_t>& bytes)
+{
+    Load(address, bytes.data(), bytes.size());
+}
+
+void Mem::Dump(uint16_t address, uint8_t* bytes, size_t length) const
+{
+    if (address + length > max_size)
+        throw std::invalid_argument("Range exceeds the address space");
+
+    std::memcpy(bytes, data + address, length);
+}
+
+void Mem::Fill(uint16_t address, size_t length, uint8_t value)
+{
+    if (value != 0)
+    {
+        MarkWritten(address, length);
+        std::memset(data + address, value, length);
+        return;
+    }
+
+    if (address + length > max_size)
+        throw std::invalid_argument("Range exceeds the address space");
+
+    // Zeroing a page that was never written leaves it clean, without touching its host page.
+    const uint32_t end = address + length;
+    for (uint32_t begin = address; begin < end;)
+    {
+        const uint32_t page = begin / page_size;
+        const uint32_t next = std::min<uint32_t>(end, (page + 1) * page_size);
+        if (!IsZero(page))
+        {
+            MarkWritten(begin, next - begin);
+            std::memset(data + begin, 0, next - begin);
+        }
+
+        begin = next;
+    }
+}
+
+Mem::View Mem::Slice(uint16_t address, size_t length) const
+{
+    if (address + length > max_size)
+        throw std::invalid_argument("Range exceeds the address space");
+
+    return View(data + address, length);
+}
+
+bool Mem::Compare(const Mem& other) const
+{
+    for (uint32_t page = 0; page < page_count; page++)
+    {
+        if (IsZero(page) && other.IsZero(page))
+            continue;
+
+        const uint32_t begin = page * page_size;
+        for (uint32_t block = begin; block < begin + page_size; block += block_size)
+        {
+            if (DiffMask(data + block, other.data + block))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<Mem::Range> Mem::Diff(const Mem& other) const
+{
+    std::vector<Range> ranges;
+
+    // Whether the last range ends at the current position and may be extended.
+    bool open = false;
+
+    for (uint32_t page = 0; page < page_count; page++)
+    {
+        if (IsZero(page) && other.IsZero(page))
+        {
+            open = false;
+            continue;
+        }
+
+        const uint32_t begin = page * page_size;
+        for (uint32_t block = begin; block < begin + page_size; block += block_size)
+        {
+            const uint64_t mask = DiffMask(data + block, other.data + block);
+            if (mask == 0)
+            {
+                open = false;
+                continue;
+            }
+
+            // Walk the runs of set bits in the mask.
+            uint32_t bit = 0;
+            while (bit < block_size)
+            {
+                const uint64_t rest = mask >> bit;
+                if (rest == 0)
+                {
+                    open = false;
+                    break;
+                }
+
+                const uint32_t equal = __builtin_ctzll(rest);
+                if (equal > 0)
+                    open = false;
+
+                bit += equal;
+                const uint64_t differing = ~(mask >> bit);
+                const uint32_t run = differing ? __builtin_ctzll(differing) : block_size - bit;
+
+                if (open)
+                    ranges.back().end = block + bit + run;
+                else
+                    ranges.push_back({block + bit, block + bit + run});
+
+                open = true;
+                bit += run;
+            }
+        }
+    }
+
+    return ranges;
+}
+
+// Maps length bytes of fd at address, Map and MapRom have checked the arguments.
+void Mem::MapPages(int fd, uint16_t address, size_t length, size_t offset, bool shared,
+                   const std::string& name)
+{
+    const size_t host_page_size = HostPageSize();
+    const size_t mapped_length = (length + host_page_size - 1) / host_page_size * host_page_size;
+    for (size_t page = address / page_size; page < (address + mapped_length) / page_size; page++)
+        Unhash(page);
+
+    void* mapped = mmap(data + address, mapped_length, PROT_READ | PROT_WRITE,
+                        (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED, fd, offset);
+    if (mapped == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "Unable to map " + name);
+
+    for (size_t page = address / page_size; page < (address + mapped_length) / page_size; page++)
+    {
+        // Shared mappings keep their contents across power cycles and are never cleared.
+        attributes[page] &= ~(kPrivate | kShared | kWritten);
+        attributes[page] |= shared ? kShared : (kPrivate | kClean);
+    }
+}
+
+void Mem::ClearModified()
+{
+    for (uint16_t& attribute : attributes)
+        attribute |= kUnmodified;
+}
+
+uint64_t Mem::Hash()
+{
+    for (uint32_t page = 0; unhashed_pages > 0 && page < page_count; page++)
+        Rehash(page);
+
+    return hash;
+}
+
+// Pages that are clean and not mapped from a file are known to hold only zeroes.
+bool Mem::IsZero(uint32_t page) const
+{
+    return (attributes[page] & (kClean | kPrivate | kShared)) == kClean;
+}
+
+void Mem::MarkWritten(uint32_t address, size_t length)
+{
+    if (address + length > max_size)
+        throw std::invalid_argument("Range exceeds the address space");
+
+    for (uint32_t page = address / page_size; page * page_size < address + length; page++)
+    {
+        Unhash(page);
+        attributes[page] &= ~kWritten;
+    }
+}
+
+uint64_t Mem::HashPage(uint32_t page) const
+{
+    const uint8_t* bytes = data + page * page_size;
+    uint64_t sum = 0;
+    for (uint32_t offset = 0; offset < page_size; offset++)
+        sum += offset_keys[offset] * bytes[offset];
+    return page_keys[page] * sum;
+}
+
+// Takes a page out of the hash before the host changes it in ways the hash cannot follow.
+void Mem::Unhash(uint32_t page)
+{
+    if (attributes[page] & kUnhashed)
+        return;
+
+    if (!IsZero(page))
+        hash -= HashPage(page);
+
+    attributes[page] |= kUnhashed;
+    unhashed_pages++;
+}
+
+void Mem::Rehash(uint32_t page)
+{
+    if (!(attributes[page] & kUnhashed))
+        return;
+
+    hash += HashPage(page);
+    attributes[page] &= ~kUnhashed;
+    unhashed_pages--;
+}
+
+// Only reached for pages that overlap a watchpoint, the exact range is checked here.
+bool Mem::WatchSlow(uint16_t address, Access access)
+{
+    bool stop = false;
+    for (const Watchpoint& watchpoint : watchpoints)
+    {
+        if (!(watchpoint.access & access) || address < watchpoint.begin ||
+            address > watchpoint.end)
+            continue;
+
+        last_watch_hit = {watchpoint.id, address, access};
+        stop |= watch_callback ? watch_callback(last_watch_hit) : true;
+    }
+
+    return stop;
 }
 
 // Read a single byte from memory.
 uint8_t Mem::operator[](uint32_t address) const
 {
-    assert(address <= max_size);
+    assert(address < max_size);
     return data[address];
 }
 
 // Write a single byte to memory.
 uint8_t& Mem::operator[](uint32_t address)
 {
-    assert(address <= max_size);
+    assert(address < max_size);
+    Unhash(address / page_size);
+    attributes[address / page_size] &= ~kWritten;
     return data[address];
 }
+
+uint8_t Mem::ReadSlow(uint16_t address)
+{
+    stop_requested |= WatchSlow(address, kRead);
+    return data[address];
+}
+
+void Mem::WriteSlow(uint16_t address, uint8_t value)
+{
+    uint16_t& attribute = attributes[address >> 8];
+
+    if (attribute & kWatchWrite)
+        stop_requested |= WatchSlow(address, kWrite);
+
+    // Writes to ROM are ignored.
+    if (attribute & kReadOnly)
+        return;
+
+    // Back on the fast path after the first write since the host changed the page.
+    Rehash(address >> 8);
+    hash += HashKey(address) * (uint64_t{value} - data[address]);
+
+    attribute &= ~kWritten;
+    data[address] = value;
+}
@@ -0,0 +1,412 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "result_cache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+
+#include "save_state.h"
+
+namespace
+{
+// Entry layout, all integers little-endian. The checksum covers everything after it.
+const size_t magic_offset = 0;
+const size_t version_offset = 4;
+const size_t checksum_offset = 8;
+const size_t key_offset = 16;
+const size_t key_size = 8 + 8 + 4 + SaveState::cpu_state_size;
+const size_t used_offset = key_offset + key_size;
+const size_t stop_reason_offset = used_offset + 4;
+const size_t header_size = stop_reason_offset + 1;
+
+const char* const entry_suffix = ".run";
+const char* const temporary_suffix = ".tmp";
+
+void Put(uint8_t* out, uint64_t value, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        out[i] = value >> (8 * i);
+}
+
+uint64_t Get(const uint8_t* in, size_t length)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; i++)
+        value |= uint64_t(in[i]) << (8 * i);
+    return value;
+}
+
+uint64_t HashBytes(const uint8_t* bytes, size_t length)
+{
+    uint64_t hash = length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+        hash ^= hash >> 29;
+    }
+    for (; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x9E3779B97F4A7C15;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+bool EndsWith(const std::string& name, const char* suffix)
+{
+    const size_t length = std::strlen(suffix);
+    return name.size() >= length && name.compare(name.size() - length, length, suffix) == 0;
+}
+
+// The id of an entry file name: 16 lowercase hex digits and the suffix.
+bool ParseId(const std::string& name, uint64_t& id)
+{
+    if (name.size() != 16 + std::strlen(entry_suffix) || !EndsWith(name, entry_suffix))
+        return false;
+
+    id = 0;
+    for (size_t i = 0; i < 16; i++)
+    {
+        const char c = name[i];
+        if (c >= '0' && c <= '9')
+            id = id << 4 | (c - '0');
+        else if (c >= 'a' && c <= 'f')
+            id = id << 4 | (c - 'a' + 10);
+        else
+            return false;
+    }
+    return true;
+}
+
+[[noreturn]] void Fail(const std::string& message)
+{
+    throw std::system_error(errno, std::generic_category(), message);
+}
+
+const ResultCacheConfig& Validate(const ResultCacheConfig& config)
+{
+    if (config.directory.empty() || config.max_bytes == 0 || config.max_entries == 0)
+        throw std::invalid_argument("Result caches need a directory and non-zero limits");
+    return config;
+}
+
+SnapshotCodec MakeCodec(const std::vector<uint8_t>& reference)
+{
+    if (reference.empty())
+        return SnapshotCodec();
+    return SnapshotCodec(Mem::View(reference.data(), reference.size()));
+}
+}  // namespace
+
+struct ResultCache::Key
+{
+    uint8_t bytes[key_size];
+};
+
+ResultCache::ResultCache(const ResultCacheConfig& config)
+    : config(Validate(config)), codec(MakeCodec(config.reference))
+{
+    if (mkdir(config.directory.c_str(), 0755) < 0 && errno != EEXIST)
+        Fail("Unable to create " + config.directory);
+
+    DIR* directory = opendir(config.directory.c_str());
+    if (!directory)
+        Fail("Unable to open " + config.directory);
+
+    // Modification time, id and size of every entry. Temporary files are left by a crash.
+    std::vector<std::tuple<int64_t, uint64_t, uint64_t>> found;
+    while (const dirent* item = readdir(directory))
+    {
+        const std::string name = item->d_name;
+        const std::string path = config.directory + "/" + name;
+        uint64_t id;
+        struct stat status;
+        if (EndsWith(name, temporary_suffix))
+            unlink(path.c_str());
+        else if (ParseId(name, id) && stat(path.c_str(), &status) == 0)
+            found.emplace_back(int64_t{status.st_mtim.tv_sec} * 1000000000 + status.st_mtim.tv_nsec,
+                               id, status.st_size);
+    }
+    closedir(directory);
+
+    std::sort(found.begin(), found.end());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& [time, id, bytes] : found)
+    {
+        last_use = std::max(last_use, time);
+        Insert(id, bytes);
+    }
+}
+
+uint32_t ResultCache::Execute(uint32_t machine_cycles, CPU& cpu, Mem& memory, uint64_t parameters)
+{
+    if (cpu.coverage)
+        return cpu.Execute(machine_cycles, memory);
+
+    CPU::State state = cpu.GetState();
+    const uint64_t start = state.cycles;
+    state.cycles = 0;
+
+    // Left over from an earlier stop, only read while watch_stopped is set.
+    if (!state.watch_stopped)
+        state.watch_stop_pc = 0;
+
+    // Zeroed, as the CPU state has padding.
+    Key key = {};
+    Put(&key.bytes[0], memory.Hash(), 8);
+    Put(&key.bytes[8], parameters, 8);
+    Put(&key.bytes[16], machine_cycles, 4);
+    SaveState::PutCpuState(state, &key.bytes[20]);
+    const uint64_t id = HashBytes(key.bytes, key_size);
+
+    uint32_t used;
+    if (Restore(id, key, used, cpu, memory))
+    {
+        cpu.cycles = start + used;
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.hits++;
+        return used;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.misses++;
+    }
+
+    used = cpu.Execute(machine_cycles, memory);
+    Store(id, key, used, cpu, memory);
+    return used;
+}
+
+ResultCache::Stats ResultCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+bool ResultCache::Restore(uint64_t id, const Key& key, uint32_t& used, CPU& cpu, Mem& memory)
+{
+    timespec time;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(id);
+        if (it == entries.end())
+            return false;
+        uses.splice(uses.begin(), uses, it->second.use);
+        time = UseTime();
+    }
+
+    // Evicted since the lookup, or removed by hand.
+    const std::string path = Path(id);
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT)
+    {
+        Remove(id);
+        return false;
+    }
+    if (fd < 0)
+        Fail("Unable to open " + path);
+
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[64 * 1024];
+    ssize_t count;
+    while ((count = read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+        {
+            const int code = errno;
+            close(fd);
+            throw std::system_error(code, std::generic_category(), "Unable to read " + path);
+        }
+
+        bytes.insert(bytes.end(), buffer, buffer + count);
+    }
+
+    // Keeps the use order for the next process.
+    const timespec times[2] = {time, time};
+    futimens(fd, times);
+    close(fd);
+
+    // A torn write, another version or a run with the same id.
+    if (bytes.size() < header_size || Get(&bytes[magic_offset], 4) != magic ||
+        Get(&bytes[version_offset], 2) != version ||
+        Get(&bytes[checksum_offset], 8) !=
+            HashBytes(&bytes[key_offset], bytes.size() - key_offset) ||
+        std::memcmp(&bytes[key_offset], key.bytes, key_size) != 0)
+    {
+        Remove(id);
+        return false;
+    }
+
+    // The codec checks the reference image before it changes the machine, and the checksum
+    // rules out a malformed snapshot.
+    try
+    {
+        codec.Decompress(&bytes[header_size], bytes.size() - header_size, cpu, memory);
+    }
+    catch (const std::invalid_argument&)
+    {
+        Remove(id);
+        return false;
+    }
+
+    used = Get(&bytes[used_offset], 4);
+    cpu.stop_reason = static_cast<CPU::StopReason>(bytes[stop_reason_offset]);
+    return true;
+}
+
+void ResultCache::Store(uint64_t id, const Key& key, uint32_t used, const CPU& cpu,
+                        const Mem& memory)
+{
+    const std::vector<uint8_t> snapshot = codec.Compress(cpu, memory);
+    std::vector<uint8_t> bytes(header_size);
+    Put(&bytes[magic_offset], magic, 4);
+    Put(&bytes[version_offset], version, 2);
+    std::memcpy(&bytes[key_offset], key.bytes, key_size);
+    Put(&bytes[used_offset], used, 4);
+    bytes[stop_reason_offset] = static_cast<uint8_t>(cpu.stop_reason);
+    bytes.insert(bytes.end(), snapshot.begin(), snapshot.end());
+    Put(&bytes[checksum_offset], HashBytes(&bytes[key_offset], bytes.size() - key_offset), 8);
+
+    // Unique per call, as workers may store the same run at once. A cache does not need to
+    // survive a crash, so the file is not synced; the checksum catches a torn one.
+    const std::string temporary =
+        Path(id) + "." + std::to_string(next_temporary++) + temporary_suffix;
+    const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        Fail("Unable to create " + temporary);
+
+    for (size_t written = 0; written < bytes.size();)
+    {
+        const ssize_t count = write(fd, bytes.data() + written, bytes.size() - written);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+        {
+            const int code = errno;
+            close(fd);
+            unlink(temporary.c_str());
+            throw std::system_error(code, std::generic_category(), "Unable to write " + temporary);
+        }
+
+        written += count;
+    }
+
+    timespec time;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        time = UseTime();
+    }
+    const timespec times[2] = {time, time};
+    futimens(fd, times);
+    close(fd);
+
+    if (rename(temporary.c_str(), Path(id).c_str()) < 0)
+    {
+        const int code = errno;
+        unlink(temporary.c_str());
+        throw std::system_error(code, std::generic_category(), "Unable to rename " + temporary);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Insert(id, bytes.size());
+}
+
+// Called with the mutex held.
+void ResultCache::Insert(uint64_t id, uint64_t bytes)
+{
+    auto it = entries.find(id);
+    if (it != entries.end())
+    {
+        stats.bytes -= it->second.bytes;
+        it->second.bytes = bytes;
+        uses.splice(uses.begin(), uses, it->second.use);
+    }
+    else
+    {
+        uses.push_front(id);
+        entries.emplace(id, Entry{bytes, uses.begin()});
+    }
+
+    stats.bytes += bytes;
+    while (!uses.empty() && (entries.size() > config.max_entries || stats.bytes > config.max_bytes))
+    {
+        const uint64_t victim = uses.back();
+        unlink(Path(victim).c_str());
+        stats.bytes -= entries[victim].bytes;
+        entries.erase(victim);
+        uses.pop_back();
+        stats.evicted++;
+    }
+
+    stats.entries = entries.size();
+}
+
+// Called with the mutex held. The clock of the file system is too coarse to order the uses.
+timespec ResultCache::UseTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    last_use = std::max(last_use + 1, int64_t{now.tv_sec} * 1000000000 + now.tv_nsec);
+    return {static_cast<time_t>(last_use / 1000000000), static_cast<long>(last_use % 1000000000)};
+}
+
+void ResultCache::Remove(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (it == entries.end())
+        return;
+
+    unlink(Path(id).c_str());
+    stats.bytes -= it->second.bytes;
+    uses.erase(it->second.use);
+    entries.erase(it);
+    stats.entries = entries.size();
+}
+
+std::string ResultCache::Path(uint64_t id) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(id));
+    return config.directory + "/" + name + entry_suffix;
+}
@@ -0,0 +1,219 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rewind_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+const uint32_t RewindBuffer::kZeroPage;
+
+RewindBuffer::RewindBuffer(const RewindConfig& config, const CPU& cpu, Mem& memory)
+    : config(config), pages(1)
+{
+    if (config.interval == 0 || config.capacity == 0)
+        throw std::invalid_argument("Rewind interval and capacity must be positive");
+
+    Checkpoint(cpu, memory);
+}
+
+uint32_t RewindBuffer::Execute(uint32_t machine_cycles, CPU& cpu, Mem& memory)
+{
+    uint32_t used = 0;
+    while (used < machine_cycles)
+    {
+        const uint64_t due = entries.back().cpu.cycles + config.interval;
+        if (cpu.cycles >= due)
+        {
+            Checkpoint(cpu, memory);
+            continue;
+        }
+
+        const uint64_t slice = std::min<uint64_t>(machine_cycles - used, due - cpu.cycles);
+        used += cpu.Execute(static_cast<uint32_t>(slice), memory);
+
+        if (cpu.cycles >= due)
+            Checkpoint(cpu, memory);
+        if (cpu.stop_reason == CPU::StopReason::Watchpoint)
+            break;
+    }
+
+    return used;
+}
+
+void RewindBuffer::Checkpoint(const CPU& cpu, Mem& memory)
+{
+    const Entry* previous = entries.empty() ? nullptr : &entries.back();
+
+    Entry entry;
+    entry.cpu = cpu.GetState();
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        const uint16_t address = page * Mem::page_size;
+        uint32_t& reference = entry.pages[page];
+
+        if (memory.IsReadOnly(address))
+        {
+            reference = kZeroPage;
+        }
+        else if (previous && !memory.IsModified(page))
+        {
+            reference = previous->pages[page];
+        }
+        else
+        {
+            const uint8_t* bytes = memory.Slice(address, Mem::page_size).data();
+            if (std::all_of(bytes, bytes + Mem::page_size, [](uint8_t byte) { return byte == 0; }))
+                reference = kZeroPage;
+            else if (previous && previous->pages[page] != kZeroPage &&
+                     std::memcmp(pages[previous->pages[page]].bytes.data(), bytes,
+                                 Mem::page_size) == 0)
+                reference = previous->pages[page];
+            else
+                reference = Store(bytes);
+        }
+
+        if (reference != kZeroPage)
+            pages[reference].references++;
+    }
+
+    entries.push_back(entry);
+    while (entries.size() > config.capacity)
+    {
+        Release(entries.front());
+        entries.pop_front();
+    }
+
+    memory.ClearModified();
+}
+
+void RewindBuffer::Restore(size_t index, CPU& cpu, Mem& memory) const
+{
+    if (index >= entries.size())
+        throw std::out_of_range("Checkpoint index out of range");
+
+    const Entry& entry = entries[index];
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+        Load(entry, page, memory);
+
+    cpu.SetState(entry.cpu);
+}
+
+void RewindBuffer::Seek(uint64_t cycle, CPU& cpu, Mem& memory)
+{
+    auto after = std::upper_bound(entries.begin(), entries.end(), cycle,
+                                  [](uint64_t value, const Entry& entry)
+                                  { return value < entry.cpu.cycles; });
+    if (after == entries.begin())
+        throw std::out_of_range("Cycle is before the oldest checkpoint");
+
+    const size_t kept = after - entries.begin();
+
+    // The machine differs from the target in the pages written since the newest checkpoint and
+    // in those the checkpoints do not share.
+    const Entry& newest = entries.back();
+    const Entry& target = entries[kept - 1];
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        if (memory.IsModified(page) || newest.pages[page] != target.pages[page])
+            Load(target, page, memory);
+    }
+
+    cpu.SetState(target.cpu);
+    memory.ClearModified();
+
+    while (entries.size() > kept)
+    {
+        Release(entries.back());
+        entries.pop_back();
+    }
+
+    while (cpu.cycles < cycle)
+    {
+        const uint64_t remaining = cycle - cpu.cycles;
+        Execute(static_cast<uint32_t>(
+                    std::min<uint64_t>(remaining, std::numeric_limits<uint32_t>::max())),
+                cpu, memory);
+    }
+}
+
+size_t RewindBuffer::Size() const
+{
+    return entries.size();
+}
+
+uint64_t RewindBuffer::Cycle(size_t index) const
+{
+    if (index >= entries.size())
+        throw std::out_of_range("Checkpoint index out of range");
+
+    return entries[index].cpu.cycles;
+}
+
+size_t RewindBuffer::Bytes() const
+{
+    return (pages.size() - 1 - free_pages.size()) * sizeof(Page) + entries.size() * sizeof(Entry);
+}
+
+uint32_t RewindBuffer::Store(const uint8_t* bytes)
+{
+    uint32_t index;
+    if (free_pages.empty())
+    {
+        index = static_cast<uint32_t>(pages.size());
+        pages.emplace_back();
+    }
+    else
+    {
+        index = free_pages.back();
+        free_pages.pop_back();
+    }
+
+    std::memcpy(pages[index].bytes.data(), bytes, Mem::page_size);
+    pages[index].references = 0;
+    return index;
+}
+
+void RewindBuffer::Release(const Entry& entry)
+{
+    for (uint32_t reference : entry.pages)
+    {
+        if (reference != kZeroPage && --pages[reference].references == 0)
+            free_pages.push_back(reference);
+    }
+}
+
+void RewindBuffer::Load(const Entry& entry, uint32_t page, Mem& memory) const
+{
+    const uint16_t address = page * Mem::page_size;
+    if (memory.IsReadOnly(address))
+        return;
+
+    if (entry.pages[page] == kZeroPage)
+        memory.Fill(address, Mem::page_size, 0);
+    else
+        memory.Load(address, pages[entry.pages[page]].bytes.data(), Mem::page_size);
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rom_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include "mem.h"
+
+RomImage::RomImage(const std::vector<uint8_t>& bytes) : RomImage(bytes.data(), bytes.size())
+{
+}
+
+RomImage::RomImage(const uint8_t* bytes, size_t length)
+{
+    if (length == 0 || length > Mem::max_size)
+        throw std::invalid_argument("Invalid ROM image size");
+
+    const size_t host_page_size = sysconf(_SC_PAGESIZE);
+    size = (length + host_page_size - 1) / host_page_size * host_page_size;
+
+    fd = memfd_create("mos6502-rom", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "Unable to create a ROM image");
+
+    bool written = (ftruncate(fd, size) == 0);
+    for (size_t offset = 0; written && offset < length;)
+    {
+        const ssize_t count = pwrite(fd, bytes + offset, length - offset, offset);
+        written = (count > 0);
+        offset += written ? count : 0;
+    }
+
+    // Sealed, a private mapping can never see the image change.
+    if (!written || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Unable to create a ROM image");
+    }
+}
+
+RomImage::~RomImage()
+{
+    close(fd);
+}
+
+int RomImage::Descriptor() const
+{
+    return fd;
+}
+
+size_t RomImage::Size() const
+{
+    return size;
+}
@@ -0,0 +1,172 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "save_state.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+// Header layout, all integers little-endian.
+const size_t magic_offset = 0;
+const size_t version_offset = 4;
+const size_t header_size_offset = 6;
+const size_t cpu_state_offset = 8;
+
+// CPU state layout, relative to cpu_state_offset.
+const size_t registers_offset = 0;  // PC, SP, A, X, Y, PS
+const size_t flags_offset = 7;
+const size_t watch_stop_pc_offset = 8;
+const size_t cycles_offset = 16;
+
+enum Flags : uint8_t
+{
+    kConsumeCycle = 1 << 0,
+    kPageCrossed = 1 << 1,
+    kWatchStopped = 1 << 2
+};
+
+void Put(uint8_t* out, uint64_t value, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        out[i] = value >> (8 * i);
+}
+
+uint64_t Get(const uint8_t* in, size_t length)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; i++)
+        value |= uint64_t(in[i]) << (8 * i);
+    return value;
+}
+}  // namespace
+
+const uint32_t SaveState::magic;
+const uint16_t SaveState::version;
+const size_t SaveState::header_size;
+const size_t SaveState::size;
+const size_t SaveState::cpu_state_size;
+
+SaveState::SaveState() : bytes(size)
+{
+    Put(&bytes[magic_offset], magic, 4);
+    Put(&bytes[version_offset], version, 2);
+    Put(&bytes[header_size_offset], header_size, 2);
+}
+
+SaveState::SaveState(const CPU& cpu, const Mem& memory) : SaveState()
+{
+    Capture(cpu, memory);
+}
+
+SaveState SaveState::FromBytes(const uint8_t* bytes, size_t length)
+{
+    if (length < header_size || Get(bytes + magic_offset, 4) != magic)
+        throw std::invalid_argument("Not a save state");
+    if (Get(bytes + version_offset, 2) != version ||
+        Get(bytes + header_size_offset, 2) != header_size)
+        throw std::invalid_argument("Unsupported save state version");
+    if (length != size)
+        throw std::invalid_argument("Truncated save state");
+
+    SaveState state;
+    std::memcpy(state.bytes.data(), bytes, size);
+    return state;
+}
+
+void SaveState::Capture(const CPU& cpu, const Mem& memory)
+{
+    PutCpuState(cpu.GetState(), bytes.data() + cpu_state_offset);
+    memory.Dump(0, bytes.data() + header_size, Mem::max_size);
+}
+
+void SaveState::Restore(CPU& cpu, Mem& memory) const
+{
+    const uint8_t* contents = bytes.data() + header_size;
+
+    // One copy per run of writable pages.
+    uint32_t begin = 0;
+    for (uint32_t address = 0; address <= Mem::max_size; address += Mem::page_size)
+    {
+        if (address < Mem::max_size && !memory.IsReadOnly(address))
+            continue;
+
+        if (begin < address)
+            memory.Load(begin, contents + begin, address - begin);
+        begin = address + Mem::page_size;
+    }
+
+    cpu.SetState(CpuState());
+}
+
+const std::vector<uint8_t>& SaveState::Bytes() const
+{
+    return bytes;
+}
+
+CPU::State SaveState::CpuState() const
+{
+    return GetCpuState(bytes.data() + cpu_state_offset);
+}
+
+Mem::View SaveState::Memory() const
+{
+    return Mem::View(bytes.data() + header_size, Mem::max_size);
+}
+
+void SaveState::PutCpuState(const CPU::State& state, uint8_t* out)
+{
+    const CPU::Registers& registers = state.registers;
+    Put(out + registers_offset, registers.PC, 2);
+    out[registers_offset + 2] = registers.SP;
+    out[registers_offset + 3] = registers.A;
+    out[registers_offset + 4] = registers.X;
+    out[registers_offset + 5] = registers.Y;
+    out[registers_offset + 6] = registers.PS;
+    out[flags_offset] = (state.consume_cycle ? kConsumeCycle : 0) |
+                        (state.page_crossed ? kPageCrossed : 0) |
+                        (state.watch_stopped ? kWatchStopped : 0);
+    Put(out + watch_stop_pc_offset, state.watch_stop_pc, 2);
+    Put(out + cycles_offset, state.cycles, 8);
+}
+
+CPU::State SaveState::GetCpuState(const uint8_t* in)
+{
+    const uint8_t flags = in[flags_offset];
+
+    CPU::State state;
+    state.registers.PC = Get(in + registers_offset, 2);
+    state.registers.SP = in[registers_offset + 2];
+    state.registers.A = in[registers_offset + 3];
+    state.registers.X = in[registers_offset + 4];
+    state.registers.Y = in[registers_offset + 5];
+    state.registers.PS = in[registers_offset + 6];
+    state.consume_cycle = flags & kConsumeCycle;
+    state.page_crossed = flags & kPageCrossed;
+    state.watch_stopped = flags & kWatchStopped;
+    state.watch_stop_pc = Get(in + watch_stop_pc_offset, 2);
+    state.cycles = Get(in + cycles_offset, 8);
+    return state;
+}
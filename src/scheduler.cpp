@@ -0,0 +1,356 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+// Pass of one cycle at priority 1, so passes of high priorities do not round to zero.
+const uint64_t pass_scale = 1 << 16;
+
+struct SliceResult
+{
+    uint32_t cycles = 0;
+    Scheduler::State state = Scheduler::State::Ready;
+    std::string error;
+};
+
+// Whether the CPU is at a JMP to itself, the usual way programs halt.
+bool IsHalted(const CPU& cpu, const Mem& memory)
+{
+    return memory.Fetch(cpu.PC) == 0x4C && memory.Fetch(cpu.PC + 1) == (cpu.PC & 0xFF) &&
+           memory.Fetch(cpu.PC + 2) == (cpu.PC >> 8);
+}
+
+SliceResult RunSlice(CPU& cpu, Mem& memory, const std::vector<int>& idle_watchpoints,
+                     uint32_t budget)
+{
+    SliceResult result;
+    try
+    {
+        result.cycles = cpu.Execute(budget, memory);
+    }
+    catch (const std::exception& e)
+    {
+        result.state = Scheduler::State::Halted;
+        result.error = e.what();
+        return result;
+    }
+
+    if (cpu.stop_reason == CPU::StopReason::Watchpoint)
+    {
+        const int hit = memory.LastWatchHit().id;
+        const bool idle = std::find(idle_watchpoints.begin(), idle_watchpoints.end(), hit) !=
+                          idle_watchpoints.end();
+        result.state = idle ? Scheduler::State::Idle : Scheduler::State::Stopped;
+    }
+    else if (IsHalted(cpu, memory))
+    {
+        result.state = Scheduler::State::Halted;
+    }
+
+    return result;
+}
+
+bool IsParked(Scheduler::State state)
+{
+    return state == Scheduler::State::Idle || state == Scheduler::State::Halted ||
+           state == Scheduler::State::Stopped;
+}
+}  // namespace
+
+Scheduler::Scheduler(const SchedulerConfig& config) : config(config)
+{
+    if (config.slice == 0 || config.period.count() <= 0)
+        throw std::invalid_argument("Invalid scheduler slice or period");
+
+    const unsigned threads =
+        config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; i++)
+        workers.emplace_back(&Scheduler::Run, this);
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    work_available.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+Scheduler::Id Scheduler::Add(CPU& cpu, Mem& memory, const Options& options)
+{
+    if (options.priority == 0)
+        throw std::invalid_argument("The priority must be at least 1");
+
+    std::vector<int> idle_watchpoints;
+    for (uint16_t address : options.idle_addresses)
+        idle_watchpoints.push_back(memory.AddWatchpoint(address, address, Mem::kExecute));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const Id id = next_id++;
+    auto entry = std::make_unique<Entry>(Entry{cpu, memory, options, idle_watchpoints});
+    entry->period_start = Clock::now();
+    MakeReady(id, *entry);
+    entries.emplace(id, std::move(entry));
+    return id;
+}
+
+Scheduler::Id Scheduler::Add(CPU& cpu, Mem& memory)
+{
+    return Add(cpu, memory, Options());
+}
+
+void Scheduler::Remove(Id id)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    Entry& entry = Hold(lock, id);
+
+    if (entry.stats.state == State::Throttled)
+        throttled.erase({entry.throttled_until, id});
+    for (int watchpoint : entry.idle_watchpoints)
+        entry.memory.RemoveWatchpoint(watchpoint);
+
+    entries.erase(id);
+
+    // Others waiting to hold the entry find it gone.
+    slice_done.notify_all();
+}
+
+void Scheduler::Wake(Id id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = Find(id);
+
+    if (entry.stats.state == State::Running)
+        entry.wake_pending = true;
+    else if (IsParked(entry.stats.state))
+    {
+        entry.stats.error.clear();
+        MakeReady(id, entry);
+    }
+}
+
+void Scheduler::Access(Id id, const std::function<void(CPU& cpu, Mem& memory)>& function)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    Entry& entry = Hold(lock, id);
+
+    // Held, so no other thread removes the entry until it is released.
+    auto release = [&]
+    {
+        lock.lock();
+        entry.held = false;
+        if (entry.stats.state == State::Ready)
+            MakeReady(id, entry);
+        slice_done.notify_all();
+    };
+
+    lock.unlock();
+    try
+    {
+        function(entry.cpu, entry.memory);
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+
+    release();
+}
+
+bool Scheduler::WaitParked(Id id, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    Find(id);
+
+    // Looked up after every wait, as the instance may be removed meanwhile.
+    slice_done.wait_for(lock, timeout,
+                        [&]
+                        {
+                            auto it = entries.find(id);
+                            return it == entries.end() || IsParked(it->second->stats.state);
+                        });
+    return IsParked(Find(id).stats.state);
+}
+
+Scheduler::Stats Scheduler::GetStats(Id id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return Find(id).stats;
+}
+
+size_t Scheduler::Size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+Scheduler::Entry& Scheduler::Find(Id id) const
+{
+    auto it = entries.find(id);
+    if (it == entries.end())
+        throw std::invalid_argument("Unknown instance");
+
+    return *it->second;
+}
+
+// Queues the entry unless it is held, Access queues it again when done.
+void Scheduler::MakeReady(Id id, Entry& entry)
+{
+    entry.stats.state = State::Ready;
+    entry.pass = std::max(entry.pass, virtual_time);
+    entry.runnable_since = Clock::now();
+
+    if (!entry.held)
+    {
+        ready.insert({entry.pass, id});
+        work_available.notify_one();
+    }
+}
+
+// Takes the entry off the ready queue and waits for its current slice. While another thread
+// holds it, that thread may remove it, so it is looked up again after the wait and Find throws
+// when it is gone. Once held, it stays until released.
+Scheduler::Entry& Scheduler::Hold(std::unique_lock<std::mutex>& lock, Id id)
+{
+    slice_done.wait(lock,
+                    [&]
+                    {
+                        auto it = entries.find(id);
+                        return it == entries.end() || !it->second->held;
+                    });
+
+    Entry& entry = Find(id);
+    entry.held = true;
+    ready.erase({entry.pass, id});
+    slice_done.wait(lock, [&] { return entry.stats.state != State::Running; });
+    return entry;
+}
+
+// Parks the entry until the start of its next period.
+void Scheduler::Throttle(Id id, Entry& entry)
+{
+    entry.stats.state = State::Throttled;
+    entry.throttled_until = entry.period_start + config.period;
+    throttled.insert({entry.throttled_until, id});
+}
+
+void Scheduler::ReleaseThrottled(Clock::time_point now)
+{
+    while (!throttled.empty() && throttled.begin()->first <= now)
+    {
+        const Id id = throttled.begin()->second;
+        throttled.erase(throttled.begin());
+
+        Entry& entry = *entries.at(id);
+        entry.period_start = entry.throttled_until;
+        entry.period_cycles = 0;
+        MakeReady(id, entry);
+    }
+}
+
+void Scheduler::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping)
+    {
+        Clock::time_point now = Clock::now();
+        ReleaseThrottled(now);
+
+        if (ready.empty())
+        {
+            if (throttled.empty())
+                work_available.wait(lock);
+            else
+                work_available.wait_until(lock, throttled.begin()->first);
+            continue;
+        }
+
+        const Id id = ready.begin()->second;
+        ready.erase(ready.begin());
+        Entry& entry = *entries.at(id);
+
+        const uint32_t quota = entry.options.quota;
+        if (quota != 0 && now - entry.period_start >= config.period)
+        {
+            entry.period_start = now;
+            entry.period_cycles = 0;
+        }
+
+        // Woken from parking with the quota of this period used up.
+        if (quota != 0 && entry.period_cycles >= quota)
+        {
+            Throttle(id, entry);
+            continue;
+        }
+
+        virtual_time = std::max(virtual_time, entry.pass);
+        entry.stats.state = State::Running;
+        const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now - entry.runnable_since);
+        entry.stats.total_latency += latency;
+        entry.stats.max_latency = std::max(entry.stats.max_latency, latency);
+
+        uint32_t budget = config.slice;
+        if (quota != 0)
+            budget = std::min<uint64_t>(budget, quota - entry.period_cycles);
+
+        lock.unlock();
+        SliceResult result = RunSlice(entry.cpu, entry.memory, entry.idle_watchpoints, budget);
+        lock.lock();
+
+        entry.stats.cycles += result.cycles;
+        entry.stats.slices++;
+        entry.stats.error = std::move(result.error);
+        entry.period_cycles += result.cycles;
+        entry.pass += std::max(result.cycles, 1u) * pass_scale / entry.options.priority;
+
+        State next = result.state;
+        if (IsParked(next) && entry.wake_pending)
+            next = State::Ready;
+        entry.wake_pending = false;
+
+        if (next == State::Ready && quota != 0 && entry.period_cycles >= quota)
+            Throttle(id, entry);
+        else if (next == State::Ready)
+            MakeReady(id, entry);
+        else
+        {
+            entry.stats.state = next;
+            entry.stats.parks++;
+        }
+
+        slice_done.notify_all();
+    }
+}
@@ -0,0 +1,992 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "session_server.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+using namespace session_protocol;
+
+namespace
+{
+const uint64_t listener_id = 0;
+const uint64_t wakeup_id = 1;
+
+// The rest of a request cannot be decoded after a malformed operation.
+class MalformedMessage : public std::invalid_argument
+{
+   public:
+    MalformedMessage() : std::invalid_argument("Malformed message")
+    {
+    }
+};
+
+class Reader
+{
+   public:
+    Reader(const uint8_t* data, size_t size) : data(data), size(size)
+    {
+    }
+
+    bool Empty() const
+    {
+        return offset == size;
+    }
+
+    const uint8_t* Bytes(size_t length)
+    {
+        if (length > size - offset)
+            throw MalformedMessage();
+
+        const uint8_t* bytes = data + offset;
+        offset += length;
+        return bytes;
+    }
+
+    uint8_t U8()
+    {
+        return *Bytes(1);
+    }
+
+    uint16_t U16()
+    {
+        const uint8_t* bytes = Bytes(2);
+        return bytes[0] | (bytes[1] << 8);
+    }
+
+    uint32_t U32()
+    {
+        const uint8_t* bytes = Bytes(4);
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24);
+    }
+
+    CPU::Registers Registers()
+    {
+        CPU::Registers registers;
+        registers.PC = U16();
+        registers.SP = U8();
+        registers.A = U8();
+        registers.X = U8();
+        registers.Y = U8();
+        registers.PS = U8();
+        return registers;
+    }
+
+   private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+void PutU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(value);
+    out.push_back(value >> 8);
+}
+
+void PutU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(value >> shift);
+}
+
+void PutRegisters(std::vector<uint8_t>& out, const CPU::Registers& registers)
+{
+    PutU16(out, registers.PC);
+    out.insert(out.end(), {registers.SP, registers.A, registers.X, registers.Y, registers.PS});
+}
+
+void PutError(std::vector<uint8_t>& out, const char* message)
+{
+    const size_t length = std::min<size_t>(std::strlen(message), UINT16_MAX);
+    out.push_back(kError);
+    PutU16(out, length);
+    out.insert(out.end(), message, message + length);
+}
+
+void CheckRange(uint16_t address, uint32_t length)
+{
+    if (address + uint64_t(length) > Mem::max_size)
+        throw std::invalid_argument("Range exceeds the address space");
+}
+
+sockaddr_un SocketAddress(const std::string& path)
+{
+    sockaddr_un address = {};
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Invalid socket path: " + path);
+
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return address;
+}
+
+std::system_error SystemError(const std::string& what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+}  // namespace
+
+SessionServer::SessionServer(const ServerConfig& config)
+    : config(config),
+      instances(ArenaConfig{config.max_resident ? config.max_resident : config.max_sessions}),
+      pool(config.threads)
+{
+    try
+    {
+        epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll < 0)
+            throw SystemError("Unable to create the event loop");
+
+        wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = wakeup_id;
+        if (wakeup < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &event) != 0)
+            throw SystemError("Unable to create the event loop");
+
+        if (!config.socket_path.empty())
+        {
+            const sockaddr_un address = SocketAddress(config.socket_path);
+            listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listener < 0)
+                throw SystemError("Unable to create the socket");
+
+            unlink(config.socket_path.c_str());
+            if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+                listen(listener, SOMAXCONN) != 0)
+                throw SystemError("Unable to listen on " + config.socket_path);
+
+            event.data.u64 = listener_id;
+            if (epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) != 0)
+                throw SystemError("Unable to create the event loop");
+        }
+    }
+    catch (...)
+    {
+        for (int fd : {listener, wakeup, epoll})
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+        throw;
+    }
+}
+
+SessionServer::~SessionServer()
+{
+    // Workers still signal the wakeup descriptor when they finish.
+    pool.Wait();
+
+    for (auto& [id, connection] : connections)
+        close(connection.fd);
+
+    if (listener >= 0)
+    {
+        close(listener);
+        unlink(config.socket_path.c_str());
+    }
+
+    close(wakeup);
+    close(epoll);
+}
+
+std::vector<uint8_t> SessionServer::Handle(const uint8_t* request, size_t length)
+{
+    Reader reader(request, length);
+    std::vector<uint8_t> response;
+
+    // Runs function on the instance of a session while holding its lock.
+    auto with_session = [this](uint32_t id, auto function)
+    {
+        std::shared_ptr<Session> session = Find(id);
+        std::lock_guard<std::mutex> lock(session->mutex);
+        if (!session->instance && session->snapshot.empty())
+            throw std::invalid_argument("Unknown session");
+        if (!session->instance)
+            Wake(*session);
+
+        session->last_used = Clock::now();
+        function(*session->instance);
+    };
+
+    while (!reader.Empty())
+    {
+        const size_t start = response.size();
+        response.push_back(kOk);
+
+        // Arguments are decoded before anything can fail, so the next operation is found
+        // whatever happens to this one.
+        try
+        {
+            const uint8_t opcode = reader.U8();
+            const uint32_t id = (opcode == kCreate) ? 0 : reader.U32();
+
+            switch (opcode)
+            {
+                case kCreate:
+                    PutU32(response, Create());
+                    break;
+
+                case kDestroy:
+                    Destroy(id);
+                    break;
+
+                case kReset:
+                    with_session(id, [](InstancePool::Instance& instance)
+                                 { instance.cpu.Reset(instance.memory); });
+                    break;
+
+                case kWrite:
+                {
+                    const uint16_t address = reader.U16();
+                    const uint32_t size = reader.U32();
+                    const uint8_t* bytes = reader.Bytes(size);
+                    CheckRange(address, size);
+                    with_session(id, [&](InstancePool::Instance& instance)
+                                 { instance.memory.Load(address, bytes, size); });
+                    break;
+                }
+
+                case kRead:
+                {
+                    const uint16_t address = reader.U16();
+                    const uint32_t size = reader.U32();
+                    CheckRange(address, size);
+                    with_session(id,
+                                 [&](InstancePool::Instance& instance)
+                                 {
+                                     PutU32(response, size);
+                                     const size_t offset = response.size();
+                                     response.resize(offset + size);
+                                     instance.memory.Dump(address, response.data() + offset, size);
+                                 });
+                    break;
+                }
+
+                case kRun:
+                {
+                    const uint32_t cycles = reader.U32();
+                    with_session(id,
+                                 [&](InstancePool::Instance& instance)
+                                 {
+                                     const uint32_t used =
+                                         instance.cpu.Execute(cycles, instance.memory);
+                                     PutU32(response, used);
+                                 });
+                    break;
+                }
+
+                case kGetRegisters:
+                    with_session(id, [&](InstancePool::Instance& instance)
+                                 { PutRegisters(response, instance.cpu.GetRegisters()); });
+                    break;
+
+                case kSetRegisters:
+                {
+                    const CPU::Registers registers = reader.Registers();
+                    with_session(id, [&](InstancePool::Instance& instance)
+                                 { instance.cpu.SetRegisters(registers); });
+                    break;
+                }
+
+                default:
+                    throw MalformedMessage();
+            }
+        }
+        catch (const MalformedMessage& e)
+        {
+            response.resize(start);
+            PutError(response, e.what());
+            break;
+        }
+        catch (const std::exception& e)
+        {
+            response.resize(start);
+            PutError(response, e.what());
+        }
+    }
+
+    return response;
+}
+
+void SessionServer::Serve()
+{
+    epoll_event events[64];
+    const bool hibernate = config.hibernate_after.count() > 0;
+    Clock::time_point sweep = Clock::now() + config.hibernate_after;
+
+    while (!stopping)
+    {
+        int timeout = -1;
+        if (hibernate)
+        {
+            if (Clock::now() >= sweep)
+            {
+                HibernateIdle(config.hibernate_after);
+                sweep = Clock::now() + std::max(config.hibernate_after / 2,
+                                                std::chrono::milliseconds(1));
+            }
+
+            timeout = std::chrono::ceil<std::chrono::milliseconds>(sweep - Clock::now()).count();
+        }
+
+        const int count = epoll_wait(epoll, events, 64, timeout);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw SystemError("Unable to wait for events");
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            const uint64_t id = events[i].data.u64;
+            if (id == listener_id)
+                Accept();
+            else if (id == wakeup_id)
+                Complete();
+            else if (events[i].events & (EPOLLHUP | EPOLLERR))
+            {
+                // Reported even while reads are paused. The client is gone, so a response in
+                // flight has nowhere to go either.
+                Close(id);
+            }
+            else
+            {
+                // An earlier event of this batch may have closed the connection, the lookups
+                // in Flush and Receive skip it.
+                if (events[i].events & EPOLLOUT)
+                    Flush(id);
+                if (events[i].events & EPOLLIN)
+                    Receive(id);
+            }
+        }
+    }
+
+    pool.Wait();
+}
+
+// Async-signal-safe, so it leaves errno as it was. The write only fails when the eventfd counter
+// is saturated, and then the loop is woken anyway.
+void SessionServer::Stop() noexcept
+{
+    const int saved_errno = errno;
+    stopping = true;
+
+    const uint64_t one = 1;
+    write(wakeup, &one, sizeof(one));
+    errno = saved_errno;
+}
+
+size_t SessionServer::Sessions() const
+{
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    return sessions.size();
+}
+
+std::shared_ptr<SessionServer::Session> SessionServer::Find(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    auto it = sessions.find(id);
+    if (it == sessions.end())
+        throw std::invalid_argument("Unknown session");
+
+    return it->second;
+}
+
+uint32_t SessionServer::Create()
+{
+    std::unique_lock<std::mutex> lock(sessions_mutex);
+    if (sessions.size() >= config.max_sessions)
+        throw std::runtime_error("Too many sessions");
+
+    // Hibernating a session for the instance drops the lock, others may have been created.
+    InstancePool::Instance* instance = AcquireInstance(lock, nullptr);
+    if (sessions.size() >= config.max_sessions)
+    {
+        instances.Release(instance);
+        throw std::runtime_error("Too many sessions");
+    }
+
+    // Ids are not reused until they wrap around, 0 is never valid.
+    while (next_session == 0 || sessions.count(next_session))
+        next_session++;
+
+    auto session = std::make_shared<Session>();
+    session->instance = instance;
+    session->last_used = Clock::now();
+    sessions.emplace(next_session, session);
+    return next_session++;
+}
+
+void SessionServer::Destroy(uint32_t id)
+{
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        auto it = sessions.find(id);
+        if (it == sessions.end())
+            throw std::invalid_argument("Unknown session");
+
+        session = std::move(it->second);
+        sessions.erase(it);
+    }
+
+    // Waits for operations that found the session before it was removed.
+    std::lock_guard<std::mutex> session_lock(session->mutex);
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    if (session->instance)
+        instances.Release(session->instance);
+    hibernated_bytes -= session->snapshot.size();
+    session->instance = nullptr;
+    session->snapshot = {};
+}
+
+bool SessionServer::Hibernate(uint32_t id)
+{
+    std::shared_ptr<Session> session = Find(id);
+    std::lock_guard<std::mutex> lock(session->mutex);
+    if (!session->instance && session->snapshot.empty())
+        throw std::invalid_argument("Unknown session");
+    if (!session->instance)
+        return false;
+
+    Suspend(*session);
+    return true;
+}
+
+size_t SessionServer::HibernateIdle(std::chrono::milliseconds idle)
+{
+    std::vector<std::shared_ptr<Session>> candidates;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        for (const auto& [id, session] : sessions)
+            candidates.push_back(session);
+    }
+
+    const Clock::time_point now = Clock::now();
+    size_t count = 0;
+    for (const std::shared_ptr<Session>& session : candidates)
+    {
+        std::unique_lock<std::mutex> lock(session->mutex, std::try_to_lock);
+        if (!lock || !session->instance || now - session->last_used < idle)
+            continue;
+
+        Suspend(*session);
+        count++;
+    }
+
+    return count;
+}
+
+size_t SessionServer::Resident() const
+{
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    return instances.Live();
+}
+
+size_t SessionServer::HibernatedBytes() const
+{
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    return hibernated_bytes;
+}
+
+void SessionServer::Wake(Session& session)
+{
+    {
+        std::unique_lock<std::mutex> lock(sessions_mutex);
+        session.instance = AcquireInstance(lock, &session);
+        hibernated_bytes -= session.snapshot.size();
+    }
+
+    // The instance belongs to the session now, the decompression runs without the global lock.
+    codec.Decompress(session.snapshot, session.instance->cpu, session.instance->memory);
+    session.snapshot = {};
+}
+
+void SessionServer::Suspend(Session& session)
+{
+    std::vector<uint8_t> snapshot =
+        codec.Compress(session.instance->cpu, session.instance->memory);
+
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    Release(session, std::move(snapshot));
+}
+
+void SessionServer::Release(Session& session, std::vector<uint8_t> snapshot)
+{
+    snapshot.shrink_to_fit();
+    hibernated_bytes += snapshot.size();
+    session.snapshot = std::move(snapshot);
+    instances.Release(session.instance, true);
+    session.instance = nullptr;
+}
+
+InstancePool::Instance* SessionServer::AcquireInstance(std::unique_lock<std::mutex>& lock,
+                                                       const Session* waking)
+{
+    if (instances.Live() < instances.Capacity())
+        return instances.Acquire();
+
+    // The waking session is locked by the caller and skipped, as are sessions in use.
+    std::shared_ptr<Session> oldest;
+    std::unique_lock<std::mutex> oldest_lock;
+    for (const auto& [id, session] : sessions)
+    {
+        if (session.get() == waking)
+            continue;
+
+        std::unique_lock<std::mutex> session_lock(session->mutex, std::try_to_lock);
+        if (!session_lock || !session->instance ||
+            (oldest && oldest->last_used <= session->last_used))
+            continue;
+
+        oldest = session;
+        oldest_lock = std::move(session_lock);
+    }
+
+    if (!oldest)
+        throw std::runtime_error("Too many sessions");
+
+    // The evicted session stays locked, so its instance is compressed without the global lock.
+    lock.unlock();
+    std::vector<uint8_t> snapshot =
+        codec.Compress(oldest->instance->cpu, oldest->instance->memory);
+    lock.lock();
+
+    Release(*oldest, std::move(snapshot));
+    return instances.Acquire();
+}
+
+void SessionServer::Accept()
+{
+    while (true)
+    {
+        const int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        const uint64_t id = next_connection++;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            continue;
+        }
+
+        Connection& connection = connections[id];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+    }
+}
+
+void SessionServer::Receive(uint64_t id)
+{
+    auto it = connections.find(id);
+    if (it == connections.end())
+        return;
+
+    Connection& connection = it->second;
+
+    // Drops the dispatched frames once they are half of the buffer, so pipelined frames cost
+    // linear time.
+    if (connection.consumed > connection.input.size() / 2)
+    {
+        connection.input.erase(connection.input.begin(),
+                               connection.input.begin() + connection.consumed);
+        connection.consumed = 0;
+    }
+
+    // Enough for a whole frame behind a partial one. Reads are paused beyond it and while a
+    // request is in flight, so a client that pipelines without reading its responses is held
+    // back by the socket buffers instead of growing this one.
+    const size_t limit = 2 * (size_t{config.max_frame} + 4);
+    uint8_t buffer[64 * 1024];
+    while (connection.input.size() - connection.consumed < limit)
+    {
+        const ssize_t length = read(connection.fd, buffer, sizeof(buffer));
+        if (length > 0)
+        {
+            connection.input.insert(connection.input.end(), buffer, buffer + length);
+            continue;
+        }
+
+        if (length < 0 && errno == EINTR)
+            continue;
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        // Closed by the client or broken.
+        Close(id);
+        return;
+    }
+
+    Dispatch(id);
+}
+
+// Hands the next complete frame of an idle connection to the workers.
+void SessionServer::Dispatch(uint64_t id)
+{
+    auto it = connections.find(id);
+    if (it == connections.end())
+        return;
+
+    Connection& connection = it->second;
+    const uint8_t* frame = connection.input.data() + connection.consumed;
+    const size_t available = connection.input.size() - connection.consumed;
+    if (connection.busy || !connection.output.empty() || available < 4)
+    {
+        Watch(id);
+        return;
+    }
+
+    Reader header(frame, 4);
+    const uint32_t length = header.U32();
+    if (length > config.max_frame)
+    {
+        Close(id);
+        return;
+    }
+
+    if (available - 4 < length)
+    {
+        Watch(id);
+        return;
+    }
+
+    std::vector<uint8_t> request(frame + 4, frame + 4 + length);
+    connection.consumed += 4 + length;
+    if (connection.consumed == connection.input.size())
+    {
+        connection.input.clear();
+        connection.consumed = 0;
+    }
+
+    connection.busy = true;
+    Watch(id);
+
+    pool.Submit(
+        [this, id, request = std::move(request)]
+        {
+            std::vector<uint8_t> response = Handle(request.data(), request.size());
+            {
+                std::lock_guard<std::mutex> lock(completed_mutex);
+                completed.emplace_back(id, std::move(response));
+            }
+
+            const uint64_t one = 1;
+            write(wakeup, &one, sizeof(one));
+        });
+}
+
+void SessionServer::Flush(uint64_t id)
+{
+    auto it = connections.find(id);
+    if (it == connections.end())
+        return;
+
+    Connection& connection = it->second;
+    while (connection.written < connection.output.size())
+    {
+        const ssize_t length = send(connection.fd, connection.output.data() + connection.written,
+                                    connection.output.size() - connection.written, MSG_NOSIGNAL);
+        if (length >= 0)
+        {
+            connection.written += length;
+            continue;
+        }
+
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            Watch(id);
+            return;
+        }
+
+        Close(id);
+        return;
+    }
+
+    connection.output.clear();
+    connection.written = 0;
+
+    // Requests pipelined behind the finished one, reads resume when there are none.
+    Dispatch(id);
+}
+
+void SessionServer::Complete()
+{
+    uint64_t count;
+    if (read(wakeup, &count, sizeof(count)) < 0)
+        return;
+
+    std::vector<std::pair<uint64_t, std::vector<uint8_t>>> responses;
+    {
+        std::lock_guard<std::mutex> lock(completed_mutex);
+        responses.swap(completed);
+    }
+
+    for (auto& [id, response] : responses)
+    {
+        auto it = connections.find(id);
+        if (it == connections.end())
+            continue;
+
+        Connection& connection = it->second;
+        connection.busy = false;
+        connection.output.clear();
+        PutU32(connection.output, response.size());
+        connection.output.insert(connection.output.end(), response.begin(), response.end());
+        Flush(id);
+    }
+}
+
+void SessionServer::Close(uint64_t id)
+{
+    auto it = connections.find(id);
+    if (it == connections.end())
+        return;
+
+    close(it->second.fd);
+    connections.erase(it);
+}
+
+// Requests the events the connection is waiting for: input while it is idle, output while a
+// response is unsent.
+void SessionServer::Watch(uint64_t id)
+{
+    Connection& connection = connections.at(id);
+    const size_t limit = 2 * (size_t{config.max_frame} + 4);
+
+    uint32_t events = 0;
+    if (!connection.busy && connection.output.empty() &&
+        connection.input.size() - connection.consumed < limit)
+        events |= EPOLLIN;
+    if (connection.written < connection.output.size())
+        events |= EPOLLOUT;
+
+    if (connection.events == events)
+        return;
+
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event) != 0)
+    {
+        Close(id);
+        return;
+    }
+
+    connection.events = events;
+}
+
+void SessionRequest::Create()
+{
+    payload.push_back(kCreate);
+    operations.push_back(kCreate);
+}
+
+void SessionRequest::Destroy(uint32_t session)
+{
+    Begin(kDestroy, session);
+}
+
+void SessionRequest::Reset(uint32_t session)
+{
+    Begin(kReset, session);
+}
+
+void SessionRequest::Write(uint32_t session, uint16_t address, const std::vector<uint8_t>& bytes)
+{
+    Begin(kWrite, session);
+    PutU16(payload, address);
+    PutU32(payload, bytes.size());
+    payload.insert(payload.end(), bytes.begin(), bytes.end());
+}
+
+void SessionRequest::Read(uint32_t session, uint16_t address, uint32_t length)
+{
+    Begin(kRead, session);
+    PutU16(payload, address);
+    PutU32(payload, length);
+}
+
+void SessionRequest::Run(uint32_t session, uint32_t cycles)
+{
+    Begin(kRun, session);
+    PutU32(payload, cycles);
+}
+
+void SessionRequest::GetRegisters(uint32_t session)
+{
+    Begin(kGetRegisters, session);
+}
+
+void SessionRequest::SetRegisters(uint32_t session, const CPU::Registers& registers)
+{
+    Begin(kSetRegisters, session);
+    PutRegisters(payload, registers);
+}
+
+const std::vector<uint8_t>& SessionRequest::Payload() const
+{
+    return payload;
+}
+
+const std::vector<Opcode>& SessionRequest::Operations() const
+{
+    return operations;
+}
+
+void SessionRequest::Begin(Opcode opcode, uint32_t session)
+{
+    payload.push_back(opcode);
+    PutU32(payload, session);
+    operations.push_back(opcode);
+}
+
+SessionResponse::SessionResponse(const SessionRequest& request,
+                                 const std::vector<uint8_t>& payload)
+{
+    Reader reader(payload.data(), payload.size());
+
+    try
+    {
+        for (Opcode opcode : request.Operations())
+        {
+            // The server stops after an operation it could not decode.
+            if (reader.Empty() && !results.empty() && !results.back().ok)
+                break;
+
+            Result& result = results.emplace_back();
+            if (reader.U8() != kOk)
+            {
+                const uint16_t length = reader.U16();
+                const uint8_t* message = reader.Bytes(length);
+                result.error.assign(message, message + length);
+                continue;
+            }
+
+            result.ok = true;
+            if (opcode == kCreate)
+                result.session = reader.U32();
+            else if (opcode == kRun)
+                result.cycles = reader.U32();
+            else if (opcode == kGetRegisters)
+                result.registers = reader.Registers();
+            else if (opcode == kRead)
+            {
+                const uint32_t length = reader.U32();
+                const uint8_t* bytes = reader.Bytes(length);
+                result.bytes.assign(bytes, bytes + length);
+            }
+        }
+    }
+    catch (const MalformedMessage&)
+    {
+        throw std::invalid_argument("Response does not match the request");
+    }
+
+    if (!reader.Empty())
+        throw std::invalid_argument("Response does not match the request");
+}
+
+const std::vector<SessionResponse::Result>& SessionResponse::Results() const
+{
+    return results;
+}
+
+const SessionResponse::Result& SessionResponse::operator[](size_t index) const
+{
+    return results.at(index);
+}
+
+SessionClient::SessionClient(const std::string& socket_path)
+{
+    const sockaddr_un address = SocketAddress(socket_path);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw SystemError("Unable to create the socket");
+
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        const std::system_error error = SystemError("Unable to connect to " + socket_path);
+        close(fd);
+        throw error;
+    }
+}
+
+SessionClient::~SessionClient()
+{
+    close(fd);
+}
+
+SessionResponse SessionClient::Call(const SessionRequest& request)
+{
+    std::vector<uint8_t> frame;
+    PutU32(frame, request.Payload().size());
+    frame.insert(frame.end(), request.Payload().begin(), request.Payload().end());
+
+    for (size_t sent = 0; sent < frame.size();)
+    {
+        const ssize_t length = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (length < 0 && errno != EINTR)
+            throw SystemError("Unable to send the request");
+        sent += std::max<ssize_t>(length, 0);
+    }
+
+    auto receive = [this](uint8_t* bytes, size_t size)
+    {
+        for (size_t received = 0; received < size;)
+        {
+            const ssize_t length = recv(fd, bytes + received, size - received, 0);
+            if (length == 0)
+                throw std::runtime_error("Connection closed by the server");
+            if (length < 0 && errno != EINTR)
+                throw SystemError("Unable to receive the response");
+            received += std::max<ssize_t>(length, 0);
+        }
+    };
+
+    uint8_t header[4];
+    receive(header, sizeof(header));
+    std::vector<uint8_t> payload(Reader(header, sizeof(header)).U32());
+    receive(payload.data(), payload.size());
+
+    return SessionResponse(request, payload);
+}
@@ -0,0 +1,436 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "snapshot_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "save_state.h"
+
+namespace
+{
+// Header layout, all integers little-endian.
+const size_t magic_offset = 0;
+const size_t version_offset = 4;
+const size_t fingerprint_offset = 8;
+const size_t cpu_state_offset = 16;
+const size_t header_size = cpu_state_offset + SaveState::cpu_state_size;
+
+const size_t min_match = 4;
+const int hash_bits = 14;
+
+class MalformedSnapshot : public std::invalid_argument
+{
+   public:
+    MalformedSnapshot() : std::invalid_argument("Malformed compressed snapshot")
+    {
+    }
+};
+
+class Reader
+{
+   public:
+    Reader(const uint8_t* data, size_t size) : data(data), size(size)
+    {
+    }
+
+    bool Empty() const
+    {
+        return offset == size;
+    }
+
+    const uint8_t* Bytes(size_t length)
+    {
+        if (length > size - offset)
+            throw MalformedSnapshot();
+
+        const uint8_t* bytes = data + offset;
+        offset += length;
+        return bytes;
+    }
+
+    uint8_t U8()
+    {
+        return *Bytes(1);
+    }
+
+    uint16_t U16()
+    {
+        const uint8_t* bytes = Bytes(2);
+        return bytes[0] | (bytes[1] << 8);
+    }
+
+    // A length nibble of 15 continues in bytes up to the first one below 255.
+    size_t Length(size_t nibble)
+    {
+        if (nibble < 15)
+            return nibble;
+
+        size_t length = nibble;
+        uint8_t byte;
+        do
+        {
+            byte = U8();
+            length += byte;
+        } while (byte == 255);
+        return length;
+    }
+
+   private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+void Put(uint8_t* out, uint64_t value, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        out[i] = value >> (8 * i);
+}
+
+uint64_t Get(const uint8_t* in, size_t length)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; i++)
+        value |= uint64_t(in[i]) << (8 * i);
+    return value;
+}
+
+uint64_t Load64(const uint8_t* bytes)
+{
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+uint32_t Load32(const uint8_t* bytes)
+{
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+uint64_t HashPage(const uint8_t* page)
+{
+    uint64_t hash = 0;
+    for (size_t i = 0; i < Mem::page_size; i += 8)
+    {
+        hash = (hash ^ Load64(page + i)) * 0x9E3779B97F4A7C15;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+bool IsZeroPage(const uint8_t* page)
+{
+    uint64_t bits = 0;
+    for (size_t i = 0; i < Mem::page_size; i += 8)
+        bits |= Load64(page + i);
+    return bits == 0;
+}
+
+void PutLength(std::vector<uint8_t>& out, size_t length)
+{
+    if (length < 15)
+        return;
+
+    for (length -= 15; length >= 255; length -= 255)
+        out.push_back(255);
+    out.push_back(length);
+}
+
+void PutLiterals(std::vector<uint8_t>& out, const uint8_t* literals, size_t length,
+                 uint8_t match_nibble)
+{
+    out.push_back(std::min<size_t>(length, 15) << 4 | match_nibble);
+    PutLength(out, length);
+    out.insert(out.end(), literals, literals + length);
+}
+
+// Greedy matching against the last position of every hashed 4-byte sequence. Runs of misses
+// step further ahead, up to 16 bytes, so incompressible data passes quickly.
+void CompressBlock(const uint8_t* in, size_t size, std::vector<uint8_t>& out)
+{
+    std::vector<uint32_t> table(1 << hash_bits);  // Position plus one, 0 when empty.
+    size_t anchor = 0;
+    size_t position = 0;
+    while (position + min_match <= size)
+    {
+        const uint32_t sequence = Load32(in + position);
+        uint32_t& entry = table[(sequence * 2654435761u) >> (32 - hash_bits)];
+        const size_t candidate = entry - 1;
+        const bool found = entry && position - candidate <= SnapshotCodec::window &&
+                           Load32(in + candidate) == sequence;
+        entry = position + 1;
+        if (!found)
+        {
+            position += 1 + std::min<size_t>((position - anchor) >> 6, 15);
+            continue;
+        }
+
+        size_t length = min_match;
+        while (position + length < size && in[candidate + length] == in[position + length])
+            length++;
+
+        const size_t match = length - min_match;
+        PutLiterals(out, in + anchor, position - anchor, std::min<size_t>(match, 15));
+        out.push_back(position - candidate);
+        out.push_back((position - candidate) >> 8);
+        PutLength(out, match);
+
+        position += length;
+        anchor = position;
+    }
+
+    if (anchor < size)
+        PutLiterals(out, in + anchor, size - anchor, 0);
+}
+
+// Receives the decoded stream of stored pages and loads every completed page into memory.
+// Only the window before the current position is kept for matches.
+class PageWriter
+{
+   public:
+    PageWriter(const std::vector<uint16_t>& addresses, Mem& memory)
+        : addresses(addresses),
+          memory(memory),
+          buffer(2 * SnapshotCodec::window),
+          total(addresses.size() * Mem::page_size)
+    {
+    }
+
+    size_t Remaining() const
+    {
+        return total - produced;
+    }
+
+    void Literals(const uint8_t* bytes, size_t length)
+    {
+        while (length)
+        {
+            const size_t count = std::min(length, Room());
+            std::memcpy(&buffer[position], bytes, count);
+            Advance(count);
+            bytes += count;
+            length -= count;
+        }
+    }
+
+    void Match(size_t offset, size_t length)
+    {
+        if (offset == 0 || offset > SnapshotCodec::window || offset > produced)
+            throw MalformedSnapshot();
+
+        while (length)
+        {
+            const size_t count = std::min(length, Room());
+            uint8_t* out = &buffer[position];
+            const uint8_t* from = out - offset;
+            if (offset >= count)
+                std::memcpy(out, from, count);
+            else if (offset == 1)
+                std::memset(out, *from, count);
+            else
+                for (size_t i = 0; i < count; i++)
+                    out[i] = from[i];
+
+            Advance(count);
+            length -= count;
+        }
+    }
+
+   private:
+    // Slides the window to the front when the buffer is full.
+    size_t Room()
+    {
+        if (position == buffer.size())
+        {
+            const size_t shift = position - SnapshotCodec::window;
+            std::memmove(buffer.data(), buffer.data() + shift, SnapshotCodec::window);
+            position -= shift;
+            flushed -= shift;
+        }
+
+        return buffer.size() - position;
+    }
+
+    void Advance(size_t count)
+    {
+        position += count;
+        produced += count;
+        for (; position - flushed >= Mem::page_size; flushed += Mem::page_size)
+        {
+            const uint16_t address = addresses[page++];
+            if (!memory.IsReadOnly(address))
+                memory.Load(address, &buffer[flushed], Mem::page_size);
+        }
+    }
+
+    const std::vector<uint16_t>& addresses;
+    Mem& memory;
+    std::vector<uint8_t> buffer;
+    size_t position = 0;
+    size_t flushed = 0;
+    size_t page = 0;
+    size_t produced = 0;
+    size_t total;
+};
+}  // namespace
+
+const uint32_t SnapshotCodec::magic;
+const uint16_t SnapshotCodec::version;
+const size_t SnapshotCodec::window;
+
+SnapshotCodec::SnapshotCodec() = default;
+
+SnapshotCodec::SnapshotCodec(Mem::View reference) : reference(reference.begin(), reference.end())
+{
+    if (reference.size() != Mem::max_size)
+        throw std::invalid_argument("Reference image must cover the address space");
+
+    fingerprint = 1;
+    for (uint32_t page = Mem::page_count; page-- > 0;)
+    {
+        const uint64_t hash = HashPage(&this->reference[page * Mem::page_size]);
+        fingerprint = (fingerprint ^ hash) * 0x9E3779B97F4A7C15 | 1;
+        reference_pages[hash] = page;
+    }
+}
+
+std::vector<uint8_t> SnapshotCodec::Compress(const CPU& cpu, const Mem& memory) const
+{
+    std::vector<uint8_t> out(header_size);
+    Put(&out[magic_offset], magic, 4);
+    Put(&out[version_offset], version, 2);
+    Put(&out[fingerprint_offset], fingerprint, 8);
+    SaveState::PutCpuState(cpu.GetState(), &out[cpu_state_offset]);
+
+    const uint8_t* image = memory.Slice(0, Mem::max_size).data();
+    std::vector<uint8_t> stored;
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        const uint8_t* contents = image + page * Mem::page_size;
+        if (IsZeroPage(contents))
+        {
+            out.push_back(kZero);
+            continue;
+        }
+
+        if (!reference.empty())
+        {
+            // The same page first, as that is where loaded ROMs stay.
+            int found = -1;
+            if (std::memcmp(contents, &reference[page * Mem::page_size], Mem::page_size) == 0)
+                found = page;
+
+            auto it = reference_pages.find(HashPage(contents));
+            if (found < 0 && it != reference_pages.end() &&
+                std::memcmp(contents, &reference[it->second * Mem::page_size],
+                            Mem::page_size) == 0)
+                found = it->second;
+
+            if (found >= 0)
+            {
+                out.push_back(kReference);
+                out.push_back(found);
+                continue;
+            }
+        }
+
+        out.push_back(kStored);
+        stored.insert(stored.end(), contents, contents + Mem::page_size);
+    }
+
+    CompressBlock(stored.data(), stored.size(), out);
+    return out;
+}
+
+void SnapshotCodec::Decompress(const uint8_t* bytes, size_t length, CPU& cpu,
+                               Mem& memory) const
+{
+    if (length < header_size || Get(bytes + magic_offset, 4) != magic)
+        throw std::invalid_argument("Not a compressed snapshot");
+    if (Get(bytes + version_offset, 2) != version)
+        throw std::invalid_argument("Unsupported compressed snapshot version");
+    if (Get(bytes + fingerprint_offset, 8) != fingerprint)
+        throw std::invalid_argument("Compressed snapshot of another reference image");
+
+    Reader reader(bytes + header_size, length - header_size);
+    std::vector<uint16_t> stored;
+    for (uint32_t page = 0; page < Mem::page_count; page++)
+    {
+        const uint16_t address = page * Mem::page_size;
+        const uint8_t kind = reader.U8();
+        if (kind == kStored)
+        {
+            stored.push_back(address);
+            continue;
+        }
+
+        const uint8_t* contents = nullptr;
+        if (kind == kReference && !reference.empty())
+            contents = &reference[reader.U8() * Mem::page_size];
+        else if (kind != kZero)
+            throw MalformedSnapshot();
+
+        if (memory.IsReadOnly(address))
+            continue;
+        if (contents)
+            memory.Load(address, contents, Mem::page_size);
+        else
+            memory.Fill(address, Mem::page_size, 0);
+    }
+
+    PageWriter writer(stored, memory);
+    while (writer.Remaining())
+    {
+        const uint8_t token = reader.U8();
+        const size_t literals = reader.Length(token >> 4);
+        if (literals > writer.Remaining())
+            throw MalformedSnapshot();
+
+        writer.Literals(reader.Bytes(literals), literals);
+        if (!writer.Remaining())
+            break;
+
+        const size_t offset = reader.U16();
+        const size_t match = reader.Length(token & 0x0F) + min_match;
+        if (match > writer.Remaining())
+            throw MalformedSnapshot();
+
+        writer.Match(offset, match);
+    }
+
+    if (!reader.Empty())
+        throw MalformedSnapshot();
+
+    cpu.SetState(SaveState::GetCpuState(bytes + cpu_state_offset));
+}
+
+void SnapshotCodec::Decompress(const std::vector<uint8_t>& bytes, CPU& cpu, Mem& memory) const
+{
+    Decompress(bytes.data(), bytes.size(), cpu, memory);
+}
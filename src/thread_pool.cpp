@@ -0,0 +1,223 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace
+{
+// The pool and worker index of the calling thread.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+// Tasks of current_pool running on the calling thread, nested through Wait.
+thread_local size_t running_tasks = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < threads; i++)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (unsigned i = 0; i < threads; i++)
+        this->threads.emplace_back(&ThreadPool::Run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    work_available.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::Submit(Task task)
+{
+    const int self = CurrentWorker();
+    const unsigned index = self >= 0 ? self : next_worker++ % workers.size();
+
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders the increment with a worker about to sleep.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+    }
+    work_available.notify_one();
+}
+
+void ThreadPool::Submit(Task task, Group& group)
+{
+    group.pending++;
+    Submit(
+        [this, task = std::move(task), &group]
+        {
+            task();
+
+            // The waiter may destroy the group as soon as the count drops.
+            if (--group.pending == 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                all_done.notify_all();
+            }
+        });
+}
+
+void ThreadPool::Wait()
+{
+    // A worker waiting on its own pool helps out instead of blocking a thread. The tasks it is
+    // in the middle of stay pending until it returns to them.
+    const int self = CurrentWorker();
+    if (self >= 0)
+    {
+        while (pending > running_tasks)
+        {
+            if (!TryRun(self))
+                std::this_thread::yield();
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPool::Wait(Group& group)
+{
+    const int self = CurrentWorker();
+    if (self >= 0)
+    {
+        while (group.pending > 0)
+        {
+            if (!TryRun(self))
+                std::this_thread::yield();
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [&group] { return group.pending == 0; });
+}
+
+unsigned ThreadPool::Size() const
+{
+    return workers.size();
+}
+
+int ThreadPool::CurrentWorker() const
+{
+    return current_pool == this ? current_worker : -1;
+}
+
+void ThreadPool::Run(unsigned index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    while (true)
+    {
+        if (TryRun(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_available.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
+
+// Runs the newest task of the own deque, or steals the oldest task of another worker.
+bool ThreadPool::TryRun(unsigned index)
+{
+    Task task;
+    for (unsigned i = 0; i < workers.size() && !task; i++)
+    {
+        Worker& worker = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty())
+            continue;
+
+        if (i == 0)
+        {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    queued--;
+    running_tasks++;
+    task();
+    running_tasks--;
+
+    if (--pending == 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        all_done.notify_all();
+    }
+
+    return true;
+}
+
+void ParallelFor(ThreadPool& pool, uint64_t count, uint64_t grain,
+                 const std::function<void(uint64_t, uint64_t)>& body)
+{
+    if (count == 0)
+        return;
+
+    ThreadPool::Group group;
+    std::function<void(uint64_t, uint64_t)> run_range = [&](uint64_t begin, uint64_t end)
+    {
+        while (end - begin > grain)
+        {
+            const uint64_t middle = begin + (end - begin) / 2;
+            pool.Submit([&run_range, middle, end] { run_range(middle, end); }, group);
+            end = middle;
+        }
+
+        body(begin, end);
+    };
+
+    pool.Submit([&run_range, count] { run_range(0, count); }, group);
+    pool.Wait(group);
+}
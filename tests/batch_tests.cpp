@@ -0,0 +1,250 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "batch.h"
+
+class BatchTests : public ::testing::Test
+{
+   public:
+    ThreadPool pool{4};
+
+    // LDX #0; loop: INX; CPX #10; BNE loop; STX $0300; JMP $C000
+    std::shared_ptr<const std::vector<uint8_t>> program =
+        std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{
+            0xA2, 0x00, 0xE8, 0xE0, 0x0A, 0xD0, 0xFB, 0x8E, 0x00, 0x03, 0x4C, 0x00, 0xC0});
+
+    BatchJob MakeJob(uint8_t x)
+    {
+        BatchJob job;
+        job.image = program;
+        job.load_address = 0x8000;
+        job.registers = CPU::Registers{0x8002, 0xFF, 0x00, x, 0x00, 0x00};
+        job.cycles = 1000;
+        job.stop_addresses = {0xC000};
+        return job;
+    }
+};
+
+TEST_F(BatchTests, ThreadPoolNestedSubmit)
+{
+    std::atomic<int> count{0};
+    for (int i = 0; i < 10; i++)
+    {
+        pool.Submit(
+            [&]
+            {
+                for (int j = 0; j < 10; j++)
+                    pool.Submit([&] { count++; });
+                count++;
+            });
+    }
+
+    pool.Wait();
+
+    EXPECT_EQ(count, 110);
+    EXPECT_EQ(pool.CurrentWorker(), -1);
+}
+
+TEST_F(BatchTests, ThreadPoolWaitInTask)
+{
+    // The waiting task does not wait for itself.
+    std::atomic<int> count{0};
+    pool.Submit(
+        [&]
+        {
+            for (int j = 0; j < 10; j++)
+                pool.Submit([&] { count++; });
+            pool.Wait();
+            EXPECT_EQ(count, 10);
+            count++;
+        });
+
+    pool.Wait();
+    EXPECT_EQ(count, 11);
+}
+
+TEST_F(BatchTests, ParallelFor)
+{
+    std::vector<std::atomic<int>> visits(1000);
+    std::atomic<int> ranges{0};
+    ParallelFor(pool, visits.size(), 7,
+                [&](uint64_t begin, uint64_t end)
+                {
+                    EXPECT_LE(end - begin, 7);
+                    EXPECT_GE(pool.CurrentWorker(), 0);
+                    for (uint64_t i = begin; i < end; i++)
+                        visits[i]++;
+                    ranges++;
+                });
+
+    for (const std::atomic<int>& count : visits)
+        EXPECT_EQ(count, 1);
+    EXPECT_GE(ranges, 1000 / 7);
+
+    ParallelFor(pool, 0, 7, [](uint64_t, uint64_t) { FAIL(); });
+}
+
+TEST_F(BatchTests, NestedBatch)
+{
+    std::vector<BatchJob> jobs;
+    for (uint8_t x = 0; x < 9; x++)
+        jobs.push_back(MakeJob(x));
+
+    // Every batch waits for its own jobs only, the workers running the others help out.
+    std::vector<std::vector<BatchResult>> results(8);
+    ThreadPool::Group group;
+    for (std::vector<BatchResult>& batch : results)
+        pool.Submit([&] { batch = RunBatch(jobs, pool); }, group);
+    pool.Wait(group);
+
+    for (const std::vector<BatchResult>& batch : results)
+    {
+        ASSERT_EQ(batch.size(), jobs.size());
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            EXPECT_TRUE(batch[i].stopped);
+            EXPECT_EQ(batch[i].registers.X, 10);
+        }
+    }
+}
+
+TEST_F(BatchTests, Results)
+{
+    std::vector<BatchJob> jobs;
+    for (uint8_t x = 0; x < 9; x++)
+        jobs.push_back(MakeJob(x));
+
+    std::vector<BatchResult> results = RunBatch(jobs, pool);
+
+    ASSERT_EQ(results.size(), jobs.size());
+    for (uint8_t x = 0; x < 9; x++)
+    {
+        // Every iteration of the loop takes 2 + 2 + 3 cycles, the last one 2 + 2 + 2.
+        const uint32_t iterations = 10 - x;
+        EXPECT_TRUE(results[x].stopped);
+        EXPECT_TRUE(results[x].error.empty());
+        EXPECT_EQ(results[x].registers.PC, 0xC000);
+        EXPECT_EQ(results[x].registers.X, 10);
+        EXPECT_EQ(results[x].cycles, iterations * 7 - 1 + 4 + 3);
+    }
+}
+
+TEST_F(BatchTests, Budget)
+{
+    BatchJob job = MakeJob(0);
+    job.cycles = 7;
+
+    std::vector<BatchResult> results = RunBatch({job}, pool);
+
+    EXPECT_FALSE(results[0].stopped);
+    EXPECT_EQ(results[0].cycles, 7);
+    EXPECT_EQ(results[0].registers.PC, 0x8002);
+    EXPECT_EQ(results[0].registers.X, 1);
+}
+
+TEST_F(BatchTests, ResetVector)
+{
+    // LDA #$42 at 0xFFF0 and a reset vector pointing to it.
+    std::vector<uint8_t> image(0x10, 0xEA);
+    image[0x0] = 0xA9;
+    image[0x1] = 0x42;
+    image[0xC] = 0xF0;
+    image[0xD] = 0xFF;
+
+    BatchJob job;
+    job.image = std::make_shared<const std::vector<uint8_t>>(image);
+    job.load_address = 0xFFF0;
+    job.cycles = 2;
+
+    std::vector<BatchResult> results = RunBatch({job}, pool);
+
+    EXPECT_EQ(results[0].registers.PC, 0xFFF2);
+    EXPECT_EQ(results[0].registers.A, 0x42);
+    EXPECT_EQ(results[0].cycles, 2);
+}
+
+TEST_F(BatchTests, Error)
+{
+    BatchJob job = MakeJob(0);
+    job.image = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{0x02});
+    job.registers->PC = 0x8000;
+
+    std::vector<BatchResult> results = RunBatch({job}, pool);
+
+    EXPECT_FALSE(results[0].error.empty());
+}
+
+TEST_F(BatchTests, ImageTooLarge)
+{
+    // The image runs past 0xFFFF, the other jobs are not affected.
+    std::vector<BatchJob> jobs(8, MakeJob(0));
+    jobs[3].load_address = 0xFFF8;
+
+    std::vector<BatchResult> results = RunBatch(jobs, pool);
+
+    EXPECT_EQ(results[3].error, "Range exceeds the address space");
+    EXPECT_EQ(results[3].cycles, 0);
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (i != 3)
+        {
+            EXPECT_TRUE(results[i].stopped) << i;
+        }
+    }
+}
+
+TEST_F(BatchTests, InspectorError)
+{
+    std::vector<BatchJob> jobs(6, MakeJob(5));
+
+    std::vector<BatchResult> results =
+        RunBatch(jobs, pool,
+                 [](size_t job, const CPU&, const Mem&)
+                 {
+                     if (job == 2)
+                         throw std::runtime_error("Inspection failed");
+                 });
+
+    EXPECT_EQ(results[2].error, "Inspection failed");
+    EXPECT_TRUE(results[2].stopped);
+    EXPECT_TRUE(results[1].error.empty());
+}
+
+TEST_F(BatchTests, Inspect)
+{
+    std::vector<BatchJob> jobs(20, MakeJob(5));
+    std::vector<uint8_t> stored(jobs.size());
+
+    RunBatch(jobs, pool,
+             [&](size_t job, const CPU&, const Mem& memory) { stored[job] = memory[0x0300]; });
+
+    EXPECT_EQ(stored, std::vector<uint8_t>(jobs.size(), 10));
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "board.h"
+
+class BoardTests : public ::testing::Test
+{
+   public:
+    BoardConfig config;
+
+    // loop: INC $0200; LDA $0200; STA $0300; JMP loop
+    const std::vector<uint8_t> counter = {0xEE, 0x00, 0x02, 0xAD, 0x00, 0x02,
+                                          0x8D, 0x00, 0x03, 0x4C, 0x00, 0x80};
+
+    void SetUp() override
+    {
+        config.shared = {{0x0200, 0x0300}};
+        config.quantum = 100;
+    }
+
+    void Load(Board& board, size_t index, const std::vector<uint8_t>& program)
+    {
+        board.Memory(index).Load(0x8000, program);
+        board.Processor(index).SetRegisters(CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+    }
+};
+
+TEST_F(BoardTests, SharedWriteAtSynchronization)
+{
+    Board board(config);
+
+    // LDA #$42; STA $0200; done: JMP done
+    Load(board, 0, {0xA9, 0x42, 0x8D, 0x00, 0x02, 0x4C, 0x05, 0x80});
+
+    // loop: LDA $0200; BEQ loop; STA $0300; done: JMP done
+    Load(board, 1, {0xAD, 0x00, 0x02, 0xF0, 0xFB, 0x8D, 0x00, 0x03, 0x4C, 0x08, 0x80});
+
+    board.Run(50);
+    EXPECT_EQ(board.rounds, 1);
+    EXPECT_EQ(board.Memory(1)[0x0200], 0x42);
+    EXPECT_EQ(board.Memory(1)[0x0300], 0x00);
+
+    board.Run(50);
+    EXPECT_EQ(board.Memory(1)[0x0300], 0x42);
+    EXPECT_EQ(board.Memory(0)[0x0300], 0x00);
+    EXPECT_GE(board.Cycles(0), 100);
+    EXPECT_GE(board.Cycles(1), 100);
+}
+
+TEST_F(BoardTests, ConflictingWrites)
+{
+    Board board(config);
+
+    // LDA #id; STA $0200; done: JMP done
+    Load(board, 0, {0xA9, 0x01, 0x8D, 0x00, 0x02, 0x4C, 0x05, 0x80});
+    Load(board, 1, {0xA9, 0x02, 0x8D, 0x00, 0x02, 0x4C, 0x05, 0x80});
+
+    board.Run(100);
+
+    EXPECT_EQ(board.Memory(0)[0x0200], 0x02);
+    EXPECT_EQ(board.Memory(1)[0x0200], 0x02);
+}
+
+TEST_F(BoardTests, Deterministic)
+{
+    config.processors = 3;
+
+    std::vector<std::unique_ptr<Board>> boards;
+    for (unsigned threads : {1, 3})
+    {
+        config.threads = threads;
+        auto board = std::make_unique<Board>(config);
+        for (size_t index = 0; index < board->Size(); index++)
+            Load(*board, index, counter);
+        boards.push_back(std::move(board));
+    }
+
+    boards[0]->Run(5000);
+    for (int run = 0; run < 5; run++)
+        boards[1]->Run(1000);
+
+    for (size_t index = 0; index < 3; index++)
+    {
+        EXPECT_EQ(boards[0]->Processor(index).GetRegisters(),
+                  boards[1]->Processor(index).GetRegisters());
+        EXPECT_EQ(boards[0]->Cycles(index), boards[1]->Cycles(index));
+        EXPECT_TRUE(boards[0]->Memory(index).Compare(boards[1]->Memory(index)));
+        EXPECT_EQ(boards[0]->Memory(index)[0x0200], boards[0]->Memory(0)[0x0200]);
+    }
+}
+
+TEST_F(BoardTests, CallerWatchpoint)
+{
+    std::vector<std::unique_ptr<Board>> boards;
+    for (int i = 0; i < 2; i++)
+    {
+        auto board = std::make_unique<Board>(config);
+        for (size_t index = 0; index < board->Size(); index++)
+            Load(*board, index, counter);
+        boards.push_back(std::move(board));
+    }
+
+    // Stops processor 0 before every STA $0300.
+    boards[1]->Memory(0).AddWatchpoint(0x8006, 0x8006, Mem::kExecute);
+
+    EXPECT_FALSE(boards[0]->Run(1000));
+    int stops = 0;
+    while (boards[1]->Run(1000 - boards[1]->Cycles(0)))
+    {
+        EXPECT_TRUE(boards[1]->Stopped(0));
+        EXPECT_FALSE(boards[1]->Stopped(1));
+        EXPECT_EQ(boards[1]->Processor(0).PC, 0x8006);
+        stops++;
+    }
+    EXPECT_FALSE(boards[1]->Stopped(0));
+
+    // A stop every loop of 17 cycles, without extra synchronizations.
+    EXPECT_GE(stops, 1000 / 17);
+    EXPECT_EQ(boards[1]->rounds, boards[0]->rounds);
+    for (size_t index = 0; index < 2; index++)
+    {
+        EXPECT_EQ(boards[0]->Processor(index).GetRegisters(),
+                  boards[1]->Processor(index).GetRegisters());
+        EXPECT_EQ(boards[0]->Cycles(index), boards[1]->Cycles(index));
+        EXPECT_TRUE(boards[0]->Memory(index).Compare(boards[1]->Memory(index)));
+    }
+}
+
+TEST_F(BoardTests, SyncOnSharedAccess)
+{
+    // loop: LDA $0200; CMP $0201; BNE loop; INC $0200; JMP loop
+    const std::vector<uint8_t> ping = {0xAD, 0x00, 0x02, 0xCD, 0x01, 0x02, 0xD0,
+                                       0xF8, 0xEE, 0x00, 0x02, 0x4C, 0x00, 0x80};
+
+    // loop: LDA $0200; CMP $0201; BEQ loop; STA $0201; JMP loop
+    const std::vector<uint8_t> pong = {0xAD, 0x00, 0x02, 0xCD, 0x01, 0x02, 0xF0,
+                                       0xF8, 0x8D, 0x01, 0x02, 0x4C, 0x00, 0x80};
+
+    uint8_t exchanges[2];
+    for (bool sync : {false, true})
+    {
+        config.sync_on_shared_access = sync;
+        Board board(config);
+        Load(board, 0, ping);
+        Load(board, 1, pong);
+
+        board.Run(2000);
+        exchanges[sync] = board.Memory(0)[0x0200];
+    }
+
+    // Without syncing every exchange takes a quantum, with it a few instructions.
+    EXPECT_LE(exchanges[false], 2000 / 100);
+    EXPECT_GT(exchanges[true], exchanges[false] * 4);
+}
+
+TEST_F(BoardTests, Error)
+{
+    Board board(config);
+    Load(board, 0, counter);
+    Load(board, 1, {0x02});
+
+    board.Run(1000);
+
+    EXPECT_TRUE(board.Error(0).empty());
+    EXPECT_FALSE(board.Error(1).empty());
+    EXPECT_GE(board.Cycles(0), 1000);
+    EXPECT_EQ(board.Cycles(1), 0);
+}
+
+TEST_F(BoardTests, InvalidConfig)
+{
+    config.shared = {{0x0300, 0x0200}};
+    EXPECT_THROW(Board{config}, std::invalid_argument);
+
+    config.shared.clear();
+    config.quantum = 0;
+    EXPECT_THROW(Board{config}, std::invalid_argument);
+}
@@ -35,7 +35,10 @@ class BranchTests : public ::testing::Test
    protected:
     void SetUp() override
     {
-        cpu.Reset(mem);
+        cpu.PowerOn(mem);
+
+        // Inline programs start at the reset vector itself.
+        cpu.PC = 0xFFFC;
     }
 
     void SetFlags(uint8_t opcode)
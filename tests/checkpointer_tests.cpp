@@ -0,0 +1,159 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "checkpointer.h"
+#include "counter_program.h"
+
+class CheckpointerTests : public ::testing::Test
+{
+   public:
+    CPU cpu;
+    Mem memory;
+
+    CheckpointConfig config;
+
+   protected:
+    void SetUp() override
+    {
+        config.path = "/tmp/mos6502_checkpointer_tests_" + std::to_string(getpid()) + ".bin";
+        config.interval = 10000;
+        StartCounter(cpu, memory);
+    }
+
+    void TearDown() override
+    {
+        std::remove(config.path.c_str());
+    }
+
+    // Runs to the first instruction boundary at or after cycle in slices of odd sizes.
+    void Run(Checkpointer& checkpointer, CPU& target_cpu, Mem& target_memory, uint64_t cycle)
+    {
+        while (target_cpu.cycles < cycle)
+            checkpointer.Execute(std::min<uint64_t>(3333, cycle - target_cpu.cycles), target_cpu,
+                                 target_memory);
+    }
+};
+
+TEST_F(CheckpointerTests, Resume)
+{
+    CPU resumed_cpu;
+    Mem resumed_memory;
+    {
+        Checkpointer checkpointer(config);
+        EXPECT_FALSE(checkpointer.Resume(resumed_cpu, resumed_memory));
+
+        Run(checkpointer, cpu, memory, 100000);
+        checkpointer.Flush();
+
+        const Checkpointer::Stats stats = checkpointer.GetStats();
+        EXPECT_EQ(stats.taken, stats.written + stats.replaced);
+        EXPECT_GE(stats.taken, 9);
+        EXPECT_GT(stats.written_cycle, 90000);
+        EXPECT_LT(stats.written_bytes, 1000);
+
+        Run(checkpointer, cpu, memory, 200000);
+    }
+
+    // The resumed run takes the same checkpoints and ends in the same state.
+    Checkpointer checkpointer(config);
+    ASSERT_TRUE(checkpointer.Resume(resumed_cpu, resumed_memory));
+    EXPECT_GT(resumed_cpu.cycles, 190000);
+
+    // The original run from the start, checkpointed into another file.
+    CPU reference_cpu;
+    Mem reference_memory;
+    StartCounter(reference_cpu, reference_memory);
+    Checkpointer reference({config.path + ".reference", config.interval, {}});
+    Run(reference, reference_cpu, reference_memory, 300000);
+
+    Run(checkpointer, resumed_cpu, resumed_memory, 300000);
+    EXPECT_EQ(resumed_cpu.cycles, reference_cpu.cycles);
+    EXPECT_EQ(resumed_cpu.GetRegisters(), reference_cpu.GetRegisters());
+    EXPECT_TRUE(resumed_memory.Compare(reference_memory));
+
+    checkpointer.Flush();
+    reference.Flush();
+    EXPECT_EQ(checkpointer.GetStats().written_cycle, reference.GetStats().written_cycle);
+    std::remove((config.path + ".reference").c_str());
+}
+
+TEST_F(CheckpointerTests, Crash)
+{
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0)
+    {
+        // Dies without cleaning up halfway between checkpoints.
+        Checkpointer checkpointer(config);
+        Run(checkpointer, cpu, memory, 55000);
+        checkpointer.Flush();
+        Run(checkpointer, cpu, memory, 58000);
+        _exit(0);
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+
+    CPU reference_cpu;
+    Mem reference_memory;
+    StartCounter(reference_cpu, reference_memory);
+    Checkpointer checkpointer(config);
+    ASSERT_TRUE(checkpointer.Resume(cpu, memory));
+    EXPECT_GE(cpu.cycles, 50000);
+    EXPECT_LT(cpu.cycles, 55000);
+
+    reference_cpu.Execute(cpu.cycles, reference_memory);
+    EXPECT_EQ(reference_cpu.cycles, cpu.cycles);
+    EXPECT_EQ(cpu.GetRegisters(), reference_cpu.GetRegisters());
+    EXPECT_TRUE(memory.Compare(reference_memory));
+}
+
+TEST_F(CheckpointerTests, Errors)
+{
+    EXPECT_THROW(Checkpointer({"", 100, {}}), std::invalid_argument);
+    EXPECT_THROW(Checkpointer({config.path, 0, {}}), std::invalid_argument);
+
+    // Write failures surface on the emulation thread at the next flush.
+    Checkpointer missing({"/tmp/mos6502_no_such_directory/checkpoint", 1000, {}});
+    missing.Execute(5000, cpu, memory);
+    EXPECT_THROW(missing.Flush(), std::system_error);
+    EXPECT_NO_THROW(missing.Flush());
+
+    std::ofstream(config.path) << "not a checkpoint";
+    Checkpointer checkpointer(config);
+    EXPECT_THROW(checkpointer.Resume(cpu, memory), std::invalid_argument);
+}
@@ -0,0 +1,188 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "coroutine.h"
+
+class CoroutineTests : public ::testing::Test
+{
+   public:
+    struct Machine
+    {
+        CPU cpu;
+        Mem memory;
+    };
+
+    EmulationScheduler scheduler{100};
+
+    std::unique_ptr<Machine> MakeMachine(const std::vector<uint8_t>& program)
+    {
+        auto machine = std::make_unique<Machine>();
+        machine->memory.Load(0x8000, program);
+        machine->cpu.SetRegisters(CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+        return machine;
+    }
+
+    // loop: INX; BNE loop; INY; JMP loop
+    const std::vector<uint8_t> counter = {0xE8, 0xD0, 0xFD, 0xC8, 0x4C, 0x00, 0x80};
+};
+
+TEST_F(CoroutineTests, Interleave)
+{
+    std::vector<std::unique_ptr<Machine>> machines;
+    std::vector<uint32_t> used(100);
+
+    for (size_t i = 0; i < used.size(); i++)
+    {
+        machines.push_back(MakeMachine(counter));
+        scheduler.Spawn(
+            [](EmulationScheduler& scheduler, Machine& machine, uint32_t& used) -> EmulationTask
+            {
+                EmulationScheduler::Result result =
+                    co_await scheduler.Emulate(machine.cpu, machine.memory, 1000);
+                EXPECT_EQ(result.event, EmulationScheduler::Event::Cycles);
+                used = result.cycles;
+            }(scheduler, *machines.back(), used[i]));
+    }
+
+    EXPECT_EQ(scheduler.Active(), 100);
+    scheduler.Run();
+
+    EXPECT_EQ(scheduler.Active(), 0);
+    EXPECT_EQ(scheduler.slices, 100 * 10);
+    for (size_t i = 0; i < used.size(); i++)
+    {
+        EXPECT_GE(used[i], 1000);
+        EXPECT_EQ(machines[i]->cpu.GetRegisters(), machines[0]->cpu.GetRegisters());
+    }
+}
+
+TEST_F(CoroutineTests, Breakpoint)
+{
+    auto machine = MakeMachine(counter);
+    machine->memory.AddWatchpoint(0x8003, 0x8003, Mem::kExecute);
+
+    int hits = 0;
+    scheduler.Spawn(
+        [](EmulationScheduler& scheduler, Machine& machine, int& hits) -> EmulationTask
+        {
+            uint32_t cycles = 0;
+            while (cycles < 100000)
+            {
+                EmulationScheduler::Result result =
+                    co_await scheduler.Emulate(machine.cpu, machine.memory, 100000 - cycles);
+                cycles += result.cycles;
+                if (result.event != EmulationScheduler::Event::Watchpoint)
+                    break;
+
+                EXPECT_EQ(result.hit.address, 0x8003);
+                EXPECT_EQ(machine.cpu.PC, 0x8003);
+                hits++;
+            }
+        }(scheduler, *machine, hits));
+
+    scheduler.Run();
+
+    // Every 256 INX the loop falls through to INY, one round takes 1284 cycles.
+    EXPECT_EQ(hits, 100000 / 1284);
+}
+
+TEST_F(CoroutineTests, InputOutput)
+{
+    // loop: LDA $D000; BEQ loop; STA $0200; done: JMP done
+    auto machine = MakeMachine({0xAD, 0x00, 0xD0, 0xF0, 0xFB, 0x8D, 0x00, 0x02, 0x4C, 0x08, 0x80});
+    const int port = machine->memory.AddWatchpoint(0xD000, 0xD000, Mem::kRead);
+
+    int polls = 0;
+    scheduler.Spawn(
+        [](EmulationScheduler& scheduler, Machine& machine, int& polls) -> EmulationTask
+        {
+            while (true)
+            {
+                EmulationScheduler::Result result =
+                    co_await scheduler.Emulate(machine.cpu, machine.memory, 1000);
+                if (result.event != EmulationScheduler::Event::Watchpoint)
+                    break;
+
+                // The device becomes ready on the third poll.
+                if (++polls == 3)
+                    machine.memory[0xD000] = 0x42;
+
+                co_await scheduler.Yield();
+            }
+        }(scheduler, *machine, polls));
+
+    scheduler.Run();
+
+    EXPECT_EQ(polls, 4);
+    EXPECT_EQ(machine->memory[0x0200], 0x42);
+    machine->memory.RemoveWatchpoint(port);
+}
+
+TEST_F(CoroutineTests, Error)
+{
+    auto machine = MakeMachine({0x02});
+
+    EmulationScheduler::Result result;
+    scheduler.Spawn(
+        [](EmulationScheduler& scheduler, Machine& machine,
+           EmulationScheduler::Result& result) -> EmulationTask
+        { result = co_await scheduler.Emulate(machine.cpu, machine.memory, 1000); }(
+            scheduler, *machine, result));
+
+    scheduler.Run();
+
+    EXPECT_EQ(result.event, EmulationScheduler::Event::Error);
+    EXPECT_FALSE(result.error.empty());
+}
+
+TEST_F(CoroutineTests, TaskException)
+{
+    scheduler.Spawn(
+        [](EmulationScheduler& scheduler) -> EmulationTask
+        {
+            co_await scheduler.Yield();
+            throw std::runtime_error("host logic failed");
+        }(scheduler));
+
+    bool finished = false;
+    scheduler.Spawn(
+        [](EmulationScheduler& scheduler, bool& finished) -> EmulationTask
+        {
+            co_await scheduler.Yield();
+            co_await scheduler.Yield();
+            finished = true;
+        }(scheduler, finished));
+
+    EXPECT_THROW(scheduler.Run(), std::runtime_error);
+    EXPECT_EQ(scheduler.Active(), 1);
+
+    scheduler.Run();
+    EXPECT_TRUE(finished);
+}
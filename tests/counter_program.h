@@ -0,0 +1,49 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef COUNTER_PROGRAM_H
+#define COUNTER_PROGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu.h"
+#include "mem.h"
+
+// loop: INC $00; BNE loop; INC $01; LDY $01; STA $0300,Y; JMP loop
+// Counts in the zero page and fills page 3 one byte every 256 iterations, so any stretch of
+// execution writes at most those two pages and runs can be compared against a reference.
+inline const std::vector<uint8_t> counter_program = {0xE6, 0x00, 0xD0, 0xFC, 0xE6, 0x01, 0xA4,
+                                                     0x01, 0x99, 0x00, 0x03, 0x4C, 0x00, 0x02};
+
+// Powers on target_cpu with the counter loaded at $0200 and A = $42.
+inline void StartCounter(CPU& target_cpu, Mem& target_memory)
+{
+    target_cpu.PowerOn(target_memory);
+    target_memory.Load(0x0200, counter_program);
+    target_cpu.PC = 0x0200;
+    target_cpu.A = 0x42;
+}
+
+#endif  // COUNTER_PROGRAM_H
@@ -0,0 +1,134 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "counter_program.h"
+#include "delta_snapshot.h"
+
+class DeltaSnapshotTests : public ::testing::Test
+{
+   public:
+    CPU cpu;
+    Mem memory;
+
+    // Reference copies of every point.
+    std::vector<Mem> memories;
+    std::vector<CPU::Registers> registers;
+
+   protected:
+    void SetUp() override
+    {
+        StartCounter(cpu, memory);
+    }
+
+    void Remember()
+    {
+        memories.push_back(memory);
+        registers.push_back(cpu.GetRegisters());
+    }
+};
+
+TEST_F(DeltaSnapshotTests, Chain)
+{
+    SnapshotChain chain(cpu, memory);
+    Remember();
+
+    for (int i = 0; i < 10; i++)
+    {
+        cpu.Execute(5000, memory);
+        EXPECT_EQ(chain.Snapshot(cpu, memory), i + 1);
+        Remember();
+
+        // Only the zero page and page 3 are written.
+        EXPECT_LE(chain.Delta(i + 1).pages.size(), 2);
+    }
+
+    EXPECT_EQ(chain.Size(), 11);
+    EXPECT_LE(chain.DeltaBytes(), 10 * (sizeof(DeltaSnapshot) + 2 * (Mem::page_size + 1)));
+
+    for (size_t point = 0; point < chain.Size(); point++)
+    {
+        CPU rebuilt_cpu;
+        Mem rebuilt_memory;
+        chain.Rebuild(point, rebuilt_cpu, rebuilt_memory);
+        EXPECT_EQ(rebuilt_cpu.GetRegisters(), registers[point]);
+        EXPECT_TRUE(rebuilt_memory.Compare(memories[point])) << point;
+    }
+
+    EXPECT_THROW(chain.Rebuild(11, cpu, memory), std::out_of_range);
+    EXPECT_THROW(chain.Delta(0), std::out_of_range);
+}
+
+TEST_F(DeltaSnapshotTests, Rewind)
+{
+    SnapshotChain chain(cpu, memory);
+    Remember();
+    for (int i = 0; i < 5; i++)
+    {
+        cpu.Execute(5000, memory);
+        chain.Snapshot(cpu, memory);
+        Remember();
+    }
+
+    // Writes after the last snapshot are undone too.
+    cpu.Execute(5000, memory);
+    memory[0x8000] = 0x11;
+
+    chain.Rewind(2, cpu, memory);
+    EXPECT_EQ(chain.Size(), 3);
+    EXPECT_EQ(cpu.GetRegisters(), registers[2]);
+    EXPECT_TRUE(memory.Compare(memories[2]));
+
+    // The machine continues as it did the first time.
+    cpu.Execute(5000, memory);
+    chain.Snapshot(cpu, memory);
+    EXPECT_EQ(cpu.GetRegisters(), registers[3]);
+    EXPECT_TRUE(memory.Compare(memories[3]));
+
+    chain.Rewind(0, cpu, memory);
+    EXPECT_EQ(chain.Size(), 1);
+    EXPECT_TRUE(memory.Compare(memories[0]));
+}
+
+TEST_F(DeltaSnapshotTests, HostWrites)
+{
+    SnapshotChain chain(cpu, memory);
+
+    memory[0x1000] = 1;
+    memory.Fill(0x2000, 0x200, 2);
+    chain.Snapshot(cpu, memory);
+    EXPECT_EQ(chain.Delta(1).pages, std::vector<uint8_t>({0x10, 0x20, 0x21}));
+
+    // Power-on clears the written pages, which changes them again.
+    cpu.PowerOn(memory);
+    chain.Snapshot(cpu, memory);
+    EXPECT_EQ(chain.Delta(2).pages, std::vector<uint8_t>({0x02, 0x10, 0x20, 0x21}));
+
+    chain.Snapshot(cpu, memory);
+    EXPECT_TRUE(chain.Delta(3).pages.empty());
+}
@@ -0,0 +1,150 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "differential.h"
+
+namespace
+{
+// The reference interpreter with a planted bug: ADC immediate leaves the carry inverted, and
+// STA absolute also writes the next byte.
+class BrokenEngine : public DiffEngine
+{
+   public:
+    void SetState(const CPU::Registers& registers, const Mem& memory) override
+    {
+        this->memory = memory;
+        cpu.SetRegisters(registers);
+    }
+
+    uint32_t Execute(uint32_t machine_cycles) override
+    {
+        const uint8_t opcode = memory[cpu.PC];
+        const uint16_t operand = memory[(uint16_t)(cpu.PC + 1)] |
+                                 (memory[(uint16_t)(cpu.PC + 2)] << 8);
+        uint32_t cycles = cpu.Execute(machine_cycles, memory);
+
+        if (opcode == 0x69)
+            cpu.C = !cpu.C;
+        if (opcode == 0x8D)
+            memory[(uint16_t)(operand + 1)] = cpu.A + 1;
+
+        return cycles;
+    }
+
+    CPU::Registers GetRegisters() const override
+    {
+        return cpu.GetRegisters();
+    }
+
+    const Mem& Memory() const override
+    {
+        return memory;
+    }
+
+   private:
+    CPU cpu;
+    Mem memory;
+};
+}  // namespace
+
+class DifferentialTests : public ::testing::Test
+{
+   public:
+    ThreadPool pool{4};
+    Mem memory;
+    CPU::Registers registers{0x8000, 0xFF, 0x10, 0x00, 0x00, 0x00};
+};
+
+TEST_F(DifferentialTests, RegisterDivergence)
+{
+    // CLC; LDA #$10; ADC #$01; JMP $8000
+    memory.Load(0x8000, std::vector<uint8_t>{0x18, 0xA9, 0x10, 0x69, 0x01, 0x4C, 0x00, 0x80});
+
+    auto reference = MakeReferenceEngine();
+    BrokenEngine broken;
+    std::optional<Divergence> divergence = RunDifferential(*reference, broken, registers, memory);
+
+    ASSERT_TRUE(divergence);
+    EXPECT_EQ(divergence->step, 2);
+    EXPECT_EQ(divergence->pc, 0x8003);
+    EXPECT_EQ(divergence->opcode, 0x69);
+    EXPECT_EQ(divergence->expected.PS ^ divergence->actual.PS, 0x01);
+    EXPECT_TRUE(divergence->memory.empty());
+    EXPECT_EQ(divergence->Describe(), "step 2 at PC $8003 opcode $69: PS $00 != $01");
+}
+
+TEST_F(DifferentialTests, MemoryDivergence)
+{
+    // STA $0200; JMP $8000
+    memory.Load(0x8000, std::vector<uint8_t>{0x8D, 0x00, 0x02, 0x4C, 0x00, 0x80});
+
+    auto reference = MakeReferenceEngine();
+    BrokenEngine broken;
+    std::optional<Divergence> divergence = RunDifferential(*reference, broken, registers, memory);
+
+    ASSERT_TRUE(divergence);
+    EXPECT_EQ(divergence->step, 0);
+    EXPECT_EQ(divergence->expected, divergence->actual);
+    EXPECT_EQ(divergence->memory, (std::vector<Mem::Range>{{0x0201, 0x0202}}));
+
+    DiffOptions options;
+    options.compare_memory = false;
+    EXPECT_FALSE(RunDifferential(*reference, broken, registers, memory, options));
+}
+
+TEST_F(DifferentialTests, SameError)
+{
+    memory[0x8000] = 0x02;
+
+    auto reference = MakeReferenceEngine();
+    auto candidate = MakeReferenceEngine();
+    EXPECT_FALSE(RunDifferential(*reference, *candidate, registers, memory));
+}
+
+TEST_F(DifferentialTests, LockstepMatchesReference)
+{
+    DiffOptions options;
+    options.max_steps = 200;
+
+    std::vector<DiffFailure> failures =
+        RunRandomPrograms(MakeReferenceEngine, MakeLockstepEngine, 1, 32, pool, options);
+
+    for (const DiffFailure& failure : failures)
+        ADD_FAILURE() << "seed " << failure.seed << ": " << failure.divergence.Describe();
+}
+
+TEST_F(DifferentialTests, BlockSteps)
+{
+    DiffOptions options;
+    options.step_cycles = 1000;
+    options.max_steps = 10;
+
+    EXPECT_TRUE(RunRandomPrograms(MakeReferenceEngine, MakeLockstepEngine, 100, 8, pool, options)
+                    .empty());
+}
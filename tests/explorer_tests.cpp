@@ -0,0 +1,138 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "explorer.h"
+
+class ExplorerTests : public ::testing::Test
+{
+   public:
+    // Adds an input from $10, 0 or 1, to a sum at $11 in each of three rounds:
+    //       LDX #$03
+    // loop: LDA $11; CLC; ADC $10; STA $11; LDA #$00; STA $10; DEX; BNE loop
+    // stop: NOP
+    // The decisions at loop make 2^3 paths, but only the sums tell states apart.
+    ExploreConfig Sum()
+    {
+        ExploreConfig config;
+        config.image = {0xA2, 0x03, 0xA5, 0x11, 0x18, 0x65, 0x10, 0x85, 0x11,
+                        0xA9, 0x00, 0x85, 0x10, 0xCA, 0xD0, 0xF2, 0xEA};
+        config.load_address = 0x0200;
+        config.registers = {0x0200, 0xFF, 0, 0, 0, 0};
+        config.decisions = {{0x0202, 0x0010, {0, 1}}};
+        config.stop_addresses = {0x0210};
+        config.threads = 4;
+        return config;
+    }
+};
+
+TEST_F(ExplorerTests, DepthFirst)
+{
+    Explorer explorer(Sum());
+
+    std::vector<uint8_t> sums;
+    std::vector<std::vector<uint8_t>> inputs;
+    Explorer::Stats stats = explorer.Explore(
+        [&](const Explorer::Terminal& terminal)
+        {
+            EXPECT_EQ(terminal.outcome, Explorer::Outcome::Stopped);
+            EXPECT_EQ(terminal.registers.PC, 0x0210);
+            sums.push_back(terminal.inputs[0] + terminal.inputs[1] + terminal.inputs[2]);
+            inputs.push_back(terminal.inputs);
+        });
+
+    // One state before each round, then the sums 0..k after round k.
+    EXPECT_EQ(stats.states, 1 + 2 + 3 + 4);
+    EXPECT_EQ(stats.duplicates, 1 + 2);
+    EXPECT_EQ(stats.stopped, 4);
+    EXPECT_EQ(stats.hangs + stats.crashes, 0);
+    EXPECT_TRUE(stats.complete);
+    EXPECT_GT(stats.peak_bytes, 0);
+
+    std::sort(sums.begin(), sums.end());
+    EXPECT_EQ(sums, std::vector<uint8_t>({0, 1, 2, 3}));
+    EXPECT_NE(std::find(inputs.begin(), inputs.end(), std::vector<uint8_t>({1, 1, 1})),
+              inputs.end());
+
+    // Exploring again starts over.
+    EXPECT_EQ(explorer.Explore().states, stats.states);
+}
+
+TEST_F(ExplorerTests, BreadthFirst)
+{
+    ExploreConfig config = Sum();
+    config.depth_first = false;
+    config.image[1] = 0x20;
+    config.decisions[0].values = {0, 1, 2, 3};
+
+    // 32 rounds of 4 inputs are 2^64 paths but only 1 + 4 + 7 + ... + 97 states before the stop.
+    Explorer::Stats stats = Explorer(config).Explore();
+    EXPECT_EQ(stats.states, 32 * (1 + 94) / 2 + 97);
+    EXPECT_EQ(stats.stopped, 97);
+    EXPECT_TRUE(stats.complete);
+
+    config.max_states = 100;
+    stats = Explorer(config).Explore();
+    EXPECT_FALSE(stats.complete);
+    EXPECT_LE(stats.states, 100);
+}
+
+TEST_F(ExplorerTests, Outcomes)
+{
+    // LDA $10; BEQ hang; CMP #$01; BEQ crash; JMP stop
+    // hang: JMP hang
+    // crash: .byte $02
+    // stop: NOP
+    ExploreConfig config;
+    config.image = {0xA5, 0x10, 0xF0, 0x07, 0xC9, 0x01, 0xF0, 0x06, 0x4C, 0x10,
+                    0x02, 0x4C, 0x0B, 0x02, 0x02, 0xEA, 0xEA};
+    config.load_address = 0x0200;
+    config.registers = {0x0200, 0xFF, 0, 0, 0, 0};
+    config.decisions = {{0x0200, 0x0010, {0, 1, 2}}};
+    config.stop_addresses = {0x0210};
+    config.cycles = 1000;
+
+    std::vector<Explorer::Outcome> outcomes(3);
+    Explorer::Stats stats =
+        Explorer(config).Explore([&](const Explorer::Terminal& terminal)
+                                 { outcomes[terminal.inputs[0]] = terminal.outcome; });
+
+    EXPECT_EQ(stats.states, 2);
+    EXPECT_EQ(stats.hangs, 1);
+    EXPECT_EQ(stats.crashes, 1);
+    EXPECT_EQ(stats.stopped, 1);
+    EXPECT_EQ(outcomes, std::vector<Explorer::Outcome>({Explorer::Outcome::Hang,
+                                                         Explorer::Outcome::Crash,
+                                                         Explorer::Outcome::Stopped}));
+
+    config.decisions.push_back({0x0200, 0x0011, {0}});
+    EXPECT_THROW(Explorer{config}, std::invalid_argument);
+    config.decisions = {{0x0200, 0x0010, {}}};
+    EXPECT_THROW(Explorer{config}, std::invalid_argument);
+}
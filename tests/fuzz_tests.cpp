@@ -0,0 +1,131 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "fuzz.h"
+
+class FuzzTests : public ::testing::Test
+{
+   public:
+    FuzzTarget target;
+
+    void SetUp() override
+    {
+        // Crashes on an illegal opcode when the input starts with "BUG", else jumps to $C000.
+        //   LDA $0400; CMP #'B'; BNE done; LDA $0401; CMP #'U'; BNE done
+        //   LDA $0402; CMP #'G'; BNE done; .byte $02; done: JMP $C000
+        target.image = {0xAD, 0x00, 0x04, 0xC9, 0x42, 0xD0, 0x0F, 0xAD, 0x01, 0x04, 0xC9, 0x55,
+                        0xD0, 0x08, 0xAD, 0x02, 0x04, 0xC9, 0x47, 0xD0, 0x01, 0x02, 0x4C, 0x00,
+                        0xC0};
+        target.load_address = 0x8000;
+        target.registers = CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0};
+        target.input_address = 0x0400;
+        target.max_input_length = 16;
+        target.cycles = 1000;
+        target.stop_addresses = {0xC000};
+    }
+};
+
+TEST_F(FuzzTests, Outcomes)
+{
+    Fuzzer fuzzer(target);
+
+    bool new_coverage;
+    EXPECT_EQ(fuzzer.Run({'A'}, &new_coverage), Fuzzer::Outcome::Stopped);
+    EXPECT_TRUE(new_coverage);
+    EXPECT_EQ(fuzzer.Run({'C'}, &new_coverage), Fuzzer::Outcome::Stopped);
+    EXPECT_FALSE(new_coverage);
+    EXPECT_EQ(fuzzer.Run({'B', 'U', 'G'}, &new_coverage), Fuzzer::Outcome::Crash);
+    EXPECT_TRUE(new_coverage);
+
+    // The first input is still in memory unless the next run restored it.
+    EXPECT_EQ(fuzzer.Run({}, &new_coverage), Fuzzer::Outcome::Stopped);
+    EXPECT_EQ(fuzzer.Run({'B', 'U'}, &new_coverage), Fuzzer::Outcome::Stopped);
+
+    EXPECT_EQ(fuzzer.executions, 5);
+    EXPECT_EQ(fuzzer.crashes, 1);
+}
+
+TEST_F(FuzzTests, Restore)
+{
+    // INC $0300; LDA $0300; CMP #1; BEQ done; .byte $02; done: JMP $C000
+    target.image = {0xEE, 0x00, 0x03, 0xAD, 0x00, 0x03, 0xC9, 0x01,
+                    0xF0, 0x01, 0x02, 0x4C, 0x00, 0xC0};
+    Fuzzer fuzzer(target);
+
+    for (int run = 0; run < 3; run++)
+        EXPECT_EQ(fuzzer.Run({}), Fuzzer::Outcome::Stopped);
+}
+
+TEST_F(FuzzTests, Hang)
+{
+    // loop: JMP loop
+    target.image = {0x4C, 0x00, 0x80};
+    Fuzzer fuzzer(target);
+
+    EXPECT_EQ(fuzzer.Run({}), Fuzzer::Outcome::Hang);
+    EXPECT_EQ(fuzzer.hangs, 1);
+}
+
+TEST_F(FuzzTests, LengthAddress)
+{
+    // LDA $0010; CMP #3; BEQ done; .byte $02; done: JMP $C000
+    target.image = {0xAD, 0x10, 0x00, 0xC9, 0x03, 0xF0, 0x01, 0x02, 0x4C, 0x00, 0xC0};
+    target.length_address = 0x0010;
+    Fuzzer fuzzer(target);
+
+    EXPECT_EQ(fuzzer.Run({1, 2, 3}), Fuzzer::Outcome::Stopped);
+    EXPECT_EQ(fuzzer.Run({1, 2}), Fuzzer::Outcome::Crash);
+}
+
+TEST_F(FuzzTests, FindsCrash)
+{
+    Fuzzer fuzzer(target, 6502);
+    fuzzer.AddSeed({'A', 'A', 'A'});
+    while (fuzzer.Crashes().empty() && fuzzer.executions < 1000000)
+        fuzzer.Fuzz(1000);
+
+    ASSERT_FALSE(fuzzer.Crashes().empty());
+    const std::vector<uint8_t>& crash = fuzzer.Crashes().front();
+    ASSERT_GE(crash.size(), 3);
+    EXPECT_TRUE(std::equal(crash.begin(), crash.begin() + 3, "BUG"));
+    EXPECT_EQ(fuzzer.Edges(), 3 * 2 + 1);
+}
+
+TEST_F(FuzzTests, InputOutOfRange)
+{
+    target.input_address = 0xFFF8;
+    EXPECT_THROW(Fuzzer{target}, std::invalid_argument);
+
+    target.input_address = 0x0400;
+    target.length_address = 0xFFFF;
+    EXPECT_THROW(Fuzzer{target}, std::invalid_argument);
+
+    target.length_address = 0xFFFE;
+    EXPECT_NO_THROW(Fuzzer{target});
+}
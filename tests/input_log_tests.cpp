@@ -0,0 +1,185 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "input_log.h"
+
+class InputLogTests : public ::testing::Test
+{
+   public:
+    CPU cpu;
+    Mem memory;
+
+    // Replays what was recorded on cpu and memory.
+    CPU replay_cpu;
+    Mem replay_memory;
+
+    // Status at $D000 and data at $D001.
+    const std::vector<Mem::Range> inputs = {{0xD000, 0xD002}};
+
+    // loop: LDA $D000; BEQ loop; LDA $D001; LDX $10; STA $0300,X; INC $10; JMP loop
+    const std::vector<uint8_t> program = {0xAD, 0x00, 0xD0, 0xF0, 0xFB, 0xAD, 0x01, 0xD0, 0xA6,
+                                          0x10, 0x9D, 0x00, 0x03, 0xE6, 0x10, 0x4C, 0x00, 0x02};
+
+    // IRQ: INC $11; RTI. NMI: INC $12; RTI.
+    const std::vector<uint8_t> handlers = {0xE6, 0x11, 0x40, 0xE6, 0x12, 0x40};
+
+    uint64_t seed = 1;
+
+   protected:
+    void SetUp() override
+    {
+        Start(cpu, memory);
+        Start(replay_cpu, replay_memory);
+    }
+
+    void Start(CPU& target_cpu, Mem& target_memory)
+    {
+        target_cpu.PowerOn(target_memory);
+        target_memory.Load(0x0200, program);
+        target_memory.Load(0x0400, handlers);
+        target_memory.Load(0xFFFA, {0x03, 0x04});
+        target_memory.Load(0xFFFE, {0x00, 0x04});
+        target_cpu.PC = 0x0200;
+    }
+
+    uint32_t Random(uint32_t bound)
+    {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        return (seed >> 33) % bound;
+    }
+
+    // The device has data on every seventh status read.
+    uint8_t Device(uint16_t address)
+    {
+        return address == 0xD000 ? Random(7) == 0 : Random(256);
+    }
+
+    std::vector<uint8_t> Record()
+    {
+        InputRecorder recorder(cpu, memory, inputs, [this](uint16_t address)
+                               { return Device(address); });
+        for (int i = 1; i <= 300; i++)
+        {
+            cpu.Execute(1 + Random(500), memory);
+            if (i % 10 == 0)
+                recorder.Interrupt(i % 30 ? CPU::Interrupt::IRQ : CPU::Interrupt::NMI);
+            if (i % 40 == 0)
+                recorder.Write(0x0500 + i, {uint8_t(i), uint8_t(i + 1)});
+        }
+
+        recorder.Write(0x0600, {0x42});
+        EXPECT_GT(recorder.reads, 1000);
+        return recorder.Log();
+    }
+
+    // Replays the whole log in slices of a different size than the recording.
+    void Replay(const std::vector<uint8_t>& log)
+    {
+        InputReplayer replayer(replay_cpu, replay_memory, log);
+        while (replay_cpu.cycles < cpu.cycles)
+            replayer.Execute(std::min<uint64_t>(777, cpu.cycles - replay_cpu.cycles));
+        EXPECT_TRUE(replayer.Done());
+    }
+};
+
+TEST_F(InputLogTests, Replay)
+{
+    const std::vector<uint8_t> log = Record();
+    EXPECT_GT(memory[0x10], 0);
+    EXPECT_GT(memory[0x11], 0);
+    EXPECT_GT(memory[0x12], 0);
+
+    Replay(log);
+    EXPECT_EQ(replay_cpu.cycles, cpu.cycles);
+    EXPECT_EQ(replay_cpu.GetRegisters(), cpu.GetRegisters());
+    EXPECT_TRUE(replay_memory.Compare(memory));
+    EXPECT_EQ(replay_memory[0x0600], 0x42);
+
+    // The input watchpoints are gone afterwards.
+    EXPECT_FALSE(replay_memory.WatchExecute(0xD000));
+    replay_memory.Read(0xD000);
+    EXPECT_FALSE(replay_memory.ConsumeStop());
+}
+
+TEST_F(InputLogTests, Compact)
+{
+    InputRecorder recorder(cpu, memory, inputs, [](uint16_t) { return 0; });
+    cpu.Execute(100000, memory);
+
+    // An idle device polled all the time logs a single repeated read.
+    EXPECT_GT(recorder.reads, 10000);
+    EXPECT_LT(recorder.Log().size(), 40);
+}
+
+TEST_F(InputLogTests, Diverged)
+{
+    const std::vector<uint8_t> log = Record();
+
+    // Reads data from $D000 instead of $D001.
+    replay_memory[0x0206] = 0x00;
+    EXPECT_THROW(Replay(log), std::runtime_error);
+
+    // Runs past the recording.
+    Start(replay_cpu, replay_memory);
+    InputReplayer replayer(replay_cpu, replay_memory, log);
+    EXPECT_THROW(replayer.Execute(cpu.cycles + 10000), std::runtime_error);
+}
+
+TEST_F(InputLogTests, Malformed)
+{
+    std::vector<uint8_t> log = Record();
+    EXPECT_THROW(InputReplayer(replay_cpu, replay_memory, {}), std::invalid_argument);
+    EXPECT_THROW(InputReplayer(replay_cpu, replay_memory, {1, 2, 3, 4, 5, 6}),
+                 std::invalid_argument);
+
+    std::vector<uint8_t> truncated(log.begin(), log.begin() + 40);
+    EXPECT_THROW(InputReplayer(replay_cpu, replay_memory, truncated), std::invalid_argument);
+
+    // A repeat has to add at least one read.
+    std::vector<uint8_t> repeated = log;
+    repeated.insert(repeated.end(), {input_log::kRepeat, 1});
+    EXPECT_NO_THROW(InputReplayer(replay_cpu, replay_memory, repeated));
+    repeated.back() = 0;
+    EXPECT_THROW(InputReplayer(replay_cpu, replay_memory, repeated), std::invalid_argument);
+
+    replay_cpu.cycles = 1;
+    EXPECT_THROW(InputReplayer(replay_cpu, replay_memory, log), std::invalid_argument);
+}
+
+TEST_F(InputLogTests, Watchpoints)
+{
+    // Other watchpoints still stop execution while recording.
+    InputRecorder recorder(cpu, memory, inputs, [](uint16_t) { return 1; });
+    memory.AddWatchpoint(0x0300, 0x03FF, Mem::kWrite);
+    cpu.Execute(1000, memory);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Watchpoint);
+    EXPECT_EQ(memory.LastWatchHit().address, 0x0300);
+    EXPECT_EQ(memory[0x0300], 1);
+}
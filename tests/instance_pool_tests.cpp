@@ -0,0 +1,136 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <new>
+#include <set>
+#include <system_error>
+#include <vector>
+
+#include "instance_pool.h"
+
+class InstancePoolTests : public ::testing::Test
+{
+   public:
+    // LDA #$42; STA $0300; loop: JMP loop
+    const std::vector<uint8_t> program = {0xA9, 0x42, 0x8D, 0x00, 0x03, 0x4C, 0x05, 0x80};
+
+    void Run(InstancePool::Instance& instance)
+    {
+        instance.cpu.PowerOn(instance.memory);
+        instance.memory.Load(0x8000, program);
+        instance.cpu.PC = 0x8000;
+        instance.cpu.Execute(20, instance.memory);
+    }
+};
+
+TEST_F(InstancePoolTests, AcquireRelease)
+{
+    InstancePool pool({4});
+    std::set<InstancePool::Instance*> instances;
+
+    for (int i = 0; i < 4; i++)
+    {
+        InstancePool::Instance* instance = pool.Acquire();
+        Run(*instance);
+        EXPECT_EQ(instance->memory[0x0300], 0x42);
+        instances.insert(instance);
+    }
+
+    EXPECT_EQ(instances.size(), 4);
+    EXPECT_EQ(pool.Live(), 4);
+    EXPECT_THROW(pool.Acquire(), std::bad_alloc);
+
+    InstancePool::Instance* instance = *instances.begin();
+    instance->memory.Protect(0x8000, 0x100);
+    pool.Release(instance);
+    EXPECT_EQ(pool.Live(), 3);
+
+    // The slot comes back with zeroed, writable memory.
+    InstancePool::Instance* reused = pool.Acquire();
+    EXPECT_EQ(reused, instance);
+    EXPECT_EQ(reused->memory[0x0300], 0x00);
+    EXPECT_EQ(reused->memory[0x8000], 0x00);
+    EXPECT_FALSE(reused->memory.IsReadOnly(0x8000));
+
+    // So does a discarded one.
+    Run(*reused);
+    pool.Release(reused, true);
+    reused = pool.Acquire();
+    EXPECT_EQ(reused->memory[0x0300], 0x00);
+    Run(*reused);
+    EXPECT_EQ(reused->memory[0x0300], 0x42);
+}
+
+TEST_F(InstancePoolTests, ForeignInstance)
+{
+    InstancePool pool({2});
+    InstancePool other({2});
+    InstancePool::Instance* instance = other.Acquire();
+
+    EXPECT_THROW(pool.Release(instance), std::invalid_argument);
+
+    other.Release(instance);
+    EXPECT_THROW(other.Release(instance), std::invalid_argument);
+}
+
+TEST_F(InstancePoolTests, NoFileMapping)
+{
+    InstancePool pool({1});
+    InstancePool::Instance* instance = pool.Acquire();
+
+    EXPECT_THROW(instance->memory.Map("/dev/zero", 0x1000, Mem::Mapping::Private),
+                 std::invalid_argument);
+}
+
+TEST_F(InstancePoolTests, HugePages)
+{
+    InstancePool pool({64, true});
+    InstancePool::Instance* instance = pool.Acquire();
+    Run(*instance);
+
+    EXPECT_EQ(instance->memory[0x0300], 0x42);
+}
+
+TEST_F(InstancePoolTests, NumaNode)
+{
+    try
+    {
+        InstancePool pool({4, false, 0});
+        InstancePool::Instance* instance = pool.Acquire();
+        Run(*instance);
+        EXPECT_EQ(instance->memory[0x0300], 0x42);
+    }
+    catch (const std::system_error& e)
+    {
+        GTEST_SKIP() << "No NUMA support: " << e.what();
+    }
+}
+
+TEST_F(InstancePoolTests, InvalidConfig)
+{
+    EXPECT_THROW(InstancePool({0}), std::invalid_argument);
+    EXPECT_THROW(InstancePool({1, false, 64}), std::invalid_argument);
+}
@@ -0,0 +1,190 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "lockstep.h"
+
+class LockstepTests : public ::testing::Test
+{
+   public:
+    Lockstep lockstep;
+    std::vector<std::unique_ptr<Mem>> mems;
+
+    // loop: DEX; BNE loop; STA $0300; JMP $C000
+    void LoadCountdown(Mem& mem)
+    {
+        mem.Load(0x8000, std::vector<uint8_t>{0xCA, 0xD0, 0xFD, 0x8D, 0x00, 0x03, 0x4C, 0x00,
+                                              0xC0});
+        mem.AddWatchpoint(0xC000, 0xC000, Mem::kExecute);
+    }
+
+    void SetUp() override
+    {
+        for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+            mems.push_back(std::make_unique<Mem>());
+    }
+};
+
+TEST_F(LockstepTests, DivergentLanes)
+{
+    for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+    {
+        LoadCountdown(*mems[lane]);
+        lockstep.SetLane(lane, mems[lane].get(),
+                         CPU::Registers{0x8000, 0xFF, (uint8_t)lane, (uint8_t)(lane + 1), 0, 0});
+    }
+
+    lockstep.Execute(10000);
+
+    for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+    {
+        CPU::Registers registers = lockstep.GetRegisters(lane);
+        EXPECT_EQ(lockstep.Stop(lane), Lockstep::LaneStop::Watchpoint);
+        EXPECT_EQ(registers.PC, 0xC000);
+        EXPECT_EQ(registers.X, 0);
+        EXPECT_EQ((*mems[lane])[0x0300], lane);
+
+        // Every DEX BNE pair is 2 + 3, except the last one that does not branch, then STA and JMP.
+        EXPECT_EQ(lockstep.Cycles(lane), (lane + 1) * 5 - 1 + 4 + 3);
+    }
+
+    // Lanes run the loop together until they leave it one by one.
+    EXPECT_LT(lockstep.dispatches, lockstep.lane_instructions);
+}
+
+TEST_F(LockstepTests, DetachedLanes)
+{
+    LoadCountdown(*mems[3]);
+    lockstep.SetLane(3, mems[3].get(), CPU::Registers{0x8000, 0xFF, 0x42, 0x01, 0, 0});
+
+    lockstep.Execute(100);
+
+    EXPECT_EQ(lockstep.GetRegisters(3).PC, 0xC000);
+    EXPECT_EQ(lockstep.Cycles(0), 0);
+    EXPECT_EQ(lockstep.dispatches, lockstep.lane_instructions);
+}
+
+TEST_F(LockstepTests, IllegalOpcode)
+{
+    (*mems[0])[0x8000] = 0x02;
+    lockstep.SetLane(0, mems[0].get(), CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+
+    lockstep.Execute(100);
+
+    EXPECT_EQ(lockstep.Stop(0), Lockstep::LaneStop::IllegalOpcode);
+    EXPECT_EQ(lockstep.GetRegisters(0).PC, 0x8001);
+    EXPECT_EQ(lockstep.Cycles(0), 0);
+}
+
+TEST_F(LockstepTests, ResumeAfterWatchpoint)
+{
+    LoadCountdown(*mems[0]);
+    mems[0]->AddWatchpoint(0x8003, 0x8003, Mem::kExecute);
+    lockstep.SetLane(0, mems[0].get(), CPU::Registers{0x8000, 0xFF, 0x42, 0x01, 0, 0});
+
+    lockstep.Execute(100);
+    EXPECT_EQ(lockstep.GetRegisters(0).PC, 0x8003);
+
+    lockstep.Execute(100);
+    EXPECT_EQ(lockstep.GetRegisters(0).PC, 0xC000);
+    EXPECT_EQ((*mems[0])[0x0300], 0x42);
+}
+
+// Random legal opcodes exercise every operation and addressing mode, lanes must match the CPU
+// exactly.
+TEST_F(LockstepTests, MatchesCPU)
+{
+    std::mt19937 random(6502);
+
+    std::vector<uint8_t> legal;
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        Mem mem;
+        CPU cpu;
+        mem[0x0200] = opcode;
+        cpu.SetRegisters(CPU::Registers{0x0200, 0xFF, 0, 0, 0, 0});
+        try
+        {
+            cpu.Execute(1, mem);
+            legal.push_back(opcode);
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+    std::vector<Mem> references;
+    std::vector<CPU> cpus(Lockstep::max_lanes);
+    std::vector<bool> illegal(Lockstep::max_lanes, false);
+
+    for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+    {
+        Mem& mem = *mems[lane];
+        for (uint32_t address = 0; address < Mem::max_size; address++)
+            mem[address] = legal[random() % legal.size()];
+
+        // Half of the lanes share their code so groups of every size show up.
+        if (lane % 2)
+            mem.Load(0x0200, mems[0]->Slice(0x0200, 0x1000).data(), 0x1000);
+
+        CPU::Registers registers{(uint16_t)(0x0200 + random() % 0x100), (uint8_t)random(),
+                                 (uint8_t)random(), (uint8_t)random(), (uint8_t)random(),
+                                 (uint8_t)random()};
+        references.emplace_back(mem);
+        cpus[lane].SetRegisters(registers);
+        lockstep.SetLane(lane, &mem, registers);
+    }
+
+    for (int round = 0; round < 200; round++)
+    {
+        lockstep.Execute(100);
+
+        for (unsigned lane = 0; lane < Lockstep::max_lanes; lane++)
+        {
+            if (illegal[lane])
+                continue;
+
+            uint32_t cycles = 0;
+            try
+            {
+                cycles = cpus[lane].Execute(100, references[lane]);
+                EXPECT_EQ(lockstep.Stop(lane), Lockstep::LaneStop::Cycles);
+                EXPECT_EQ(lockstep.Cycles(lane), cycles);
+            }
+            catch (const std::invalid_argument&)
+            {
+                illegal[lane] = true;
+                EXPECT_EQ(lockstep.Stop(lane), Lockstep::LaneStop::IllegalOpcode);
+            }
+
+            EXPECT_EQ(lockstep.GetRegisters(lane), cpus[lane].GetRegisters()) << "lane " << lane;
+            EXPECT_TRUE(mems[lane]->Compare(references[lane])) << "lane " << lane;
+        }
+    }
+}
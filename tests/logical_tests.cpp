@@ -37,7 +37,10 @@ class LogicalTests : public ::testing::Test
    protected:
     void SetUp() override
     {
-        cpu.Reset(mem);
+        cpu.PowerOn(mem);
+
+        // Inline programs start at the reset vector itself.
+        cpu.PC = 0xFFFC;
     }
 
     void OpImmediate(uint8_t opcode, const std::function<int(int, int)>& f)
@@ -572,4 +575,21 @@ TEST_F(LogicalTests, BITAbsolute)
     EXPECT_TRUE(cpu.Z);
     EXPECT_FALSE(cpu.V);
     EXPECT_FALSE(cpu.N);
-}
\ No newline at end of file
+}
+TEST_F(LogicalTests, BITOverflowNegative)
+{
+    cpu.A = 0xCF;
+
+    mem[0xFFFC] = 0x24;
+    mem[0xFFFD] = 0x22;
+    mem[0x0022] = 0xF0;
+
+    const uint32_t cycles = 3;
+    uint32_t used_cycles = cpu.Execute(cycles, mem);
+
+    EXPECT_EQ(used_cycles, cycles);
+    EXPECT_FALSE(cpu.Z);
+    EXPECT_TRUE(cpu.V);
+    EXPECT_TRUE(cpu.N);
+    EXPECT_EQ(cpu.A, 0xCF);
+}
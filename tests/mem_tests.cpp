@@ -0,0 +1,412 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "cpu.h"
+#include "rom_image.h"
+
+class MemTests : public ::testing::Test
+{
+   public:
+    Mem mem;
+    CPU cpu;
+
+    std::string image_path = testing::TempDir() + "mos6502_mem_tests.bin";
+
+   protected:
+    void SetUp() override
+    {
+        cpu.PowerOn(mem);
+
+        // Inline programs start at the reset vector itself.
+        cpu.PC = 0xFFFC;
+
+        // 8 KB image: the first byte of every 256 byte page holds the page number.
+        std::vector<char> image(0x2000, 0);
+        for (size_t page = 0; page < image.size() / 0x100; page++)
+            image[page * 0x100] = page;
+
+        std::ofstream file(image_path, std::ios::binary | std::ios::trunc);
+        file.write(image.data(), image.size());
+    }
+
+    void TearDown() override
+    {
+        std::remove(image_path.c_str());
+    }
+
+    uint8_t ReadFileByte(size_t offset)
+    {
+        std::ifstream file(image_path, std::ios::binary);
+        file.seekg(offset);
+        return file.get();
+    }
+};
+
+TEST_F(MemTests, MapPrivate)
+{
+    mem.Map(image_path, 0xE000, Mem::Mapping::Private);
+
+    EXPECT_EQ(mem[0xE000], 0x00);
+    EXPECT_EQ(mem[0xE100], 0x01);
+    EXPECT_EQ(mem[0xFF00], 0x1F);
+
+    // Writes stay in memory and never reach the file.
+    mem[0xE100] = 0x42;
+    EXPECT_EQ(mem[0xE100], 0x42);
+    EXPECT_EQ(ReadFileByte(0x100), 0x01);
+}
+
+TEST_F(MemTests, MapShared)
+{
+    mem.Map(image_path, 0x6000, Mem::Mapping::Shared);
+
+    EXPECT_EQ(mem[0x6200], 0x02);
+
+    mem[0x6200] = 0x42;
+    EXPECT_EQ(ReadFileByte(0x200), 0x42);
+}
+
+TEST_F(MemTests, MapOffset)
+{
+    mem.Map(image_path, 0xF000, Mem::Mapping::Private, 0x1000, 0x1000);
+
+    EXPECT_EQ(mem[0xF000], 0x10);
+    EXPECT_EQ(mem[0xFF00], 0x1F);
+}
+
+TEST_F(MemTests, MapExecute)
+{
+    mem.Map(image_path, 0xE000, Mem::Mapping::Private);
+
+    // LDA $E300
+    mem[0xFFFC] = 0xAD;
+    mem[0xFFFD] = 0x00;
+    mem[0xFFFE] = 0xE3;
+
+    const uint32_t cycles = 4;
+    uint32_t used_cycles = cpu.Execute(cycles, mem);
+
+    EXPECT_EQ(cpu.A, 0x03);
+    EXPECT_EQ(cycles, used_cycles);
+}
+
+TEST_F(MemTests, MapInvalid)
+{
+    EXPECT_THROW(mem.Map(image_path, 0xE001, Mem::Mapping::Private), std::invalid_argument);
+    EXPECT_THROW(mem.Map(image_path, 0xF000, Mem::Mapping::Private), std::invalid_argument);
+    EXPECT_THROW(mem.Map(image_path + ".missing", 0xE000, Mem::Mapping::Private),
+                 std::system_error);
+}
+
+TEST_F(MemTests, MapRom)
+{
+    std::vector<uint8_t> bytes(0x2000, 0xEA);
+    bytes[0x1000] = 0x42;
+    RomImage rom(bytes);
+    mem.MapRom(rom, 0xC000);
+
+    EXPECT_EQ(mem[0xC000], 0xEA);
+    EXPECT_EQ(mem[0xD000], 0x42);
+    EXPECT_TRUE(mem.IsReadOnly(0xDF00));
+    EXPECT_FALSE(mem.IsReadOnly(0xE000));
+
+    // CPU writes are ignored and power-on keeps the contents.
+    mem.Write(0xD000, 0x24);
+    mem[0x0200] = 0x24;
+    mem.Initialize();
+    EXPECT_EQ(mem[0xD000], 0x42);
+    EXPECT_EQ(mem[0x0200], 0x00);
+}
+
+TEST_F(MemTests, MapRomShared)
+{
+    RomImage rom(std::vector<uint8_t>(0x1000, 0x42));
+    Mem other;
+    mem.MapRom(rom, 0xF000);
+    other.MapRom(rom, 0xF000);
+
+    // Host writes only reach the memory they are made to.
+    mem[0xF100] = 0x24;
+    EXPECT_EQ(mem[0xF100], 0x24);
+    EXPECT_EQ(other[0xF100], 0x42);
+    EXPECT_FALSE(mem.Compare(other));
+
+    // Unprotected, the private copy is dropped on power-on.
+    mem.Protect(0xF000, 0x1000, false);
+    mem.Initialize();
+    EXPECT_EQ(mem[0xF100], 0x42);
+    EXPECT_TRUE(mem.Compare(other));
+}
+
+TEST_F(MemTests, MapRomInvalid)
+{
+    RomImage rom(std::vector<uint8_t>(0x1000, 0x42));
+
+    EXPECT_THROW(mem.MapRom(rom, 0xC100), std::invalid_argument);
+    EXPECT_THROW(RomImage(std::vector<uint8_t>()), std::invalid_argument);
+    EXPECT_THROW(RomImage(std::vector<uint8_t>(Mem::max_size + 1)), std::invalid_argument);
+
+    std::vector<uint8_t> storage(Mem::max_size);
+    Mem borrowed(storage.data());
+    EXPECT_THROW(borrowed.MapRom(rom, 0xF000), std::invalid_argument);
+}
+
+TEST_F(MemTests, Modified)
+{
+    mem.Protect(0xC000, 0x100);
+    mem.ClearModified();
+    EXPECT_FALSE(mem.IsModified(0x02));
+
+    // Ignored ROM writes leave the page unmodified.
+    mem.Write(0x0234, 0x42);
+    mem.Write(0xC000, 0x42);
+    EXPECT_TRUE(mem.IsModified(0x02));
+    EXPECT_FALSE(mem.IsModified(0x03));
+    EXPECT_FALSE(mem.IsModified(0xC0));
+
+    mem.ClearModified();
+    mem.Write(0x0234, 0x24);
+    EXPECT_TRUE(mem.IsModified(0x02));
+    EXPECT_EQ(mem[0x0234], 0x24);
+}
+
+TEST_F(MemTests, Hash)
+{
+    // The hash of a fresh memory holding the same bytes.
+    auto reference = [](const Mem& memory)
+    {
+        std::vector<uint8_t> bytes(Mem::max_size);
+        memory.Dump(0, bytes.data(), bytes.size());
+        Mem fresh;
+        fresh.Load(0, bytes);
+        return fresh.Hash();
+    };
+
+    EXPECT_EQ(mem.Hash(), 0);
+    mem.Map(image_path, 0xE000, Mem::Mapping::Private);
+    mem.AddWatchpoint(0x0600, 0x0600, Mem::kWrite);
+    mem.SetWatchCallback([](const Mem::WatchHit&) { return false; });
+
+    // CPU writes on both paths and host writes, before and after CPU writes to their page.
+    mem.Write(0x0200, 0x42);
+    mem.Write(0x0201, 0x43);
+    mem.Write(0x0600, 0x44);
+    mem[0x0300] = 0x45;
+    mem.Write(0x0301, 0x45);
+    mem.Fill(0x0400, 0x200, 0x46);
+    mem.Write(0x0200, 0x46);
+    const uint64_t written = mem.Hash();
+    EXPECT_EQ(written, reference(mem));
+
+    // Writing a byte back restores the hash, ROM writes are ignored.
+    mem.Protect(0xE000, 0x1000);
+    mem.Write(0x0201, 0x00);
+    EXPECT_NE(mem.Hash(), written);
+    mem.Write(0x0201, 0x43);
+    mem.Write(0xE000, 0x47);
+    EXPECT_EQ(mem.Hash(), written);
+
+    // Copies take the hash along, including pages the host wrote since the last call.
+    mem[0x0500] = 0x48;
+    Mem copy(mem);
+    Mem assigned;
+    assigned = mem;
+    EXPECT_EQ(copy.Hash(), mem.Hash());
+    EXPECT_EQ(assigned.Hash(), mem.Hash());
+    EXPECT_NE(mem.Hash(), written);
+
+    mem.Protect(0xE000, 0x1000, false);
+    mem.Write(0xE000, 0x47);
+    mem.Initialize();
+    EXPECT_EQ(mem.Hash(), reference(mem));
+}
+
+TEST_F(MemTests, StateHash)
+{
+    cpu.PowerOn(mem);
+    const uint64_t start = cpu.StateHash(mem);
+
+    // The cycle counter is not part of the state.
+    cpu.cycles += 100;
+    EXPECT_EQ(cpu.StateHash(mem), start);
+
+    cpu.A = 0x01;
+    EXPECT_NE(cpu.StateHash(mem), start);
+    cpu.A = 0x00;
+    mem.Write(0x0010, 0x01);
+    EXPECT_NE(cpu.StateHash(mem), start);
+    mem.Write(0x0010, 0x00);
+    EXPECT_EQ(cpu.StateHash(mem), start);
+}
+
+TEST_F(MemTests, Copy)
+{
+    mem.Map(image_path, 0xE000, Mem::Mapping::Private);
+    mem[0x0200] = 0x42;
+
+    Mem copy(mem);
+    EXPECT_EQ(copy[0x0200], 0x42);
+    EXPECT_EQ(copy[0xE100], 0x01);
+
+    copy[0x0200] = 0x24;
+    EXPECT_EQ(mem[0x0200], 0x42);
+}
+
+TEST_F(MemTests, Initialize)
+{
+    mem.Map(image_path, 0xE000, Mem::Mapping::Private);
+    mem[0x0010] = 0x42;
+    mem.Write(0x8000, 0x42);
+    mem.Write(0xE100, 0x42);
+
+    mem.Initialize();
+
+    EXPECT_EQ(mem[0x0010], 0x00);
+    EXPECT_EQ(mem[0x8000], 0x00);
+    EXPECT_EQ(mem[0xE100], 0x01);
+}
+
+TEST_F(MemTests, InitializeShared)
+{
+    mem.Map(image_path, 0x6000, Mem::Mapping::Shared);
+    mem.Write(0x6200, 0x42);
+
+    mem.Initialize();
+
+    EXPECT_EQ(mem[0x6200], 0x42);
+    EXPECT_EQ(ReadFileByte(0x200), 0x42);
+}
+
+TEST_F(MemTests, Protect)
+{
+    mem[0xC000] = 0x11;
+    mem.Protect(0xC000, 0x4000);
+
+    // LDA #$42, STA $C000
+    mem[0xFFFC] = 0xA9;
+    mem[0xFFFD] = 0x42;
+    mem[0xFFFE] = 0x8D;
+    mem[0xFFFF] = 0x00;
+    mem[0x0000] = 0xC0;
+
+    const uint32_t cycles = 2 + 4;
+    uint32_t used_cycles = cpu.Execute(cycles, mem);
+
+    EXPECT_EQ(cycles, used_cycles);
+    EXPECT_TRUE(mem.IsReadOnly(0xC000));
+    EXPECT_FALSE(mem.IsReadOnly(0xBFFF));
+    EXPECT_EQ(mem[0xC000], 0x11);
+
+    // Power-on keeps the ROM contents.
+    mem.Initialize();
+    EXPECT_EQ(mem[0xC000], 0x11);
+    EXPECT_EQ(mem[0x0000], 0x00);
+
+    mem.Protect(0xC000, 0x4000, false);
+    mem.Write(0xC000, 0x42);
+    EXPECT_EQ(mem[0xC000], 0x42);
+}
+
+TEST_F(MemTests, ProtectSBC)
+{
+    // SBC #$01 with the operand in ROM.
+    mem[0xFFFC] = 0xE9;
+    mem[0xFFFD] = 0x01;
+    mem.Protect(0xFF00, 0x100);
+    cpu.A = 0x05;
+    cpu.C = 1;
+
+    const uint32_t cycles = 2;
+    uint32_t used_cycles = cpu.Execute(cycles, mem);
+
+    EXPECT_EQ(cycles, used_cycles);
+    EXPECT_EQ(cpu.A, 0x04);
+    EXPECT_EQ(mem[0xFFFD], 0x01);
+}
+
+TEST_F(MemTests, ProtectInvalid)
+{
+    EXPECT_THROW(mem.Protect(0xC010, 0x100), std::invalid_argument);
+    EXPECT_THROW(mem.Protect(0xC000, 0x80), std::invalid_argument);
+}
+
+TEST_F(MemTests, LoadDump)
+{
+    const std::vector<uint8_t> bytes = {0x01, 0x02, 0x03, 0x04};
+    mem.Protect(0xC000, 0x100);
+    mem.Load(0xC0FE, bytes);
+
+    std::vector<uint8_t> dumped(6);
+    mem.Dump(0xC0FD, dumped.data(), dumped.size());
+
+    EXPECT_EQ(dumped, std::vector<uint8_t>({0x00, 0x01, 0x02, 0x03, 0x04, 0x00}));
+    EXPECT_THROW(mem.Load(0xFFFE, bytes), std::invalid_argument);
+
+    // Loaded pages are cleared by a power-on.
+    mem.Initialize();
+    EXPECT_EQ(mem[0xC100], 0x00);
+}
+
+TEST_F(MemTests, FillSlice)
+{
+    mem.Fill(0x0280, 0x100, 0xAA);
+
+    Mem::View view = mem.Slice(0x027F, 0x102);
+    EXPECT_EQ(view.size(), 0x102);
+    EXPECT_EQ(view[0], 0x00);
+    EXPECT_EQ(view[1], 0xAA);
+    EXPECT_EQ(view[0x100], 0xAA);
+    EXPECT_EQ(view[0x101], 0x00);
+    EXPECT_EQ(std::count(view.begin(), view.end(), 0xAA), 0x100);
+}
+
+TEST_F(MemTests, CompareDiff)
+{
+    Mem other;
+    mem.Fill(0x1000, 0x1000, 0x11);
+    other.Fill(0x1000, 0x1000, 0x11);
+
+    EXPECT_TRUE(mem.Compare(other));
+    EXPECT_TRUE(mem.Diff(other).empty());
+
+    other[0x0000] = 0x01;
+    other[0x103F] = 0x01;
+    other[0x1040] = 0x01;
+    other.Fill(0x10FE, 0x04, 0x22);
+    mem[0xFFFF] = 0x01;
+
+    EXPECT_FALSE(mem.Compare(other));
+    const std::vector<Mem::Range> expected = {
+        {0x0000, 0x0001}, {0x103F, 0x1041}, {0x10FE, 0x1102}, {0xFFFF, 0x10000}};
+    EXPECT_EQ(mem.Diff(other), expected);
+}
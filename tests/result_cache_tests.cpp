@@ -0,0 +1,297 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "batch.h"
+#include "counter_program.h"
+#include "result_cache.h"
+
+class ResultCacheTests : public ::testing::Test
+{
+   public:
+    CPU cpu;
+    Mem memory;
+
+    ResultCacheConfig config;
+
+   protected:
+    void SetUp() override
+    {
+        config.directory = "/tmp/mos6502_result_cache_tests_" + std::to_string(getpid());
+        StartCounter(cpu, memory);
+    }
+
+    void TearDown() override
+    {
+        for (const std::string& name : Files())
+            std::remove((config.directory + "/" + name).c_str());
+        rmdir(config.directory.c_str());
+    }
+
+    std::vector<std::string> Files() const
+    {
+        std::vector<std::string> names;
+        if (DIR* directory = opendir(config.directory.c_str()))
+        {
+            while (const dirent* item = readdir(directory))
+            {
+                if (item->d_name[0] != '.')
+                    names.push_back(item->d_name);
+            }
+            closedir(directory);
+        }
+        return names;
+    }
+};
+
+TEST_F(ResultCacheTests, Hit)
+{
+    {
+        ResultCache cache(config);
+        EXPECT_GE(cache.Execute(50000, cpu, memory), 50000);
+        EXPECT_EQ(cache.GetStats().misses, 1);
+        EXPECT_EQ(cache.GetStats().entries, 1);
+    }
+
+    // Another process with the same inputs, except for the cycle counter.
+    CPU cached_cpu;
+    Mem cached_memory;
+    StartCounter(cached_cpu, cached_memory);
+    cached_cpu.cycles = 1000;
+
+    ResultCache cache(config);
+    EXPECT_EQ(cache.GetStats().entries, 1);
+    const uint32_t used = cache.Execute(50000, cached_cpu, cached_memory);
+    EXPECT_EQ(cache.GetStats().hits, 1);
+    EXPECT_EQ(used, cpu.cycles);
+    EXPECT_EQ(cached_cpu.cycles, 1000 + used);
+    EXPECT_EQ(cached_cpu.GetRegisters(), cpu.GetRegisters());
+    EXPECT_EQ(cached_cpu.stop_reason, CPU::StopReason::Cycles);
+    EXPECT_TRUE(cached_memory.Compare(memory));
+    EXPECT_EQ(cached_memory.Hash(), memory.Hash());
+
+    // The restored machine continues like the original one.
+    cpu.Execute(10000, memory);
+    cached_cpu.Execute(10000, cached_memory);
+    EXPECT_EQ(cached_cpu.GetRegisters(), cpu.GetRegisters());
+    EXPECT_TRUE(cached_memory.Compare(memory));
+}
+
+TEST_F(ResultCacheTests, Key)
+{
+    ResultCache cache(config);
+    const CPU start_cpu = cpu;
+    const Mem start_memory = memory;
+
+    auto run = [&](uint32_t cycles, uint64_t parameters, uint16_t address, uint8_t value,
+                   uint8_t x)
+    {
+        cpu = start_cpu;
+        memory = start_memory;
+        memory[address] = value;
+        cpu.X = x;
+        cache.Execute(cycles, cpu, memory, parameters);
+    };
+
+    run(1000, 0, 0x0400, 0, 0);
+    run(1001, 0, 0x0400, 0, 0);
+    run(1000, 1, 0x0400, 0, 0);
+    run(1000, 0, 0x0400, 1, 0);
+    run(1000, 0, 0x0400, 0, 1);
+    EXPECT_EQ(cache.GetStats().misses, 5);
+
+    run(1000, 0, 0x0400, 1, 0);
+    EXPECT_EQ(cache.GetStats().hits, 1);
+    EXPECT_EQ(cache.GetStats().entries, 5);
+}
+
+TEST_F(ResultCacheTests, Eviction)
+{
+    config.max_entries = 2;
+    const CPU start_cpu = cpu;
+    const Mem start_memory = memory;
+    {
+        ResultCache cache(config);
+        auto run = [&](uint32_t cycles)
+        {
+            cpu = start_cpu;
+            memory = start_memory;
+            cache.Execute(cycles, cpu, memory);
+        };
+
+        // The least recently used one goes, hits count as uses.
+        run(100);
+        run(200);
+        run(100);
+        run(300);
+        ResultCache::Stats stats = cache.GetStats();
+        EXPECT_EQ(stats.hits, 1);
+        EXPECT_EQ(stats.evicted, 1);
+        EXPECT_EQ(stats.entries, 2);
+        EXPECT_EQ(Files().size(), 2);
+
+        run(200);
+        run(300);
+        EXPECT_EQ(cache.GetStats().misses, 4);
+        EXPECT_EQ(cache.GetStats().hits, 2);
+        EXPECT_EQ(cache.GetStats().evicted, 2);
+    }
+
+    // The use order survives a restart: 200 is the oldest.
+    ResultCache cache(config);
+    auto run = [&](uint32_t cycles)
+    {
+        cpu = start_cpu;
+        memory = start_memory;
+        cache.Execute(cycles, cpu, memory);
+    };
+
+    run(400);
+    run(300);
+    run(200);
+    EXPECT_EQ(cache.GetStats().hits, 1);
+    EXPECT_EQ(cache.GetStats().misses, 2);
+
+    // A size limit below one entry keeps nothing.
+    config.max_entries = 100;
+    config.max_bytes = 1;
+    ResultCache small(config);
+    EXPECT_EQ(small.GetStats().entries, 0);
+    EXPECT_EQ(Files().size(), 0);
+}
+
+TEST_F(ResultCacheTests, Corrupt)
+{
+    const CPU start_cpu = cpu;
+    const Mem start_memory = memory;
+    {
+        ResultCache cache(config);
+        cache.Execute(5000, cpu, memory);
+    }
+
+    ASSERT_EQ(Files().size(), 1);
+    const std::string path = config.directory + "/" + Files()[0];
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(100);
+        file.put(0x55);
+    }
+
+    // Leftovers of a crash are removed.
+    std::ofstream(path + ".0.tmp") << "partial";
+
+    ResultCache cache(config);
+    EXPECT_EQ(Files().size(), 1);
+
+    CPU rerun_cpu = start_cpu;
+    Mem rerun_memory = start_memory;
+    cache.Execute(5000, rerun_cpu, rerun_memory);
+    EXPECT_EQ(cache.GetStats().misses, 1);
+    EXPECT_EQ(rerun_cpu.GetRegisters(), cpu.GetRegisters());
+    EXPECT_TRUE(rerun_memory.Compare(memory));
+
+    // Replaced by a good entry.
+    rerun_cpu = start_cpu;
+    rerun_memory = start_memory;
+    cache.Execute(5000, rerun_cpu, rerun_memory);
+    EXPECT_EQ(cache.GetStats().hits, 1);
+    EXPECT_TRUE(rerun_memory.Compare(memory));
+}
+
+TEST_F(ResultCacheTests, Batch)
+{
+    // LDX #0; loop: INX; CPX #10; BNE loop; STX $0300; JMP $C000
+    auto image = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{
+        0xA2, 0x00, 0xE8, 0xE0, 0x0A, 0xD0, 0xFB, 0x8E, 0x00, 0x03, 0x4C, 0x00, 0xC0});
+
+    std::vector<BatchJob> jobs;
+    for (uint8_t x = 0; x < 8; x++)
+    {
+        BatchJob job;
+        job.image = image;
+        job.load_address = 0x8000;
+        job.registers = CPU::Registers{0x8002, 0xFF, 0x00, x, 0x00, 0x00};
+        job.cycles = 1000;
+        job.stop_addresses = {0xC000};
+        jobs.push_back(job);
+    }
+
+    // Without the stop address the job runs out of cycles instead.
+    jobs.push_back(jobs[0]);
+    jobs.back().stop_addresses.clear();
+
+    ThreadPool pool(4);
+    ResultCache cache(config);
+    const std::vector<BatchResult> expected = RunBatch(jobs, pool);
+    std::vector<uint8_t> stored(jobs.size());
+    const BatchInspector inspect = [&](size_t job, const CPU&, const Mem& memory)
+    { stored[job] = memory[0x0300]; };
+
+    for (int round = 0; round < 2; round++)
+    {
+        const std::vector<BatchResult> results = RunBatch(jobs, pool, inspect, &cache);
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            EXPECT_EQ(results[i].registers, expected[i].registers);
+            EXPECT_EQ(results[i].cycles, expected[i].cycles);
+            EXPECT_EQ(results[i].stopped, expected[i].stopped);
+            EXPECT_EQ(stored[i], 10);
+        }
+    }
+
+    EXPECT_FALSE(expected.back().stopped);
+    EXPECT_EQ(cache.GetStats().misses, jobs.size());
+    EXPECT_EQ(cache.GetStats().hits, jobs.size());
+}
+
+TEST_F(ResultCacheTests, Errors)
+{
+    EXPECT_THROW(ResultCache(ResultCacheConfig{}), std::invalid_argument);
+
+    ResultCacheConfig zero = config;
+    zero.max_entries = 0;
+    EXPECT_THROW(ResultCache{zero}, std::invalid_argument);
+
+    ResultCacheConfig missing = config;
+    missing.directory = "/tmp/mos6502_no_such_directory/cache";
+    EXPECT_THROW(ResultCache{missing}, std::system_error);
+
+    // Runs that throw are not cached.
+    ResultCache cache(config);
+    memory[0x0200] = 0x02;
+    EXPECT_THROW(cache.Execute(100, cpu, memory), std::invalid_argument);
+    EXPECT_EQ(cache.GetStats().entries, 0);
+}
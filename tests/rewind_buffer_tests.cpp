@@ -0,0 +1,135 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "counter_program.h"
+#include "rewind_buffer.h"
+
+class RewindBufferTests : public ::testing::Test
+{
+   public:
+    CPU cpu;
+    Mem memory;
+
+    // Runs the same program uninterrupted from power-on.
+    CPU reference_cpu;
+    Mem reference_memory;
+
+   protected:
+    void SetUp() override
+    {
+        StartCounter(cpu, memory);
+        StartCounter(reference_cpu, reference_memory);
+    }
+
+    // Runs the reference to the first instruction boundary at or after cycle.
+    void RunReference(uint64_t cycle)
+    {
+        if (cycle > reference_cpu.cycles)
+            reference_cpu.Execute(cycle - reference_cpu.cycles, reference_memory);
+    }
+
+    void ExpectReference(const CPU& other_cpu, const Mem& other_memory)
+    {
+        EXPECT_EQ(other_cpu.cycles, reference_cpu.cycles);
+        EXPECT_EQ(other_cpu.GetRegisters(), reference_cpu.GetRegisters());
+        EXPECT_TRUE(other_memory.Compare(reference_memory));
+    }
+};
+
+TEST_F(RewindBufferTests, Seek)
+{
+    RewindBuffer buffer({5000, 100}, cpu, memory);
+    EXPECT_EQ(buffer.Execute(100000, cpu, memory), cpu.cycles);
+    ASSERT_GE(buffer.Size(), 20);
+    for (size_t i = 1; i < buffer.Size(); i++)
+        EXPECT_GE(buffer.Cycle(i), buffer.Cycle(i - 1) + 5000);
+
+    // Back to an exact cycle between checkpoints, then to one before it.
+    buffer.Seek(71234, cpu, memory);
+    RunReference(71234);
+    ExpectReference(cpu, memory);
+    EXPECT_EQ(buffer.Size(), 15);
+
+    StartCounter(reference_cpu, reference_memory);
+    buffer.Seek(buffer.Cycle(3), cpu, memory);
+    RunReference(cpu.cycles);
+    ExpectReference(cpu, memory);
+    EXPECT_EQ(buffer.Size(), 4);
+
+    // The machine continues as it did the first time.
+    buffer.Execute(50000, cpu, memory);
+    RunReference(cpu.cycles);
+    ExpectReference(cpu, memory);
+    EXPECT_GE(buffer.Size(), 13);
+}
+
+TEST_F(RewindBufferTests, Capacity)
+{
+    RewindBuffer buffer({1000, 4}, cpu, memory);
+    buffer.Execute(20000, cpu, memory);
+    EXPECT_EQ(buffer.Size(), 4);
+    EXPECT_GE(buffer.Cycle(0), 16000);
+
+    EXPECT_THROW(buffer.Seek(buffer.Cycle(0) - 1, cpu, memory), std::out_of_range);
+    EXPECT_THROW(buffer.Restore(4, cpu, memory), std::out_of_range);
+    EXPECT_THROW(RewindBuffer({0, 4}, cpu, memory), std::invalid_argument);
+
+    // Any machine can restore a checkpoint.
+    CPU other_cpu;
+    Mem other_memory;
+    buffer.Restore(0, other_cpu, other_memory);
+    RunReference(buffer.Cycle(0));
+    ExpectReference(other_cpu, other_memory);
+}
+
+TEST_F(RewindBufferTests, SharedPages)
+{
+    RewindBuffer buffer({1000, 1000}, cpu, memory);
+
+    // Without writes a checkpoint only adds its table.
+    const size_t empty = buffer.Bytes();
+    buffer.Checkpoint(cpu, memory);
+    const size_t table = buffer.Bytes() - empty;
+    EXPECT_LT(table, 2 * Mem::page_size * sizeof(uint32_t));
+
+    // Zero pages and pages written back to their contents are shared as well.
+    memory.Fill(0x4000, 0x1000, 0);
+    memory[0x0200] = counter_program[0];
+    buffer.Checkpoint(cpu, memory);
+    EXPECT_EQ(buffer.Bytes() - empty, 2 * table);
+
+    // The program writes at most two pages between checkpoints, the zero page and page 3.
+    buffer.Execute(100000, cpu, memory);
+    EXPECT_LE(buffer.Bytes(), buffer.Size() * (table + 2 * (Mem::page_size + 4)));
+
+    // Dropped checkpoints give their pages back.
+    RewindBuffer bounded({1000, 2}, cpu, memory);
+    bounded.Execute(100000, cpu, memory);
+    EXPECT_LE(bounded.Bytes(), 2 * table + 5 * (Mem::page_size + 4));
+}
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rom_image.h"
+#include "save_state.h"
+
+class SaveStateTests : public ::testing::Test
+{
+   public:
+    CPU cpu;
+    Mem memory;
+
+    // loop: LDA $00; ADC #1; STA $00; INX; JMP loop
+    const std::vector<uint8_t> program = {0xA5, 0x00, 0x69, 0x01, 0x85,
+                                          0x00, 0xE8, 0x4C, 0x00, 0x02};
+
+   protected:
+    void SetUp() override
+    {
+        cpu.PowerOn(memory);
+        memory.Load(0x0200, program);
+        cpu.PC = 0x0200;
+    }
+};
+
+TEST_F(SaveStateTests, RoundTrip)
+{
+    cpu.Execute(1000, memory);
+    const SaveState state(cpu, memory);
+    EXPECT_EQ(state.Bytes().size(), SaveState::size);
+    EXPECT_EQ(state.CpuState().cycles, cpu.cycles);
+
+    cpu.Execute(1000, memory);
+    const CPU::Registers registers = cpu.GetRegisters();
+    const uint64_t cycles = cpu.cycles;
+
+    // A fresh machine continues exactly where the state was captured.
+    CPU restored_cpu;
+    Mem restored_memory;
+    state.Restore(restored_cpu, restored_memory);
+    restored_cpu.Execute(1000, restored_memory);
+
+    EXPECT_EQ(restored_cpu.GetRegisters(), registers);
+    EXPECT_EQ(restored_cpu.cycles, cycles);
+    EXPECT_TRUE(restored_memory.Compare(memory));
+}
+
+TEST_F(SaveStateTests, Bytes)
+{
+    cpu.Execute(100, memory);
+    const SaveState state(cpu, memory);
+
+    SaveState parsed = SaveState::FromBytes(state.Bytes().data(), state.Bytes().size());
+    EXPECT_EQ(parsed.Bytes(), state.Bytes());
+    EXPECT_EQ(parsed.CpuState().registers, cpu.GetRegisters());
+
+    auto error = [](const std::vector<uint8_t>& bytes) -> std::string
+    {
+        try
+        {
+            SaveState::FromBytes(bytes.data(), bytes.size());
+        }
+        catch (const std::invalid_argument& e)
+        {
+            return e.what();
+        }
+        return "";
+    };
+
+    // Corruption is told apart from a version skew.
+    std::vector<uint8_t> bytes = state.Bytes();
+    bytes.pop_back();
+    EXPECT_EQ(error(bytes), "Truncated save state");
+    bytes.insert(bytes.end(), {0, 0});
+    EXPECT_EQ(error(bytes), "Truncated save state");
+    bytes.pop_back();
+    EXPECT_EQ(error(bytes), "");
+    bytes[4] = SaveState::version + 1;
+    EXPECT_EQ(error(bytes), "Unsupported save state version");
+    bytes[0] = 0;
+    EXPECT_EQ(error(bytes), "Not a save state");
+}
+
+TEST_F(SaveStateTests, Watchpoint)
+{
+    // Stopped before the INX, the restored machine executes it instead of stopping again.
+    memory.AddWatchpoint(0x0206, 0x0206, Mem::kExecute);
+    cpu.Execute(1000, memory);
+    ASSERT_EQ(cpu.PC, 0x0206);
+    const SaveState state(cpu, memory);
+
+    CPU restored_cpu;
+    Mem restored_memory;
+    restored_memory.AddWatchpoint(0x0206, 0x0206, Mem::kExecute);
+    state.Restore(restored_cpu, restored_memory);
+    restored_cpu.Execute(2, restored_memory);
+    EXPECT_EQ(restored_cpu.X, 1);
+}
+
+TEST_F(SaveStateTests, ReadOnly)
+{
+    RomImage rom(std::vector<uint8_t>(0x1000, 0x42));
+    memory.MapRom(rom, 0xF000);
+    memory[0xF000] = 0x24;
+    cpu.Execute(100, memory);
+    const SaveState state(cpu, memory);
+    EXPECT_EQ(state.Memory()[0xF000], 0x24);
+
+    // ROM keeps its contents, RAM around it is restored.
+    Mem other;
+    other.MapRom(rom, 0xF000);
+    other[0xEFFF] = 0x11;
+    state.Restore(cpu, other);
+    EXPECT_EQ(other[0xF000], 0x42);
+    EXPECT_EQ(other[0xEFFF], 0x00);
+    EXPECT_EQ(other[0x0000], memory[0x0000]);
+}
@@ -0,0 +1,277 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "scheduler.h"
+
+using namespace std::chrono_literals;
+
+class SchedulerTests : public ::testing::Test
+{
+   public:
+    struct Machine
+    {
+        CPU cpu;
+        Mem memory;
+    };
+
+    // loop: INX; BNE loop; INY; JMP loop
+    const std::vector<uint8_t> counter = {0xE8, 0xD0, 0xFD, 0xC8, 0x4C, 0x00, 0x80};
+
+    // loop: LDA $D000; BEQ loop; STA $0200; done: JMP done
+    const std::vector<uint8_t> poller = {0xAD, 0x00, 0xD0, 0xF0, 0xFB,
+                                         0x8D, 0x00, 0x02, 0x4C, 0x08, 0x80};
+
+    std::unique_ptr<Machine> MakeMachine(const std::vector<uint8_t>& program)
+    {
+        auto machine = std::make_unique<Machine>();
+        machine->memory.Load(0x8000, program);
+        machine->cpu.SetRegisters(CPU::Registers{0x8000, 0xFF, 0, 0, 0, 0});
+        return machine;
+    }
+};
+
+TEST_F(SchedulerTests, Priority)
+{
+    // Machines outlive the scheduler running them.
+    auto low = MakeMachine(counter);
+    auto high = MakeMachine(counter);
+
+    // The high instance counts its own progress: it reaches the INY once every 1284 cycles,
+    // 255 * 5 + 4 for the inner loop, 2 for the INY and 3 for the JMP. With one worker the low
+    // instance is between slices then, so its cycle counter is exact.
+    const uint32_t cycles_per_round = 1284;
+    const int first_round = 20;
+    const int last_round = first_round + 300;
+    std::vector<uint64_t> low_cycles;
+    std::atomic<int> rounds{0};
+    high->memory.AddWatchpoint(0x8003, 0x8003, Mem::kExecute);
+    high->memory.SetWatchCallback(
+        [&](const Mem::WatchHit&)
+        {
+            if (rounds == first_round || rounds == last_round)
+                low_cycles.push_back(low->cpu.cycles);
+            rounds++;
+            return false;
+        });
+
+    SchedulerConfig config;
+    config.threads = 1;
+    config.slice = 1000;
+    Scheduler scheduler(config);
+    const Scheduler::Id low_id = scheduler.Add(low->cpu, low->memory, {1, 0, {}});
+    const Scheduler::Id high_id = scheduler.Add(high->cpu, high->memory, {3, 0, {}});
+
+    // Only waits for the rounds, the shares do not depend on timing.
+    for (int i = 0; i < 10000 && rounds <= last_round; i++)
+        std::this_thread::sleep_for(1ms);
+
+    scheduler.Remove(low_id);
+    scheduler.Remove(high_id);
+    ASSERT_EQ(low_cycles.size(), 2);
+
+    // Each instance may be one slice ahead of its share, at either end of the window.
+    const double high_run = double(last_round - first_round) * cycles_per_round;
+    const double low_run = low_cycles[1] - low_cycles[0];
+    EXPECT_NEAR(high_run / low_run, 3.0, 3.0 * 2 * (config.slice + 6) / low_run);
+    EXPECT_EQ(scheduler.Size(), 0);
+}
+
+TEST_F(SchedulerTests, Quota)
+{
+    auto limited = MakeMachine(counter);
+    auto free = MakeMachine(counter);
+
+    SchedulerConfig config;
+    config.threads = 2;
+    config.slice = 1000;
+    config.period = 5ms;
+    Scheduler scheduler(config);
+    const Scheduler::Id limited_id = scheduler.Add(limited->cpu, limited->memory, {1, 2000, {}});
+    const Scheduler::Id free_id = scheduler.Add(free->cpu, free->memory);
+
+    std::this_thread::sleep_for(100ms);
+    const Scheduler::Stats stats = scheduler.GetStats(limited_id);
+
+    // About 20 periods of 2000 cycles, slices overshoot by at most one instruction.
+    EXPECT_GE(stats.cycles, 10 * 2000);
+    EXPECT_LE(stats.cycles, 22 * 2003);
+    EXPECT_GT(scheduler.GetStats(free_id).cycles, 10 * stats.cycles);
+}
+
+TEST_F(SchedulerTests, Idle)
+{
+    auto machine = MakeMachine(poller);
+    Scheduler scheduler({1, 1000});
+
+    Scheduler::Options options;
+    options.idle_addresses = {0x8000};
+    const Scheduler::Id id = scheduler.Add(machine->cpu, machine->memory, options);
+
+    // Parks before the first poll and again after every poll that finds no input.
+    ASSERT_TRUE(scheduler.WaitParked(id, 1s));
+    scheduler.Wake(id);
+    ASSERT_TRUE(scheduler.WaitParked(id, 1s));
+    Scheduler::Stats stats = scheduler.GetStats(id);
+    EXPECT_EQ(stats.state, Scheduler::State::Idle);
+    EXPECT_EQ(stats.cycles, 4 + 3);
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(scheduler.GetStats(id).slices, stats.slices);
+
+    scheduler.Access(id, [](CPU&, Mem& memory) { memory[0xD000] = 0x42; });
+    scheduler.Wake(id);
+    ASSERT_TRUE(scheduler.WaitParked(id, 1s));
+
+    stats = scheduler.GetStats(id);
+    EXPECT_EQ(stats.state, Scheduler::State::Halted);
+    EXPECT_EQ(stats.parks, 3);
+    EXPECT_TRUE(stats.error.empty());
+    EXPECT_GE(stats.max_latency * stats.slices, stats.total_latency);
+    scheduler.Access(id, [](CPU& cpu, Mem& memory)
+                     {
+                         EXPECT_EQ(memory[0x0200], 0x42);
+                         EXPECT_EQ(cpu.PC, 0x8008);
+                     });
+}
+
+TEST_F(SchedulerTests, Stopped)
+{
+    auto machine = MakeMachine(poller);
+    machine->memory[0xD000] = 0x01;
+    machine->memory.AddWatchpoint(0x0200, 0x0200, Mem::kWrite);
+
+    Scheduler scheduler({1, 1000});
+    const Scheduler::Id id = scheduler.Add(machine->cpu, machine->memory);
+
+    ASSERT_TRUE(scheduler.WaitParked(id, 1s));
+    EXPECT_EQ(scheduler.GetStats(id).state, Scheduler::State::Stopped);
+
+    scheduler.Wake(id);
+    ASSERT_TRUE(scheduler.WaitParked(id, 1s));
+    EXPECT_EQ(scheduler.GetStats(id).state, Scheduler::State::Halted);
+}
+
+TEST_F(SchedulerTests, Error)
+{
+    auto machine = MakeMachine({0xE8, 0x02});
+    Scheduler scheduler({1, 1000});
+    const Scheduler::Id id = scheduler.Add(machine->cpu, machine->memory);
+
+    ASSERT_TRUE(scheduler.WaitParked(id, 1s));
+    Scheduler::Stats stats = scheduler.GetStats(id);
+    EXPECT_EQ(stats.state, Scheduler::State::Halted);
+    EXPECT_EQ(stats.error, "Unhandled instruction: 0x2");
+
+    EXPECT_THROW(scheduler.GetStats(id + 1), std::invalid_argument);
+    EXPECT_THROW(scheduler.Add(machine->cpu, machine->memory, {0, 0, {}}), std::invalid_argument);
+}
+
+TEST_F(SchedulerTests, Many)
+{
+    std::vector<std::unique_ptr<Machine>> machines;
+    Scheduler scheduler({4, 500});
+
+    std::vector<Scheduler::Id> ids;
+    for (int i = 0; i < 200; i++)
+    {
+        machines.push_back(MakeMachine(i % 2 ? counter : poller));
+        Scheduler::Options options;
+        if (i % 2 == 0)
+            options.idle_addresses = {0x8000};
+        ids.push_back(scheduler.Add(machines.back()->cpu, machines.back()->memory, options));
+    }
+
+    std::this_thread::sleep_for(50ms);
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        const Scheduler::Stats stats = scheduler.GetStats(ids[i]);
+        if (i % 2)
+            EXPECT_GT(stats.slices, 0);
+        else
+            EXPECT_EQ(stats.state, Scheduler::State::Idle);
+    }
+
+    for (Scheduler::Id id : ids)
+        scheduler.Remove(id);
+    EXPECT_EQ(scheduler.Size(), 0);
+}
+
+TEST_F(SchedulerTests, RemoveWhileWaiting)
+{
+    auto machine = MakeMachine(counter);
+    SchedulerConfig config;
+    config.threads = 1;
+    Scheduler scheduler(config);
+    const Scheduler::Id id = scheduler.Add(machine->cpu, machine->memory);
+
+    // An Access and a Remove both wait while another Access holds the instance. Whichever
+    // gets it first, the Access does not touch a removed instance.
+    std::atomic<bool> release{false};
+    std::atomic<int> accessed{0};
+    std::thread holder(
+        [&]
+        {
+            scheduler.Access(id,
+                             [&](CPU&, Mem&)
+                             {
+                                 while (!release)
+                                     std::this_thread::sleep_for(1ms);
+                             });
+        });
+    std::this_thread::sleep_for(10ms);
+
+    std::atomic<int> unknown{0};
+    std::thread accessor(
+        [&]
+        {
+            try
+            {
+                scheduler.Access(id, [&](CPU&, Mem&) { accessed++; });
+            }
+            catch (const std::invalid_argument&)
+            {
+                unknown++;
+            }
+        });
+    std::thread remover([&] { scheduler.Remove(id); });
+    std::this_thread::sleep_for(10ms);
+
+    release = true;
+    holder.join();
+    accessor.join();
+    remover.join();
+
+    EXPECT_EQ(accessed + unknown, 1);
+    EXPECT_EQ(scheduler.Size(), 0);
+    EXPECT_THROW(scheduler.WaitParked(id, 1ms), std::invalid_argument);
+}
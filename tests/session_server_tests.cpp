@@ -0,0 +1,450 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session_server.h"
+
+class SessionServerTests : public ::testing::Test
+{
+   public:
+    // LDA #$42; STA $0300; INX; loop: JMP loop
+    const std::vector<uint8_t> program = {0xA9, 0x42, 0x8D, 0x00, 0x03, 0xE8, 0x4C, 0x06, 0x80};
+
+    SessionResponse Call(SessionServer& server, const SessionRequest& request)
+    {
+        return SessionResponse(request,
+                               server.Handle(request.Payload().data(), request.Payload().size()));
+    }
+
+    uint32_t Create(SessionServer& server)
+    {
+        SessionRequest request;
+        request.Create();
+        return Call(server, request)[0].session;
+    }
+
+    // Loads the program and starts it through the reset vector.
+    void Start(SessionRequest& request, uint32_t session)
+    {
+        request.Write(session, 0x8000, program);
+        request.Write(session, 0xFFFC, {0x00, 0x80});
+        request.Reset(session);
+    }
+};
+
+TEST_F(SessionServerTests, Batch)
+{
+    SessionServer server({});
+
+    SessionRequest request;
+    request.Create();
+    request.Create();
+    SessionResponse created = Call(server, request);
+    ASSERT_TRUE(created[0].ok);
+    ASSERT_TRUE(created[1].ok);
+    EXPECT_NE(created[0].session, created[1].session);
+    EXPECT_EQ(server.Sessions(), 2);
+
+    const uint32_t session = created[0].session;
+    SessionRequest batch;
+    Start(batch, session);
+    batch.Run(session, 10);
+    batch.Read(session, 0x0300, 2);
+    batch.GetRegisters(session);
+    batch.GetRegisters(created[1].session);
+
+    SessionResponse response = Call(server, batch);
+    ASSERT_EQ(response.Results().size(), 7);
+    for (const SessionResponse::Result& result : response.Results())
+        EXPECT_TRUE(result.ok) << result.error;
+
+    EXPECT_GE(response[3].cycles, 10);
+    EXPECT_EQ(response[4].bytes, std::vector<uint8_t>({0x42, 0x00}));
+    EXPECT_EQ(response[5].registers.PC, 0x8006);
+    EXPECT_EQ(response[5].registers.A, 0x42);
+    EXPECT_EQ(response[5].registers.X, 0x01);
+
+    // Sessions do not share memory or registers.
+    EXPECT_EQ(response[6].registers.A, 0x00);
+}
+
+TEST_F(SessionServerTests, SetRegisters)
+{
+    SessionServer server({});
+    const uint32_t session = Create(server);
+
+    SessionRequest request;
+    request.Write(session, 0x8000, program);
+    request.SetRegisters(session, CPU::Registers{0x8005, 0xF0, 1, 2, 3, 0});
+    request.Run(session, 2);
+    request.GetRegisters(session);
+
+    SessionResponse response = Call(server, request);
+    EXPECT_EQ(response[3].registers, (CPU::Registers{0x8006, 0xF0, 1, 3, 3, 0}));
+}
+
+TEST_F(SessionServerTests, Errors)
+{
+    SessionServer server({});
+    const uint32_t session = Create(server);
+
+    // Failed operations do not affect the ones after them.
+    SessionRequest request;
+    request.Run(session + 1, 10);
+    request.Write(session, 0xFFFF, {1, 2});
+    request.Read(session, 0x0000, 0x10001);
+    request.Write(session, 0x0000, {0x02});
+    request.SetRegisters(session, CPU::Registers{0x0000, 0xFF, 0, 0, 0, 0});
+    request.Run(session, 10);
+    request.Read(session, 0xFFFF, 1);
+
+    SessionResponse response = Call(server, request);
+    ASSERT_EQ(response.Results().size(), 7);
+    EXPECT_EQ(response[0].error, "Unknown session");
+    EXPECT_EQ(response[1].error, "Range exceeds the address space");
+    EXPECT_EQ(response[2].error, "Range exceeds the address space");
+    EXPECT_TRUE(response[3].ok);
+    EXPECT_TRUE(response[4].ok);
+    EXPECT_EQ(response[5].error, "Unhandled instruction: 0x2");
+    EXPECT_TRUE(response[6].ok);
+}
+
+TEST_F(SessionServerTests, Malformed)
+{
+    SessionServer server({});
+    const uint32_t session = Create(server);
+
+    // A truncated write swallows the rest of the request.
+    SessionRequest request;
+    request.GetRegisters(session);
+    request.Write(session, 0x0000, {1, 2, 3});
+    std::vector<uint8_t> payload = request.Payload();
+    payload.pop_back();
+
+    SessionResponse response(request, server.Handle(payload.data(), payload.size()));
+    ASSERT_EQ(response.Results().size(), 2);
+    EXPECT_TRUE(response[0].ok);
+    EXPECT_EQ(response[1].error, "Malformed message");
+
+    const std::vector<uint8_t> unknown = {0xFF, 0x00, 0x00, 0x00, 0x00};
+    std::vector<uint8_t> result = server.Handle(unknown.data(), unknown.size());
+    EXPECT_EQ(result[0], session_protocol::kError);
+
+    // A response of another request is rejected.
+    SessionRequest other;
+    other.Read(session, 0, 4);
+    EXPECT_THROW(SessionResponse(other, server.Handle(payload.data(), payload.size())),
+                 std::invalid_argument);
+}
+
+TEST_F(SessionServerTests, Capacity)
+{
+    ServerConfig config;
+    config.max_sessions = 2;
+    SessionServer server(config);
+
+    SessionRequest request;
+    request.Create();
+    request.Create();
+    request.Create();
+    SessionResponse response = Call(server, request);
+    EXPECT_TRUE(response[1].ok);
+    EXPECT_EQ(response[2].error, "Too many sessions");
+
+    // Destroyed sessions free their instance and their id stays invalid.
+    SessionRequest destroy;
+    destroy.Write(response[0].session, 0x0300, {0x42});
+    destroy.Destroy(response[0].session);
+    destroy.Destroy(response[0].session);
+    destroy.Create();
+    SessionResponse destroyed = Call(server, destroy);
+    EXPECT_TRUE(destroyed[1].ok);
+    EXPECT_EQ(destroyed[2].error, "Unknown session");
+    ASSERT_TRUE(destroyed[3].ok);
+    EXPECT_NE(destroyed[3].session, response[0].session);
+    EXPECT_EQ(server.Sessions(), 2);
+
+    SessionRequest read;
+    read.Read(destroyed[3].session, 0x0300, 1);
+    EXPECT_EQ(Call(server, read)[0].bytes, std::vector<uint8_t>{0x00});
+}
+
+TEST_F(SessionServerTests, Hibernate)
+{
+    SessionServer server({});
+    const uint32_t session = Create(server);
+
+    SessionRequest start;
+    Start(start, session);
+    start.Run(session, 10);
+    Call(server, start);
+
+    EXPECT_TRUE(server.Hibernate(session));
+    EXPECT_FALSE(server.Hibernate(session));
+    EXPECT_EQ(server.Resident(), 0);
+    EXPECT_GT(server.HibernatedBytes(), 0);
+    EXPECT_LT(server.HibernatedBytes(), 1024);
+
+    // The next operation wakes the session where it was.
+    SessionRequest request;
+    request.GetRegisters(session);
+    request.Read(session, 0x0300, 1);
+    SessionResponse response = Call(server, request);
+    EXPECT_EQ(response[0].registers.PC, 0x8006);
+    EXPECT_EQ(response[0].registers.X, 0x01);
+    EXPECT_EQ(response[1].bytes, std::vector<uint8_t>{0x42});
+    EXPECT_EQ(server.Resident(), 1);
+    EXPECT_EQ(server.HibernatedBytes(), 0);
+
+    // Hibernated sessions can be destroyed.
+    EXPECT_EQ(server.HibernateIdle(std::chrono::milliseconds(0)), 1);
+    SessionRequest destroy;
+    destroy.Destroy(session);
+    destroy.GetRegisters(session);
+    response = Call(server, destroy);
+    EXPECT_TRUE(response[0].ok);
+    EXPECT_EQ(response[1].error, "Unknown session");
+    EXPECT_EQ(server.HibernatedBytes(), 0);
+    EXPECT_THROW(server.Hibernate(session), std::invalid_argument);
+}
+
+TEST_F(SessionServerTests, MaxResident)
+{
+    ServerConfig config;
+    config.max_sessions = 4;
+    config.max_resident = 2;
+    SessionServer server(config);
+
+    // Every write wakes its session and hibernates the least recently used one.
+    std::vector<uint32_t> sessions;
+    SessionRequest request;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        sessions.push_back(Create(server));
+        request.Write(sessions.back(), 0x0300, {i});
+    }
+    Call(server, request);
+    EXPECT_EQ(server.Resident(), 2);
+
+    SessionRequest read;
+    for (uint32_t session : sessions)
+        read.Read(session, 0x0300, 1);
+    SessionResponse response = Call(server, read);
+    for (uint8_t i = 0; i < 4; i++)
+        EXPECT_EQ(response[i].bytes, std::vector<uint8_t>{i});
+
+    SessionRequest create;
+    create.Create();
+    EXPECT_EQ(Call(server, create)[0].error, "Too many sessions");
+}
+
+TEST_F(SessionServerTests, ConcurrentWake)
+{
+    ServerConfig config;
+    config.max_sessions = 8;
+    config.max_resident = 4;
+    SessionServer server(config);
+
+    std::vector<uint32_t> sessions;
+    for (int i = 0; i < 8; i++)
+        sessions.push_back(Create(server));
+
+    // Each thread alternates between its two sessions, so wakes keep hibernating the others.
+    // A thread holds at most one resident session, which leaves an idle one to evict.
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(4);
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back(
+            [&, t]
+            {
+                for (uint8_t i = 0; i < 50; i++)
+                {
+                    const uint32_t session = sessions[2 * t + i % 2];
+                    SessionRequest request;
+                    request.Write(session, 0x0300, {i});
+                    request.Read(session, 0x0300, 1);
+                    SessionResponse response = Call(server, request);
+                    if (!response[1].ok || response[1].bytes != std::vector<uint8_t>{i})
+                        mismatches[t]++;
+                }
+            });
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (int t = 0; t < 4; t++)
+        EXPECT_EQ(mismatches[t], 0);
+    EXPECT_EQ(server.Resident(), 4);
+    EXPECT_EQ(server.Sessions(), 8);
+}
+
+TEST_F(SessionServerTests, HibernateAfter)
+{
+    ServerConfig config;
+    config.hibernate_after = std::chrono::milliseconds(20);
+    SessionServer server(config);
+    const uint32_t session = Create(server);
+    std::thread loop([&server] { server.Serve(); });
+
+    for (int i = 0; i < 100 && server.Resident(); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(server.Resident(), 0);
+
+    server.Stop();
+    loop.join();
+
+    SessionRequest request;
+    request.GetRegisters(session);
+    EXPECT_TRUE(Call(server, request)[0].ok);
+}
+
+TEST_F(SessionServerTests, Socket)
+{
+    ServerConfig config;
+    config.socket_path = "/tmp/mos6502_session_tests_" + std::to_string(getpid()) + ".sock";
+    config.threads = 4;
+    SessionServer server(config);
+    std::thread loop([&server] { server.Serve(); });
+
+    std::vector<std::thread> clients;
+    std::vector<int> failures(8);
+    for (size_t i = 0; i < failures.size(); i++)
+    {
+        clients.emplace_back(
+            [&, i]
+            {
+                SessionClient client(config.socket_path);
+                SessionRequest create;
+                for (int j = 0; j < 16; j++)
+                    create.Create();
+
+                SessionResponse created = client.Call(create);
+                for (int round = 0; round < 10; round++)
+                {
+                    SessionRequest request;
+                    for (const SessionResponse::Result& result : created.Results())
+                    {
+                        if (round == 0)
+                            Start(request, result.session);
+                        request.Run(result.session, 100);
+                        request.GetRegisters(result.session);
+                    }
+
+                    SessionResponse response = client.Call(request);
+                    for (const SessionResponse::Result& result : response.Results())
+                        failures[i] += !result.ok;
+                    failures[i] += response.Results().back().registers.X != 1;
+                }
+            });
+    }
+
+    for (std::thread& client : clients)
+        client.join();
+
+    server.Stop();
+    loop.join();
+
+    EXPECT_EQ(failures, std::vector<int>(failures.size()));
+    EXPECT_EQ(server.Sessions(), 8 * 16);
+    EXPECT_THROW(SessionClient("/tmp/mos6502_no_such_socket"), std::system_error);
+}
+
+TEST_F(SessionServerTests, Pipelining)
+{
+    ServerConfig config;
+    config.socket_path = "/tmp/mos6502_session_pipelining_" + std::to_string(getpid()) + ".sock";
+    config.threads = 2;
+    SessionServer server(config);
+    std::thread loop([&server] { server.Serve(); });
+    const uint32_t session = Create(server);
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    config.socket_path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+    SessionRequest request;
+    request.GetRegisters(session);
+    const std::vector<uint8_t>& payload = request.Payload();
+    std::vector<uint8_t> frame = {uint8_t(payload.size()), 0, 0, 0};
+    frame.insert(frame.end(), payload.begin(), payload.end());
+
+    // A client that sends requests without reading the responses is eventually blocked,
+    // instead of the server buffering everything it sends.
+    std::vector<uint8_t> frames;
+    for (int i = 0; i < 4096; i++)
+        frames.insert(frames.end(), frame.begin(), frame.end());
+
+    size_t sent = 0;
+    const size_t cap = 64 * 1024 * 1024;
+    bool blocked = false;
+    while (sent < cap && !blocked)
+    {
+        pollfd writable = {fd, POLLOUT, 0};
+        if (poll(&writable, 1, 200) == 0)
+        {
+            blocked = true;
+            break;
+        }
+
+        const ssize_t count = send(fd, frames.data(), frames.size(), MSG_NOSIGNAL);
+        if (count > 0)
+            sent += count;
+    }
+    EXPECT_TRUE(blocked);
+
+    // Every whole frame sent gets its response, in order.
+    const size_t requests = sent / frame.size();
+    // The frame length, the status and the registers.
+    const size_t response_size = 4 + 1 + 7;
+    std::vector<uint8_t> responses;
+    uint8_t buffer[64 * 1024];
+    while (responses.size() < requests * response_size)
+    {
+        pollfd readable = {fd, POLLIN, 0};
+        ASSERT_GT(poll(&readable, 1, 5000), 0);
+        const ssize_t count = read(fd, buffer, sizeof(buffer));
+        ASSERT_GT(count, 0);
+        responses.insert(responses.end(), buffer, buffer + count);
+    }
+
+    EXPECT_EQ(responses.size(), requests * response_size);
+    const std::vector<uint8_t> last(responses.end() - response_size + 4, responses.end());
+    EXPECT_TRUE(SessionResponse(request, last)[0].ok);
+    close(fd);
+    server.Stop();
+    loop.join();
+}
@@ -0,0 +1,188 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "rom_image.h"
+#include "save_state.h"
+#include "snapshot_codec.h"
+
+class SnapshotCodecTests : public ::testing::Test
+{
+   public:
+    CPU cpu;
+    Mem memory;
+
+    // Restores what was compressed from cpu and memory.
+    CPU restored_cpu;
+    Mem restored_memory;
+
+    // loop: LDA $00; ADC #1; STA $00; INX; JMP loop
+    const std::vector<uint8_t> program = {0xA5, 0x00, 0x69, 0x01, 0x85,
+                                          0x00, 0xE8, 0x4C, 0x00, 0x02};
+
+    uint64_t seed = 1;
+
+   protected:
+    void SetUp() override
+    {
+        cpu.PowerOn(memory);
+        memory.Load(0x0200, program);
+        cpu.PC = 0x0200;
+    }
+
+    std::vector<uint8_t> Random(size_t length)
+    {
+        std::vector<uint8_t> bytes(length);
+        for (uint8_t& byte : bytes)
+        {
+            seed = seed * 6364136223846793005 + 1442695040888963407;
+            byte = seed >> 56;
+        }
+        return bytes;
+    }
+
+    // Incompressible ROM and RAM, with RAM larger than the window, and some text.
+    void Fill()
+    {
+        memory.Load(0xC000, Random(0x4000));
+        memory.Load(0x2000, Random(0x8000));
+        for (uint16_t address = 0xA000; address < 0xA800; address++)
+            memory[address] = "the quick brown fox jumps over the lazy dog "[address % 44];
+    }
+
+    void ExpectRestored()
+    {
+        EXPECT_EQ(restored_cpu.GetRegisters(), cpu.GetRegisters());
+        EXPECT_EQ(restored_cpu.cycles, cpu.cycles);
+        EXPECT_TRUE(restored_memory.Compare(memory));
+    }
+};
+
+TEST_F(SnapshotCodecTests, RoundTrip)
+{
+    Fill();
+    cpu.Execute(1000, memory);
+
+    const SnapshotCodec codec;
+    const std::vector<uint8_t> bytes = codec.Compress(cpu, memory);
+    restored_memory[0x1234] = 0x56;
+    codec.Decompress(bytes, restored_cpu, restored_memory);
+    ExpectRestored();
+
+    // The random bytes are stored with little overhead, the rest almost vanishes.
+    EXPECT_GT(bytes.size(), 0xC000);
+    EXPECT_LT(bytes.size(), 0xC000 + 0x400);
+}
+
+TEST_F(SnapshotCodecTests, Reference)
+{
+    Fill();
+    const SaveState loaded(cpu, memory);
+    const SnapshotCodec codec(loaded.Memory());
+
+    // A ROM page copied elsewhere is found as well.
+    cpu.Execute(1000, memory);
+    memory.Load(0x1000, memory.Slice(0xD100, 0x100).data(), 0x100);
+    memory[0x3000] ^= 0xFF;
+
+    const std::vector<uint8_t> bytes = codec.Compress(cpu, memory);
+    codec.Decompress(bytes, restored_cpu, restored_memory);
+    ExpectRestored();
+
+    // Only the RAM pages written since loading are stored.
+    EXPECT_LT(bytes.size(), 0x400);
+
+    // Snapshots need the reference they were compressed with.
+    EXPECT_THROW(SnapshotCodec().Decompress(bytes, restored_cpu, restored_memory),
+                 std::invalid_argument);
+    const SnapshotCodec other(SaveState(cpu, memory).Memory());
+    EXPECT_THROW(other.Decompress(bytes, restored_cpu, restored_memory), std::invalid_argument);
+}
+
+TEST_F(SnapshotCodecTests, Compressible)
+{
+    for (uint32_t address = 0x0300; address < Mem::max_size; address++)
+        memory[address] = address * 7 % 251;
+
+    const SnapshotCodec codec;
+    const std::vector<uint8_t> bytes = codec.Compress(cpu, memory);
+    codec.Decompress(bytes, restored_cpu, restored_memory);
+    ExpectRestored();
+    EXPECT_LT(bytes.size(), 1000);
+
+    // Zero pages cost a byte each.
+    cpu.PowerOn(memory);
+    EXPECT_LT(codec.Compress(cpu, memory).size(), Mem::page_count + 64);
+}
+
+TEST_F(SnapshotCodecTests, ReadOnly)
+{
+    RomImage rom(std::vector<uint8_t>(0x1000, 0x42));
+    memory.MapRom(rom, 0xF000);
+    memory[0xF000] = 0x24;
+    memory[0xEFFF] = 0x11;
+
+    const SnapshotCodec codec;
+    const std::vector<uint8_t> bytes = codec.Compress(cpu, memory);
+
+    // ROM keeps its contents, RAM around it is restored.
+    restored_memory.MapRom(rom, 0xF000);
+    codec.Decompress(bytes, restored_cpu, restored_memory);
+    EXPECT_EQ(restored_memory[0xF000], 0x42);
+    EXPECT_EQ(restored_memory[0xEFFF], 0x11);
+}
+
+TEST_F(SnapshotCodecTests, Malformed)
+{
+    Fill();
+    const SnapshotCodec codec;
+    std::vector<uint8_t> bytes = codec.Compress(cpu, memory);
+    EXPECT_THROW(codec.Decompress({}, restored_cpu, restored_memory), std::invalid_argument);
+
+    std::vector<uint8_t> truncated(bytes.begin(), bytes.end() - 1);
+    EXPECT_THROW(codec.Decompress(truncated, restored_cpu, restored_memory),
+                 std::invalid_argument);
+    bytes.push_back(0);
+    EXPECT_THROW(codec.Decompress(bytes, restored_cpu, restored_memory), std::invalid_argument);
+    bytes.pop_back();
+
+    // Corruption is either rejected or decodes to some memory, never out of bounds.
+    for (int i = 0; i < 200; i++)
+    {
+        std::vector<uint8_t> corrupted = bytes;
+        const std::vector<uint8_t> position = Random(2);
+        corrupted[(position[0] << 8 | position[1]) % corrupted.size()] ^= 1 << (i % 8);
+        try
+        {
+            codec.Decompress(corrupted, restored_cpu, restored_memory);
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+}
@@ -35,7 +35,10 @@ class StackOperationTests : public ::testing::Test
    protected:
     void SetUp() override
     {
-        cpu.Reset(mem);
+        cpu.PowerOn(mem);
+
+        // Inline programs start at the reset vector itself.
+        cpu.PC = 0xFFFC;
     }
 
     void TestPushOnStack(uint8_t opcode, uint8_t& reg)
@@ -35,7 +35,10 @@ class SystemTests : public ::testing::Test
    protected:
     void SetUp() override
     {
-        cpu.Reset(mem);
+        cpu.PowerOn(mem);
+
+        // Inline programs start at the reset vector itself.
+        cpu.PC = 0xFFFC;
     }
 };
 
@@ -101,4 +104,87 @@ TEST_F(SystemTests, RTI)
     EXPECT_TRUE(cpu.B);
     EXPECT_TRUE(cpu.V);
     EXPECT_TRUE(cpu.N);
-}
\ No newline at end of file
+}
+
+// Tests for interrupts
+
+TEST_F(SystemTests, IRQ)
+{
+    cpu.PC = 0x1234;
+    cpu.C = 1;
+    cpu.B = 1;
+    mem[0xFFFE] = 0x00;
+    mem[0xFFFF] = 0x40;
+    mem[0x4000] = 0x40;  // RTI
+
+    EXPECT_TRUE(cpu.RaiseInterrupt(CPU::Interrupt::IRQ, mem));
+    EXPECT_EQ(cpu.PC, 0x4000);
+    EXPECT_TRUE(cpu.I);
+    EXPECT_EQ(cpu.cycles, 7);
+    EXPECT_EQ(mem[0x01FF], 0x12);
+    EXPECT_EQ(mem[0x01FE], 0x34);
+    EXPECT_EQ(mem[0x01FD], 0b00000001);
+
+    // Masked while the handler runs.
+    EXPECT_FALSE(cpu.RaiseInterrupt(CPU::Interrupt::IRQ, mem));
+    EXPECT_EQ(cpu.PC, 0x4000);
+
+    cpu.Execute(6, mem);
+    EXPECT_EQ(cpu.PC, 0x1234);
+    EXPECT_FALSE(cpu.I);
+    EXPECT_FALSE(cpu.B);
+    EXPECT_TRUE(cpu.C);
+}
+
+TEST_F(SystemTests, NMI)
+{
+    cpu.PC = 0x1234;
+    cpu.I = 1;
+    mem[0xFFFA] = 0x00;
+    mem[0xFFFB] = 0x50;
+
+    EXPECT_TRUE(cpu.RaiseInterrupt(CPU::Interrupt::NMI, mem));
+    EXPECT_EQ(cpu.PC, 0x5000);
+    EXPECT_EQ(cpu.SP, 0xFC);
+    EXPECT_EQ(cpu.cycles, 7);
+}
+
+// Tests for Reset and PowerOn
+
+TEST_F(SystemTests, Reset)
+{
+    mem[0xFFFC] = 0x00;
+    mem[0xFFFD] = 0x80;
+    mem[0x0200] = 0x42;
+    cpu.A = 0x12;
+    cpu.SP = 0x80;
+
+    cpu.Reset(mem);
+
+    EXPECT_EQ(cpu.PC, 0x8000);
+    EXPECT_EQ(cpu.SP, 0xFF);
+    EXPECT_EQ(cpu.A, 0x00);
+    EXPECT_EQ(mem[0x0200], 0x42);
+}
+
+TEST_F(SystemTests, PowerOn)
+{
+    // LDA #$42, STA $0300
+    mem[0xFFFC] = 0xA9;
+    mem[0xFFFD] = 0x42;
+    mem[0xFFFE] = 0x8D;
+    mem[0xFFFF] = 0x00;
+    mem[0x0000] = 0x03;
+
+    const uint32_t cycles = 2 + 4;
+    uint32_t used_cycles = cpu.Execute(cycles, mem);
+
+    EXPECT_EQ(cycles, used_cycles);
+    EXPECT_EQ(mem[0x0300], 0x42);
+
+    cpu.PowerOn(mem);
+
+    EXPECT_EQ(mem[0x0300], 0x00);
+    EXPECT_EQ(mem[0xFFFC], 0x00);
+    EXPECT_EQ(cpu.PC, 0x0000);
+}
@@ -0,0 +1,141 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cpu.h"
+
+class WatchpointTests : public ::testing::Test
+{
+   public:
+    Mem mem;
+    CPU cpu;
+
+   protected:
+    void SetUp() override
+    {
+        cpu.PowerOn(mem);
+        cpu.PC = 0x8000;
+
+        // LDA #$42; STA $0300; LDX $0310; NOP
+        const std::vector<uint8_t> program = {0xA9, 0x42, 0x8D, 0x00, 0x03,
+                                              0xAE, 0x10, 0x03, 0xEA};
+        for (size_t i = 0; i < program.size(); i++)
+            mem[0x8000 + i] = program[i];
+
+        mem[0x0310] = 0x24;
+    }
+};
+
+TEST_F(WatchpointTests, Write)
+{
+    int id = mem.AddWatchpoint(0x0300, 0x0300, Mem::kWrite);
+
+    uint32_t used_cycles = cpu.Execute(100, mem);
+
+    // Execution stops after the storing instruction.
+    EXPECT_EQ(used_cycles, 2 + 4);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Watchpoint);
+    EXPECT_EQ(cpu.PC, 0x8005);
+    EXPECT_EQ(mem[0x0300], 0x42);
+    EXPECT_EQ(mem.LastWatchHit().id, id);
+    EXPECT_EQ(mem.LastWatchHit().address, 0x0300);
+    EXPECT_EQ(mem.LastWatchHit().access, Mem::kWrite);
+}
+
+TEST_F(WatchpointTests, Read)
+{
+    mem.AddWatchpoint(0x0305, 0x0315, Mem::kRead);
+
+    uint32_t used_cycles = cpu.Execute(100, mem);
+
+    EXPECT_EQ(used_cycles, 2 + 4 + 4);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Watchpoint);
+    EXPECT_EQ(cpu.X, 0x24);
+    EXPECT_EQ(mem.LastWatchHit().address, 0x0310);
+    EXPECT_EQ(mem.LastWatchHit().access, Mem::kRead);
+}
+
+TEST_F(WatchpointTests, Execute)
+{
+    mem.AddWatchpoint(0x8005, 0x8005, Mem::kExecute);
+
+    uint32_t used_cycles = cpu.Execute(100, mem);
+
+    // Execution stops before the watched instruction.
+    EXPECT_EQ(used_cycles, 2 + 4);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Watchpoint);
+    EXPECT_EQ(cpu.PC, 0x8005);
+    EXPECT_EQ(cpu.X, 0x00);
+
+    // Resuming executes the watched instruction.
+    used_cycles = cpu.Execute(4 + 2, mem);
+
+    EXPECT_EQ(used_cycles, 4 + 2);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Cycles);
+    EXPECT_EQ(cpu.X, 0x24);
+}
+
+TEST_F(WatchpointTests, OtherAccess)
+{
+    // Neither instruction fetches nor reads trigger a write watchpoint.
+    mem.AddWatchpoint(0x8000, 0x8008, Mem::kWrite);
+    mem.AddWatchpoint(0x0310, 0x0310, Mem::kWrite);
+
+    uint32_t used_cycles = cpu.Execute(2 + 4 + 4 + 2, mem);
+
+    EXPECT_EQ(used_cycles, 2 + 4 + 4 + 2);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Cycles);
+}
+
+TEST_F(WatchpointTests, Callback)
+{
+    std::vector<uint16_t> hits;
+    mem.SetWatchCallback(
+        [&](const Mem::WatchHit& hit)
+        {
+            hits.push_back(hit.address);
+            return false;
+        });
+    mem.AddWatchpoint(0x0300, 0x03FF, Mem::kRead | Mem::kWrite);
+
+    uint32_t used_cycles = cpu.Execute(2 + 4 + 4 + 2, mem);
+
+    EXPECT_EQ(used_cycles, 2 + 4 + 4 + 2);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Cycles);
+    EXPECT_EQ(hits, std::vector<uint16_t>({0x0300, 0x0310}));
+}
+
+TEST_F(WatchpointTests, Remove)
+{
+    int id = mem.AddWatchpoint(0x0300, 0x0300, Mem::kWrite);
+    mem.RemoveWatchpoint(id);
+
+    uint32_t used_cycles = cpu.Execute(2 + 4 + 4 + 2, mem);
+
+    EXPECT_EQ(used_cycles, 2 + 4 + 4 + 2);
+    EXPECT_EQ(cpu.stop_reason, CPU::StopReason::Cycles);
+}
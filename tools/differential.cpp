@@ -0,0 +1,64 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "differential.h"
+
+// Compares the lockstep engine against the reference interpreter on random programs, for
+// nightly runs. Exits with 1 when any program diverged.
+int main(int argc, char** argv)
+{
+    if (argc > 4)
+    {
+        std::cerr << "usage: " << argv[0] << " [PROGRAMS] [FIRST_SEED] [STEP_CYCLES]\n";
+        return 2;
+    }
+
+    const uint64_t count = (argc > 1) ? std::stoull(argv[1], nullptr, 0) : 10000;
+    const uint64_t first_seed = (argc > 2) ? std::stoull(argv[2], nullptr, 0) : 1;
+
+    DiffOptions options;
+    if (argc > 3)
+        options.step_cycles = std::stoul(argv[3], nullptr, 0);
+
+    ThreadPool pool;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<DiffFailure> failures = RunRandomPrograms(MakeReferenceEngine, MakeLockstepEngine,
+                                                          first_seed, count, pool, options);
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const DiffFailure& failure : failures)
+        std::printf("seed %llu: %s\n", (unsigned long long)failure.seed,
+                    failure.divergence.Describe().c_str());
+
+    std::printf("%llu programs, %zu diverged, %.0f programs/s on %u threads\n",
+                (unsigned long long)count, failures.size(), count / seconds, pool.Size());
+
+    return failures.empty() ? 0 : 1;
+}
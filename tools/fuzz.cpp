@@ -0,0 +1,105 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fuzz.h"
+
+namespace
+{
+std::vector<uint8_t> ReadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+}
+
+void WriteFile(const std::string& path, const std::vector<uint8_t>& bytes)
+{
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+}  // namespace
+
+// Fuzzes a program image and reports executions per second. Numbers may be decimal or 0x hex.
+int main(int argc, char** argv)
+{
+    if (argc < 6)
+    {
+        std::cerr << "usage: " << argv[0] << " IMAGE LOAD_ADDRESS ENTRY INPUT_ADDRESS STOP_ADDRESS"
+                  << " [ITERATIONS] [SEED...]\n";
+        return 2;
+    }
+
+    try
+    {
+        FuzzTarget target;
+        target.image = ReadFile(argv[1]);
+        target.load_address = std::stoul(argv[2], nullptr, 0);
+        target.registers =
+            CPU::Registers{uint16_t(std::stoul(argv[3], nullptr, 0)), 0xFF, 0, 0, 0, 0};
+        target.input_address = std::stoul(argv[4], nullptr, 0);
+        target.stop_addresses = {uint16_t(std::stoul(argv[5], nullptr, 0))};
+        const uint64_t iterations = (argc > 6) ? std::stoull(argv[6], nullptr, 0) : 1000000;
+
+        Fuzzer fuzzer(target);
+        for (int arg = 7; arg < argc; arg++)
+            fuzzer.AddSeed(ReadFile(argv[arg]));
+
+        const uint64_t report = 100000;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t done = 0; done < iterations; done += report)
+        {
+            fuzzer.Fuzz(std::min(report, iterations - done));
+
+            const double seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("execs %llu  exec/s %.0f  edges %u  corpus %zu  crashes %llu (%zu kept)"
+                        "  hangs %llu\n",
+                        (unsigned long long)fuzzer.executions, fuzzer.executions / seconds,
+                        fuzzer.Edges(), fuzzer.Corpus().size(), (unsigned long long)fuzzer.crashes,
+                        fuzzer.Crashes().size(), (unsigned long long)fuzzer.hangs);
+        }
+
+        for (size_t crash = 0; crash < fuzzer.Crashes().size(); crash++)
+            WriteFile("crash-" + std::to_string(crash) + ".bin", fuzzer.Crashes()[crash]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
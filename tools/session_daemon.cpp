@@ -0,0 +1,104 @@
+/*
+ * This file is part of the MOS6502 emulator.
+ * (https://github.com/ericwoude/MOS6502)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright © 2021 Eric van der Woude
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the “Software”), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "session_server.h"
+
+namespace
+{
+std::atomic<SessionServer*> server{nullptr};
+
+// Stop only stores a flag and writes to an eventfd, both are async-signal-safe.
+void Terminate(int)
+{
+    if (SessionServer* session_server = server)
+        session_server->Stop();
+}
+
+// Routes SIGINT and SIGTERM to the server while it exists.
+class StopOnSignal
+{
+   public:
+    explicit StopOnSignal(SessionServer& session_server)
+    {
+        server = &session_server;
+        std::signal(SIGINT, Terminate);
+        std::signal(SIGTERM, Terminate);
+    }
+
+    ~StopOnSignal()
+    {
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        server = nullptr;
+    }
+};
+}  // namespace
+
+// Hosts emulator sessions for other local processes on a UNIX domain socket until SIGINT or
+// SIGTERM.
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 6)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " SOCKET [MAX_SESSIONS] [THREADS] [MAX_RESIDENT] [HIBERNATE_AFTER_MS]\n";
+        return 2;
+    }
+
+    try
+    {
+        ServerConfig config;
+        config.socket_path = argv[1];
+        if (argc > 2)
+            config.max_sessions = std::stoul(argv[2], nullptr, 0);
+        if (argc > 3)
+            config.threads = std::stoul(argv[3], nullptr, 0);
+        if (argc > 4)
+            config.max_resident = std::stoul(argv[4], nullptr, 0);
+        if (argc > 5)
+            config.hibernate_after = std::chrono::milliseconds(std::stoul(argv[5], nullptr, 0));
+
+        // The handlers are removed before the server is destroyed.
+        SessionServer session_server(config);
+        StopOnSignal stop_on_signal(session_server);
+
+        std::printf("listening on %s for up to %zu sessions\n", argv[1], config.max_sessions);
+        std::fflush(stdout);
+        session_server.Serve();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}